@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cpputil {
+namespace data_structure {
+
+/**
+ * @brief 持久化的哈希表, 基于 HAMT(hash array mapped trie), 节点布局参考 CHAMP
+ *
+ * 1. 哈希值每 5 bit 为一层, 每个节点最多 32 个槽位, 用两个 bitmap 区分槽位上是键值对还是子节点
+ * 2. 节点创建后不再修改, 多个版本之间共享没有变化的节点
+ * 3. 拷贝只拷贝根节点的 std::shared_ptr, 是 O(1) 的; Insert/Erase 只重新创建从根到目标的 O(log n) 个节点
+ * 4. 修改一个对象不影响它的拷贝, 旧版本对正在读的线程始终有效; 同一个对象不能被多个线程同时修改
+ * 5. 哈希值完全相同的 key 放在最底层的冲突节点中, 线性查找
+ *
+ * 适合配合 util::rcu_ptr 使用, rcu_ptr::Update 中的深拷贝只是 O(1) 的根节点拷贝:
+ *     util::rcu_ptr<PersistentHashMap<int64_t, std::string>> table(
+ *         std::make_shared<PersistentHashMap<int64_t, std::string>>());
+ *     table.Update([](PersistentHashMap<int64_t, std::string>* data) {
+ *       data->Insert(1, "1");
+ *     });
+ *     auto guard = table.ReadLock();
+ *     // 返回的指针只在 guard 存活期间有效, guard 析构后旧版本可能被回收
+ *     const std::string* value = guard->Find(1);
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class PersistentHashMap {
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  static constexpr size_t kBitsPerLevel = 5;
+  static constexpr size_t kHashBits = sizeof(size_t) * 8;
+
+  struct Node {
+    // 槽位上存放键值对的 bitmap
+    uint32_t datamap = 0;
+    // 槽位上存放子节点的 bitmap
+    uint32_t nodemap = 0;
+    // 按槽位顺序排列; 冲突节点的所有键值对也放在这里
+    std::vector<std::pair<K, V>> values;
+    std::vector<NodePtr> children;
+  };
+
+ public:
+  PersistentHashMap() = default;
+
+ public:
+  size_t Size() const {
+    return size_;
+  }
+
+  bool Empty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * @return const V* key 不存在时返回 nullptr, 指针在当前对象被修改或者析构之前有效
+   */
+  const V* Find(const K& key) const {
+    const Node* node = root_.get();
+    size_t hash = Hash()(key);
+    for (size_t shift = 0; node != nullptr; shift += kBitsPerLevel) {
+      if (shift >= kHashBits) {
+        for (auto&& kv : node->values) {
+          if (KeyEqual()(kv.first, key)) {
+            return &kv.second;
+          }
+        }
+        return nullptr;
+      }
+      uint32_t bit = Bit(hash, shift);
+      if (node->datamap & bit) {
+        auto&& kv = node->values[Index(node->datamap, bit)];
+        return KeyEqual()(kv.first, key) ? &kv.second : nullptr;
+      }
+      if (!(node->nodemap & bit)) {
+        return nullptr;
+      }
+      node = node->children[Index(node->nodemap, bit)].get();
+    }
+    return nullptr;
+  }
+
+  bool Contains(const K& key) const {
+    return Find(key) != nullptr;
+  }
+
+  /**
+   * @brief 插入 key, 已经存在时覆盖 value
+   *
+   * @return bool 是否新增了 key
+   */
+  bool Insert(const K& key, V value) {
+    bool added = false;
+    if (root_ == nullptr) {
+      root_ = std::make_shared<const Node>();
+    }
+    root_ = InsertImpl(root_, Hash()(key), 0, key, std::move(value), &added);
+    if (added) {
+      ++size_;
+    }
+    return added;
+  }
+
+  /**
+   * @return bool key 是否存在
+   */
+  bool Erase(const K& key) {
+    if (root_ == nullptr) {
+      return false;
+    }
+    bool removed = false;
+    root_ = EraseImpl(root_, Hash()(key), 0, key, &removed);
+    if (removed) {
+      --size_;
+    }
+    return removed;
+  }
+
+  void Clear() {
+    root_.reset();
+    size_ = 0;
+  }
+
+  /**
+   * @brief 遍历所有键值对, 顺序不确定
+   *
+   * @param func void(const K& key, const V& value)
+   */
+  template <typename F>
+  void ForEach(F&& func) const {
+    if (root_ != nullptr) {
+      ForEachImpl(*root_, func);
+    }
+  }
+
+ private:
+  static uint32_t Bit(size_t hash, size_t shift) {
+    return 1u << ((hash >> shift) & 31);
+  }
+
+  // bit 对应的槽位在 values/children 中的下标
+  static size_t Index(uint32_t bitmap, uint32_t bit) {
+    return __builtin_popcount(bitmap & (bit - 1));
+  }
+
+  static NodePtr InsertImpl(const NodePtr& node, size_t hash, size_t shift, const K& key, V&& value,
+                            bool* added) {
+    auto new_node = std::make_shared<Node>(*node);
+    if (shift >= kHashBits) {
+      for (auto&& kv : new_node->values) {
+        if (KeyEqual()(kv.first, key)) {
+          kv.second = std::move(value);
+          return new_node;
+        }
+      }
+      new_node->values.emplace_back(key, std::move(value));
+      *added = true;
+      return new_node;
+    }
+
+    uint32_t bit = Bit(hash, shift);
+    if (node->datamap & bit) {
+      size_t index = Index(node->datamap, bit);
+      auto&& kv = new_node->values[index];
+      if (KeyEqual()(kv.first, key)) {
+        kv.second = std::move(value);
+        return new_node;
+      }
+      // 槽位上已有另一个 key, 下沉成子节点
+      NodePtr child = MergeTwo(std::move(kv), Hash()(kv.first), std::make_pair(key, std::move(value)), hash,
+                               shift + kBitsPerLevel);
+      new_node->values.erase(new_node->values.begin() + index);
+      new_node->datamap ^= bit;
+      new_node->nodemap |= bit;
+      new_node->children.insert(new_node->children.begin() + Index(new_node->nodemap, bit), std::move(child));
+      *added = true;
+      return new_node;
+    }
+    if (node->nodemap & bit) {
+      size_t index = Index(node->nodemap, bit);
+      new_node->children[index] =
+          InsertImpl(node->children[index], hash, shift + kBitsPerLevel, key, std::move(value), added);
+      return new_node;
+    }
+    new_node->datamap |= bit;
+    new_node->values.insert(new_node->values.begin() + Index(new_node->datamap, bit),
+                            std::make_pair(key, std::move(value)));
+    *added = true;
+    return new_node;
+  }
+
+  // 创建同时包含两个键值对的子树, 两个哈希值在 shift 之前的 bit 相同
+  static NodePtr MergeTwo(std::pair<K, V>&& kv1, size_t hash1, std::pair<K, V>&& kv2, size_t hash2,
+                          size_t shift) {
+    auto node = std::make_shared<Node>();
+    if (shift >= kHashBits) {
+      node->values.push_back(std::move(kv1));
+      node->values.push_back(std::move(kv2));
+      return node;
+    }
+    uint32_t bit1 = Bit(hash1, shift);
+    uint32_t bit2 = Bit(hash2, shift);
+    if (bit1 == bit2) {
+      node->nodemap = bit1;
+      node->children.push_back(MergeTwo(std::move(kv1), hash1, std::move(kv2), hash2, shift + kBitsPerLevel));
+      return node;
+    }
+    node->datamap = bit1 | bit2;
+    if (bit1 < bit2) {
+      node->values.push_back(std::move(kv1));
+      node->values.push_back(std::move(kv2));
+    } else {
+      node->values.push_back(std::move(kv2));
+      node->values.push_back(std::move(kv1));
+    }
+    return node;
+  }
+
+  // 返回删除之后的节点, 没有变化时返回原节点, 删空时返回 nullptr
+  static NodePtr EraseImpl(const NodePtr& node, size_t hash, size_t shift, const K& key, bool* removed) {
+    if (shift >= kHashBits) {
+      for (size_t i = 0; i < node->values.size(); ++i) {
+        if (KeyEqual()(node->values[i].first, key)) {
+          *removed = true;
+          if (node->values.size() == 1) {
+            return nullptr;
+          }
+          auto new_node = std::make_shared<Node>(*node);
+          new_node->values.erase(new_node->values.begin() + i);
+          return new_node;
+        }
+      }
+      return node;
+    }
+
+    uint32_t bit = Bit(hash, shift);
+    if (node->datamap & bit) {
+      size_t index = Index(node->datamap, bit);
+      if (!KeyEqual()(node->values[index].first, key)) {
+        return node;
+      }
+      *removed = true;
+      if (node->values.size() == 1 && node->children.empty()) {
+        return nullptr;
+      }
+      auto new_node = std::make_shared<Node>(*node);
+      new_node->values.erase(new_node->values.begin() + index);
+      new_node->datamap ^= bit;
+      return new_node;
+    }
+    if (!(node->nodemap & bit)) {
+      return node;
+    }
+
+    size_t index = Index(node->nodemap, bit);
+    NodePtr child = EraseImpl(node->children[index], hash, shift + kBitsPerLevel, key, removed);
+    if (child == node->children[index]) {
+      return node;
+    }
+    if (child == nullptr && node->values.empty() && node->children.size() == 1) {
+      return nullptr;
+    }
+    auto new_node = std::make_shared<Node>(*node);
+    if (child == nullptr) {
+      new_node->children.erase(new_node->children.begin() + index);
+      new_node->nodemap ^= bit;
+    } else if (child->children.empty() && child->values.size() == 1) {
+      // 子节点只剩一个键值对时上提到当前节点, 保持树的形状和插入顺序无关
+      new_node->children.erase(new_node->children.begin() + index);
+      new_node->nodemap ^= bit;
+      new_node->datamap |= bit;
+      new_node->values.insert(new_node->values.begin() + Index(new_node->datamap, bit), child->values.front());
+    } else {
+      new_node->children[index] = std::move(child);
+    }
+    // 当前节点也只剩一个键值对时交给上一层继续上提
+    return new_node;
+  }
+
+  template <typename F>
+  static void ForEachImpl(const Node& node, F& func) {
+    for (auto&& kv : node.values) {
+      func(kv.first, kv.second);
+    }
+    for (auto&& child : node.children) {
+      ForEachImpl(*child, func);
+    }
+  }
+
+ private:
+  NodePtr root_;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief 持久化的哈希集合, 基于 PersistentHashMap, 特性相同
+ */
+template <typename K, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class PersistentHashSet {
+ public:
+  size_t Size() const {
+    return map_.Size();
+  }
+
+  bool Empty() const {
+    return map_.Empty();
+  }
+
+  bool Contains(const K& key) const {
+    return map_.Contains(key);
+  }
+
+  /**
+   * @return bool 是否新增了 key
+   */
+  bool Insert(const K& key) {
+    return map_.Insert(key, EmptyValue());
+  }
+
+  /**
+   * @return bool key 是否存在
+   */
+  bool Erase(const K& key) {
+    return map_.Erase(key);
+  }
+
+  void Clear() {
+    map_.Clear();
+  }
+
+  /**
+   * @param func void(const K& key)
+   */
+  template <typename F>
+  void ForEach(F&& func) const {
+    map_.ForEach([&func](const K& key, const EmptyValue&) {
+      func(key);
+    });
+  }
+
+ private:
+  struct EmptyValue {};
+
+ private:
+  PersistentHashMap<K, EmptyValue, Hash, KeyEqual> map_;
+};
+
+}  // namespace data_structure
+}  // namespace cpputil
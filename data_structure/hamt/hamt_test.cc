@@ -0,0 +1,128 @@
+#include "data_structure/hamt/hamt.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+
+namespace cpputil {
+namespace data_structure {
+
+namespace {
+
+// 只用低 4 bit 作为哈希值, 制造大量哈希冲突
+struct BadHash {
+  size_t operator()(int key) const {
+    return static_cast<size_t>(key) & 0xf;
+  }
+};
+
+template <typename Map>
+void CheckEqual(const Map& map, const std::unordered_map<int, int>& expect) {
+  ASSERT_EQ(map.Size(), expect.size());
+  for (auto&& kv : expect) {
+    const int* value = map.Find(kv.first);
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(*value, kv.second);
+  }
+  size_t count = 0;
+  map.ForEach([&count, &expect](const int& key, const int& value) {
+    ++count;
+    ASSERT_EQ(expect.at(key), value);
+  });
+  ASSERT_EQ(count, expect.size());
+}
+
+template <typename Map>
+void RandomTest() {
+  Map map;
+  std::unordered_map<int, int> expect;
+  std::mt19937 rng(42);
+  for (int i = 0; i < 20000; ++i) {
+    int key = static_cast<int>(rng() % 2000);
+    if (rng() % 3 == 0) {
+      ASSERT_EQ(map.Erase(key), expect.erase(key) == 1);
+    } else {
+      ASSERT_EQ(map.Insert(key, i), expect.find(key) == expect.end());
+      expect[key] = i;
+    }
+  }
+  CheckEqual(map, expect);
+  for (auto&& kv : expect) {
+    ASSERT_TRUE(map.Erase(kv.first));
+  }
+  ASSERT_TRUE(map.Empty());
+  ASSERT_EQ(map.Find(0), nullptr);
+}
+
+}  // namespace
+
+TEST(PersistentHashMapTest, usage) {
+  PersistentHashMap<std::string, int> map;
+  ASSERT_TRUE(map.Insert("a", 1));
+  ASSERT_TRUE(map.Insert("b", 2));
+  ASSERT_FALSE(map.Insert("a", 3));
+  ASSERT_EQ(map.Size(), 2u);
+  ASSERT_EQ(*map.Find("a"), 3);
+  ASSERT_FALSE(map.Contains("c"));
+  ASSERT_TRUE(map.Erase("a"));
+  ASSERT_FALSE(map.Erase("a"));
+  ASSERT_EQ(map.Size(), 1u);
+}
+
+TEST(PersistentHashMapTest, random_test) {
+  RandomTest<PersistentHashMap<int, int>>();
+}
+
+TEST(PersistentHashMapTest, collision_test) {
+  RandomTest<PersistentHashMap<int, int, BadHash>>();
+}
+
+TEST(PersistentHashMapTest, persistent_test) {
+  PersistentHashMap<int, int> v1;
+  std::unordered_map<int, int> expect1;
+  for (int i = 0; i < 1000; ++i) {
+    v1.Insert(i, i);
+    expect1[i] = i;
+  }
+
+  // 修改拷贝不影响原对象
+  PersistentHashMap<int, int> v2 = v1;
+  std::unordered_map<int, int> expect2 = expect1;
+  for (int i = 0; i < 1000; i += 2) {
+    v2.Erase(i);
+    expect2.erase(i);
+  }
+  for (int i = 1000; i < 1100; ++i) {
+    v2.Insert(i, -i);
+    expect2[i] = -i;
+  }
+  v2.Insert(1, 100);
+  expect2[1] = 100;
+
+  CheckEqual(v1, expect1);
+  CheckEqual(v2, expect2);
+}
+
+TEST(PersistentHashSetTest, usage) {
+  PersistentHashSet<int> set;
+  ASSERT_TRUE(set.Insert(1));
+  ASSERT_FALSE(set.Insert(1));
+  PersistentHashSet<int> copy = set;
+  ASSERT_TRUE(copy.Insert(2));
+  ASSERT_EQ(set.Size(), 1u);
+  ASSERT_EQ(copy.Size(), 2u);
+  ASSERT_TRUE(copy.Contains(2));
+  ASSERT_FALSE(set.Contains(2));
+  int sum = 0;
+  copy.ForEach([&sum](int key) {
+    sum += key;
+  });
+  ASSERT_EQ(sum, 3);
+  ASSERT_TRUE(copy.Erase(1));
+  ASSERT_FALSE(copy.Contains(1));
+}
+
+}  // namespace data_structure
+}  // namespace cpputil
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "util/macro_util.h"
+
+namespace cpputil {
+namespace data_structure {
+
+/**
+ * @brief 单生产者单消费者的无锁环形队列
+ *
+ * 1. Capacity 必须是 2 的幂, 用掩码代替取模; head_/tail_ 单调递增, 不需要浪费一个槽位来区分满和空
+ * 2. 生产者只写 tail_, 消费者只写 head_, 两者放在不同的 cache line 上
+ * 3. 双方各自缓存对方的下标, 只有缓存的下标显示队列满/空时才去读对方的 cache line
+ * 4. 元素直接构造在队列的内存中, 消费者可以用 Front 原地访问队头元素, 处理完再 Pop, 实现零拷贝的交接
+ *
+ * 只能有一个线程调用生产者接口(TryPush/TryEmplace/PushN), 一个线程调用消费者接口(TryPop/PopN/Front/Pop)
+ * 元素存放在对象内部, Capacity 较大时不要在栈上创建
+ *
+ * eg:
+ *     cpputil::data_structure::RingBuffer<Packet, 1024> buffer;
+ *     // 读线程
+ *     buffer.TryEmplace(fd);
+ *     // 解析线程
+ *     if (Packet* packet = buffer.Front()) {
+ *       Parse(*packet);
+ *       buffer.Pop();
+ *     }
+ */
+template <typename T, size_t Capacity>
+class RingBuffer {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+ public:
+  RingBuffer() = default;
+
+  ~RingBuffer() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (; head != tail; ++head) {
+      SlotAt(head)->~T();
+    }
+  }
+
+ public:
+  static constexpr size_t capacity() {
+    return Capacity;
+  }
+
+  // 在生产者或消费者线程中调用时是准确的下界/上界, 在其他线程中只是一个近似值
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+ public:
+  // 以下接口只能在生产者线程中调用
+
+  /**
+   * @return bool 队列已满时返回 false, 不会构造元素
+   */
+  template <typename... Args>
+  bool TryEmplace(Args&&... args) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == Capacity) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == Capacity) {
+        return false;
+      }
+    }
+    new (&storage_[(tail & kMask) * sizeof(T)]) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(const T& value) {
+    return TryEmplace(value);
+  }
+
+  bool TryPush(T&& value) {
+    return TryEmplace(std::move(value));
+  }
+
+  /**
+   * @brief 从 first 开始最多拷贝 n 个元素入队, 只发布一次 tail_, 需要移动元素时传入 std::make_move_iterator
+   *
+   * @return size_t 实际入队的元素个数
+   */
+  template <typename InputIt>
+  size_t PushN(InputIt first, size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t free = Capacity - (tail - cached_head_);
+    if (free < n) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      free = Capacity - (tail - cached_head_);
+    }
+    size_t count = n < free ? n : free;
+    for (size_t i = 0; i < count; ++i, ++first) {
+      new (&storage_[((tail + i) & kMask) * sizeof(T)]) T(*first);
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+ public:
+  // 以下接口只能在消费者线程中调用
+
+  /**
+   * @return T* 队头元素, 队列为空时返回 nullptr, 调用 Pop 之前一直有效
+   */
+  T* Front() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return nullptr;
+      }
+    }
+    return SlotAt(head);
+  }
+
+  /**
+   * @brief 析构队头元素并出队, 必须在 Front 返回非空之后调用
+   */
+  void Pop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    SlotAt(head)->~T();
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * @return bool 队列为空时返回 false
+   */
+  bool TryPop(T* value) {
+    T* front = Front();
+    if (front == nullptr) {
+      return false;
+    }
+    *value = std::move(*front);
+    Pop();
+    return true;
+  }
+
+  /**
+   * @brief 最多出队 n 个元素, 依次写入 out, 只发布一次 head_
+   *
+   * @return size_t 实际出队的元素个数
+   */
+  template <typename OutputIt>
+  size_t PopN(OutputIt out, size_t n) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t available = cached_tail_ - head;
+    if (available < n) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      available = cached_tail_ - head;
+    }
+    size_t count = n < available ? n : available;
+    for (size_t i = 0; i < count; ++i, ++out) {
+      T* slot = SlotAt(head + i);
+      *out = std::move(*slot);
+      slot->~T();
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  T* SlotAt(size_t index) {
+    return std::launder(reinterpret_cast<T*>(&storage_[(index & kMask) * sizeof(T)]));
+  }
+
+ private:
+  // 消费者的 cache line: 消费者写入的 head_ 和它缓存的 tail_
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_ = {0};
+  size_t cached_tail_ = 0;
+  // 生产者的 cache line: 生产者写入的 tail_ 和它缓存的 head_
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_ = {0};
+  size_t cached_head_ = 0;
+  alignas(CACHE_LINE_SIZE) alignas(T) unsigned char storage_[Capacity * sizeof(T)];
+
+  DISALLOW_COPY_AND_ASSIGN(RingBuffer);
+};
+
+}  // namespace data_structure
+}  // namespace cpputil
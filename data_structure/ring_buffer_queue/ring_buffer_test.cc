@@ -0,0 +1,115 @@
+#include "data_structure/ring_buffer_queue/ring_buffer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpputil {
+namespace data_structure {
+
+TEST(RingBufferTest, usage) {
+  RingBuffer<uint32_t, 4> buffer;
+  ASSERT_TRUE(buffer.Empty());
+
+  for (uint32_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(buffer.TryPush(i), i < 4);
+  }
+  ASSERT_EQ(buffer.Size(), 4u);
+
+  uint32_t value;
+  ASSERT_TRUE(buffer.TryPop(&value));
+  ASSERT_EQ(value, 0u);
+  ASSERT_TRUE(buffer.TryPush(10));
+  ASSERT_FALSE(buffer.TryPush(11));
+
+  std::vector<uint32_t> values;
+  while (buffer.TryPop(&value)) {
+    values.push_back(value);
+  }
+  ASSERT_EQ(values, std::vector<uint32_t>({1, 2, 3, 10}));
+  ASSERT_TRUE(buffer.Empty());
+}
+
+TEST(RingBufferTest, emplace_and_front) {
+  RingBuffer<std::string, 2> buffer;
+  ASSERT_EQ(buffer.Front(), nullptr);
+  ASSERT_TRUE(buffer.TryEmplace(3, 'a'));
+  std::string* front = buffer.Front();
+  ASSERT_NE(front, nullptr);
+  ASSERT_EQ(*front, "aaa");
+  buffer.Pop();
+  ASSERT_EQ(buffer.Front(), nullptr);
+}
+
+TEST(RingBufferTest, batch) {
+  RingBuffer<int, 8> buffer;
+  std::vector<int> input = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  ASSERT_EQ(buffer.PushN(input.begin(), input.size()), 8u);
+  ASSERT_EQ(buffer.PushN(input.begin(), input.size()), 0u);
+
+  std::vector<int> output;
+  ASSERT_EQ(buffer.PopN(std::back_inserter(output), 5), 5u);
+  ASSERT_EQ(buffer.PushN(input.begin() + 8, 2), 2u);
+  ASSERT_EQ(buffer.PopN(std::back_inserter(output), 10), 5u);
+  ASSERT_EQ(output, input);
+}
+
+TEST(RingBufferTest, destruct) {
+  auto counter = std::make_shared<int>(0);
+  {
+    RingBuffer<std::shared_ptr<int>, 8> buffer;
+    for (int i = 0; i < 5; ++i) {
+      buffer.TryPush(counter);
+    }
+    ASSERT_EQ(counter.use_count(), 6);
+  }
+  // 析构时销毁队列中剩余的元素
+  ASSERT_EQ(counter.use_count(), 1);
+}
+
+// 读线程和解析线程之间交接数据, 元素按顺序到达且不丢失
+TEST(RingBufferTest, spsc) {
+  constexpr int kCount = 1000000;
+  auto buffer = std::make_unique<RingBuffer<int, 1024>>();
+
+  std::thread producer([&buffer]() {
+    int next = 0;
+    int batch[16];
+    while (next < kCount) {
+      if (next % 2 == 0) {
+        if (buffer->TryPush(next)) {
+          ++next;
+        }
+      } else {
+        int n = std::min(16, kCount - next);
+        for (int i = 0; i < n; ++i) {
+          batch[i] = next + i;
+        }
+        next += static_cast<int>(buffer->PushN(batch, n));
+      }
+    }
+  });
+
+  int expect = 0;
+  int batch[16];
+  while (expect < kCount) {
+    if (int* front = buffer->Front()) {
+      ASSERT_EQ(*front, expect++);
+      buffer->Pop();
+    }
+    size_t n = buffer->PopN(batch, 16);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(batch[i], expect++);
+    }
+  }
+  producer.join();
+  ASSERT_TRUE(buffer->Empty());
+}
+
+}  // namespace data_structure
+}  // namespace cpputil
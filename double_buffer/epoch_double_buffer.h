@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/macro_util.h"
+
+namespace util {
+
+/**
+ * @brief 为每个读线程分配一个全局唯一的槽位下标, 线程退出时归还
+ */
+class EpochThreadRegistry {
+ public:
+  static constexpr size_t kInvalidIndex = static_cast<size_t>(-1);
+
+  // 当前线程的槽位下标, 第一次调用时分配
+  static size_t CurrentIndex() {
+    thread_local Handle handle;
+    return handle.index;
+  }
+
+ private:
+  struct Handle {
+    Handle() : index(Acquire()) {
+    }
+    ~Handle() {
+      Release(index);
+    }
+    size_t index;
+  };
+
+  struct State {
+    std::mutex mtx;
+    std::vector<size_t> free_indexes;
+    size_t next_index = 0;
+  };
+
+  static State& GetState() {
+    static State state;
+    return state;
+  }
+
+  static size_t Acquire() {
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mtx);
+    if (!state.free_indexes.empty()) {
+      size_t index = state.free_indexes.back();
+      state.free_indexes.pop_back();
+      return index;
+    }
+    return state.next_index++;
+  }
+
+  static void Release(size_t index) {
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mtx);
+    state.free_indexes.push_back(index);
+  }
+};
+
+/**
+ * @brief 基于 epoch 的双 buffer, 读操作不写任何共享的 cache line
+ *
+ * 1. 每个读线程独占一个按 cache line 对齐的槽位, 读之前把当前全局 epoch 写入自己的槽位, 读完清零
+ * 2. 写线程切换 read buffer 之后递增全局 epoch, 等待所有槽位为 0 或者不小于新 epoch(宽限期),
+ *    之后旧的 read buffer 不再有读者, 可以直接更新
+ * 3. 和 DoubleBuffer 相比, 读不需要拷贝 std::shared_ptr, 写也不需要按 1ms 轮询引用计数
+ *
+ * 同时读的线程超过 MaxThreads 时, 超出的线程共用一个原子计数器, 仍然正确但会有竞争
+ * 读操作持有 ReadGuard 期间写线程会一直等待, 不要长时间持有
+ *
+ * eg:
+ *     util::EpochDoubleBuffer<std::map<int, int>> db;
+ *     {
+ *       auto guard = db.Read();
+ *       const std::map<int, int>& data = *guard;
+ *     }
+ *     db.Update([](std::map<int, int>* data) { (*data)[1] = 1; });
+ */
+template <typename T, size_t MaxThreads = 256>
+class EpochDoubleBuffer {
+ public:
+  using UpdaterFunc = std::function<void(T* const write_buffer_data)>;
+
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&& other) noexcept : owner_(std::exchange(other.owner_, nullptr)), data_(other.data_) {
+    }
+    ~ReadGuard() {
+      if (owner_ != nullptr) {
+        owner_->ExitRead();
+      }
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ReadGuard& operator=(ReadGuard&&) = delete;
+
+   public:
+    const T& operator*() const {
+      return *data_;
+    }
+    const T* operator->() const {
+      return data_;
+    }
+    const T& Get() const {
+      return *data_;
+    }
+
+   private:
+    friend class EpochDoubleBuffer;
+    ReadGuard(const EpochDoubleBuffer* owner, const T* data) : owner_(owner), data_(data) {
+    }
+
+   private:
+    const EpochDoubleBuffer* owner_;
+    const T* data_;
+  };
+
+ public:
+  EpochDoubleBuffer() : buffers_{T(), T()} {
+  }
+  explicit EpochDoubleBuffer(const T& data) : buffers_{data, data} {
+  }
+  explicit EpochDoubleBuffer(T&& data) : buffers_{data, std::move(data)} {
+  }
+
+  EpochDoubleBuffer(const EpochDoubleBuffer&) = delete;
+  EpochDoubleBuffer& operator=(const EpochDoubleBuffer&) = delete;
+
+ public:
+  /**
+   * @brief 读 read buffer, 返回的 ReadGuard 析构之前引用一直有效, 同一线程可以嵌套读
+   */
+  ReadGuard Read() const {
+    EnterRead();
+    return ReadGuard(this, &buffers_[read_idx_.load(std::memory_order_seq_cst)]);
+  }
+
+  /**
+   * @brief 依次更新两个 buffer, 每次更新之前等待该 buffer 上的读者全部退出, 多个写线程串行执行
+   *
+   * @param updater 会被调用两次, 每个 buffer 一次
+   */
+  void Update(const UpdaterFunc& updater) {
+    std::lock_guard<std::mutex> lock(write_mtx_);
+    int write_idx = 1 - read_idx_.load(std::memory_order_relaxed);
+    // 上一次 Update 已经等待过宽限期, write buffer 没有读者
+    updater(&buffers_[write_idx]);
+    read_idx_.store(write_idx, std::memory_order_seq_cst);
+    WaitForReaders();
+    updater(&buffers_[1 - write_idx]);
+  }
+
+  void Reset(const T& data) {
+    this->Update([&data](T* const write_buffer_data) {
+      *write_buffer_data = data;
+    });
+  }
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) ReaderSlot {
+    // 0 表示没有在读, 否则为进入时的全局 epoch
+    std::atomic<uint64_t> epoch = {0};
+    // 嵌套读的深度, 只有所属线程访问
+    uint32_t depth = 0;
+  };
+
+  void EnterRead() const {
+    size_t index = EpochThreadRegistry::CurrentIndex();
+    if (index >= MaxThreads) {
+      overflow_readers_.fetch_add(1, std::memory_order_seq_cst);
+      return;
+    }
+    ReaderSlot& slot = slots_[index];
+    if (slot.depth++ == 0) {
+      // acquire 与 WaitForReaders 中递增 epoch 配对, 读到新 epoch 的读者一定能看到切换后的 read buffer
+      slot.epoch.store(global_epoch_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    }
+  }
+
+  void ExitRead() const {
+    size_t index = EpochThreadRegistry::CurrentIndex();
+    if (index >= MaxThreads) {
+      overflow_readers_.fetch_sub(1, std::memory_order_release);
+      return;
+    }
+    ReaderSlot& slot = slots_[index];
+    if (--slot.depth == 0) {
+      slot.epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @brief 宽限期: 等待所有在切换 read buffer 之前进入的读者退出
+   *
+   * 进入时间晚于递增 epoch 的读者一定读到新的 read buffer, 所以只等待 epoch 小于新 epoch 的槽位
+   */
+  void WaitForReaders() const {
+    uint64_t epoch = global_epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    for (size_t i = 0; i < MaxThreads; ++i) {
+      for (int spin = 0;; ++spin) {
+        uint64_t reader_epoch = slots_[i].epoch.load(std::memory_order_seq_cst);
+        if (reader_epoch == 0 || reader_epoch >= epoch) {
+          break;
+        }
+        Backoff(spin);
+      }
+    }
+    for (int spin = 0; overflow_readers_.load(std::memory_order_seq_cst) != 0; ++spin) {
+      Backoff(spin);
+    }
+  }
+
+  static void Backoff(int spin) {
+    if (spin < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+ private:
+  T buffers_[2];
+  std::atomic<int> read_idx_ = {0};
+  std::mutex write_mtx_;
+
+  // 从 1 开始, 槽位中的 0 表示没有在读
+  alignas(CACHE_LINE_SIZE) mutable std::atomic<uint64_t> global_epoch_ = {1};
+  alignas(CACHE_LINE_SIZE) mutable std::atomic<int64_t> overflow_readers_ = {0};
+  mutable ReaderSlot slots_[MaxThreads];
+};
+
+}  // namespace util
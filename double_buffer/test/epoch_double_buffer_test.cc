@@ -0,0 +1,130 @@
+#include "double_buffer/epoch_double_buffer.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(EpochDoubleBufferTest, update_test) {
+  util::EpochDoubleBuffer<std::map<int, int>> db;
+
+  db.Update([](std::map<int, int>* write_buffer_data) {
+    (*write_buffer_data)[1] = 1;
+  });
+
+  {
+    auto read_buffer = db.Read();
+    ASSERT_EQ(read_buffer->size(), 1u);
+  }
+
+  db.Update([](std::map<int, int>* write_buffer_data) {
+    (*write_buffer_data)[2] = 1;
+  });
+
+  {
+    auto read_buffer = db.Read();
+    ASSERT_EQ(read_buffer->size(), 2u);
+  }
+
+  db.Reset({{3, 3}});
+  ASSERT_EQ(db.Read()->count(3), 1u);
+  ASSERT_EQ(db.Read()->size(), 1u);
+}
+
+TEST(EpochDoubleBufferTest, nested_read_test) {
+  util::EpochDoubleBuffer<int> db(1);
+  auto outer = db.Read();
+  {
+    auto inner = db.Read();
+    ASSERT_EQ(*inner, 1);
+  }
+  // 内层读退出后外层读仍然有效, 写线程需要等待外层读退出
+  std::atomic<bool> updated = {false};
+  std::thread writer([&db, &updated]() {
+    db.Update([](int* data) {
+      *data = 2;
+    });
+    updated = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(updated);
+  ASSERT_EQ(*outer, 1);
+  {
+    util::EpochDoubleBuffer<int>::ReadGuard moved(std::move(outer));
+  }
+  writer.join();
+  ASSERT_EQ(*db.Read(), 2);
+}
+
+TEST(EpochDoubleBufferTest, concurrent_test) {
+  struct Pair {
+    int64_t first = 0;
+    int64_t second = 0;
+  };
+  util::EpochDoubleBuffer<Pair> db;
+  std::atomic<bool> stop = {false};
+  std::atomic<int64_t> torn_reads = {0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&db, &stop, &torn_reads]() {
+      int64_t last = 0;
+      while (!stop) {
+        auto guard = db.Read();
+        int64_t first = guard->first;
+        std::this_thread::yield();
+        // 读期间写线程不能修改这个 buffer, 且版本不会回退
+        if (first != guard->second || first < last) {
+          ++torn_reads;
+        }
+        last = first;
+      }
+    });
+  }
+
+  for (int64_t i = 1; i <= 1000; ++i) {
+    db.Update([i](Pair* data) {
+      data->first = i;
+      data->second = i;
+    });
+  }
+  stop = true;
+  for (auto&& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(torn_reads, 0);
+  ASSERT_EQ(db.Read()->first, 1000);
+}
+
+TEST(EpochDoubleBufferTest, overflow_readers_test) {
+  // 只有 1 个槽位, 其他线程走共享计数器
+  util::EpochDoubleBuffer<int, 1> db(0);
+  std::atomic<bool> stop = {false};
+  std::atomic<int64_t> bad_reads = {0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&db, &stop, &bad_reads]() {
+      int last = 0;
+      while (!stop) {
+        auto guard = db.Read();
+        if (*guard < last) {
+          ++bad_reads;
+        }
+        last = *guard;
+      }
+    });
+  }
+  for (int i = 1; i <= 200; ++i) {
+    db.Update([i](int* data) {
+      *data = i;
+    });
+  }
+  stop = true;
+  for (auto&& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(bad_reads, 0);
+  ASSERT_EQ(*db.Read(), 200);
+}
@@ -0,0 +1,179 @@
+#include "double_buffer/versioned_buffer.h"
+
+#include <atomic>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using Table = std::map<int, int>;
+using Delta = std::pair<int, int>;
+using Buffer = util::VersionedBuffer<Table, Delta>;
+
+static Buffer::ApplyFunc CountingApply(std::atomic<int>* applied) {
+  return [applied](Table* data, const Delta& delta) {
+    (*data)[delta.first] = delta.second;
+    ++*applied;
+  };
+}
+
+TEST(VersionedBufferTest, update_test) {
+  std::atomic<int> applied = {0};
+  Buffer buffer(3, Table(), CountingApply(&applied));
+
+  ASSERT_EQ(buffer.Update({1, 1}), 1u);
+  ASSERT_EQ(buffer.Update({2, 2}), 2u);
+  ASSERT_EQ(buffer.Update({3, 3}), 3u);
+  {
+    auto guard = buffer.Read();
+    ASSERT_EQ(guard.Version(), 3u);
+    ASSERT_EQ(guard->size(), 3u);
+  }
+  // 每个增量在每个 buffer 上最多执行一次
+  ASSERT_LE(applied.load(), 3 * 3);
+
+  ASSERT_EQ(buffer.Reset({{9, 9}}), 4u);
+  ASSERT_EQ(buffer.Read()->size(), 1u);
+  buffer.Update({1, 1});
+  ASSERT_EQ(buffer.Read()->size(), 2u);
+  ASSERT_EQ(buffer.Read()->at(9), 9);
+}
+
+TEST(VersionedBufferTest, slow_reader_test) {
+  std::atomic<int> applied = {0};
+  Buffer buffer(2, Table(), CountingApply(&applied));
+
+  // 慢读者占住当前 buffer, 写线程仍然可以发布到另一个 buffer
+  auto slow = buffer.Read();
+  buffer.Update({1, 1});
+  ASSERT_EQ(buffer.Read()->size(), 1u);
+
+  // 两个 buffer 都有读者, 增量留在日志中, Update 不会阻塞
+  auto second = buffer.Read();
+  buffer.Update({2, 2});
+  auto stats = buffer.GetStats();
+  ASSERT_EQ(stats.latest_version, 2u);
+  ASSERT_EQ(stats.published_version, 1u);
+  ASSERT_EQ(stats.pending_deltas, 2u);
+  ASSERT_EQ(stats.buffers.size(), 2u);
+  for (auto&& buffer_stats : stats.buffers) {
+    ASSERT_EQ(buffer_stats.readers, 1);
+    ASSERT_EQ(buffer_stats.versions_behind, buffer_stats.is_current ? 1u : 2u);
+  }
+  ASSERT_FALSE(buffer.Publish());
+  ASSERT_EQ(slow->size(), 0u);
+
+  {
+    Buffer::ReadGuard released(std::move(slow));
+  }
+  ASSERT_TRUE(buffer.Publish());
+  {
+    auto guard = buffer.Read();
+    ASSERT_EQ(guard.Version(), 2u);
+    ASSERT_EQ(guard->size(), 2u);
+  }
+  // 落后的 buffer 回放了两个增量, 而不是拷贝全量数据
+  ASSERT_EQ(applied.load(), 3);
+  stats = buffer.GetStats();
+  ASSERT_EQ(stats.pending_deltas, 1u);
+}
+
+TEST(VersionedBufferTest, concurrent_test) {
+  std::atomic<int> applied = {0};
+  Buffer buffer(3, Table(), CountingApply(&applied));
+  std::atomic<bool> stop = {false};
+  std::atomic<bool> failed = {false};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&buffer, &stop, &failed]() {
+      uint64_t last_version = 0;
+      while (!stop) {
+        auto guard = buffer.Read();
+        // 版本 v 的 buffer 恰好包含 key 1..v
+        if (guard->size() != guard.Version() || guard.Version() < last_version) {
+          failed = true;
+        }
+        last_version = guard.Version();
+      }
+    });
+  }
+
+  const int kUpdates = 2000;
+  for (int i = 1; i <= kUpdates; ++i) {
+    buffer.Update({i, i});
+  }
+  while (!buffer.Publish()) {
+    std::this_thread::yield();
+  }
+  stop = true;
+  for (auto&& reader : readers) {
+    reader.join();
+  }
+  ASSERT_FALSE(failed);
+  ASSERT_EQ(buffer.Read().Version(), static_cast<uint64_t>(kUpdates));
+  ASSERT_EQ(buffer.Read()->size(), static_cast<size_t>(kUpdates));
+}
+
+// key 为负数的增量回放时抛出异常
+static void ThrowingApply(Table* data, const Delta& delta) {
+  if (delta.first < 0) {
+    throw std::runtime_error("bad delta");
+  }
+  (*data)[delta.first] = delta.second;
+}
+
+TEST(VersionedBufferTest, update_throws_test) {
+  Buffer buffer(2, Table(), ThrowingApply);
+  ASSERT_EQ(buffer.Update({1, 1}), 1u);
+
+  // 出错的增量被撤销, 读者仍然读到之前的版本
+  ASSERT_THROW(buffer.Update({-1, 1}), std::runtime_error);
+  auto stats = buffer.GetStats();
+  ASSERT_EQ(stats.latest_version, 1u);
+  ASSERT_EQ(stats.published_version, 1u);
+  ASSERT_EQ(buffer.Read()->size(), 1u);
+
+  // 只有两个 buffer, 能继续发布说明出错的 buffer 被释放并重建
+  for (int i = 2; i <= 10; ++i) {
+    ASSERT_EQ(buffer.Update({i, i}), static_cast<uint64_t>(i));
+    auto guard = buffer.Read();
+    ASSERT_EQ(guard.Version(), static_cast<uint64_t>(i));
+    ASSERT_EQ(guard->size(), static_cast<size_t>(i));
+  }
+}
+
+TEST(VersionedBufferTest, pending_delta_throws_test) {
+  Buffer buffer(2, Table(), ThrowingApply);
+
+  // 两个 buffer 都有读者, 出错的增量留在日志中
+  auto first = buffer.Read();
+  buffer.Update({1, 1});
+  auto second = buffer.Read();
+  ASSERT_EQ(buffer.Update({-1, 1}), 2u);
+  ASSERT_EQ(buffer.Update({2, 2}), 3u);
+
+  {
+    Buffer::ReadGuard released(std::move(first));
+  }
+  // 出错的增量还没有发布过, 被丢弃, 之后的发布跳过它
+  ASSERT_THROW(buffer.Publish(), std::runtime_error);
+  ASSERT_EQ(buffer.GetStats().published_version, 1u);
+  ASSERT_TRUE(buffer.Publish());
+  {
+    auto guard = buffer.Read();
+    ASSERT_EQ(guard.Version(), 3u);
+    ASSERT_EQ(guard->size(), 2u);
+    ASSERT_EQ(guard->count(-1), 0u);
+  }
+
+  {
+    Buffer::ReadGuard released(std::move(second));
+  }
+  ASSERT_EQ(buffer.Update({3, 3}), 4u);
+  ASSERT_EQ(buffer.Read()->size(), 3u);
+  ASSERT_EQ(buffer.GetStats().pending_deltas, 1u);
+}
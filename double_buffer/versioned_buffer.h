@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "util/macro_util.h"
+
+namespace util {
+
+/**
+ * @brief 多版本 buffer, 写操作记录成增量日志, 落后的 buffer 通过回放日志追上最新版本
+ *
+ * 1. 维护 N 个 buffer(N >= 2), 读者总是读当前发布的 buffer
+ * 2. Update(delta) 把增量追加到日志中, 然后挑一个没有读者的 buffer, 回放它缺少的增量后发布
+ *    每个增量在每个 buffer 上只执行一次, 而不是像 DoubleBuffer 一样每次更新执行两遍 updater
+ * 3. 所有非当前 buffer 都有读者时不等待, 增量留在日志中, 下一次 Update/Publish 时再发布
+ * 4. Reset(data) 记录一个全量快照, 落后于快照的 buffer 先拷贝快照再回放之后的增量
+ * 5. GetStats() 返回每个 buffer 的版本、落后的版本数和读者数量
+ * 6. apply 或拷贝 T 抛出异常时 Update/Reset/Publish 把异常抛给调用者, 读者仍然读到之前发布的版本
+ *    - 出错的 buffer 被释放, 下次发布时先从当前 buffer 重建再回放
+ *    - Update 抛出异常时它的增量被撤销, 不会生效, 也不占用版本号
+ *    - 之前 Update 留在日志中的增量在发布时出错, 如果还没有发布过就被丢弃, 避免之后每次发布都失败
+ *    - 已经发布过的增量和 Reset 的快照出错(eg: std::bad_alloc)时保留, 下次发布时重试
+ *
+ * eg:
+ *     using Table = std::unordered_map<int64_t, float>;
+ *     using Delta = std::vector<std::pair<int64_t, float>>;
+ *     util::VersionedBuffer<Table, Delta> table(3, Table(), [](Table* data, const Delta& delta) {
+ *       for (auto&& kv : delta) {
+ *         (*data)[kv.first] = kv.second;
+ *       }
+ *     });
+ *     table.Update({{1, 0.5}});
+ *     {
+ *       auto guard = table.Read();
+ *       float value = guard->at(1);
+ *     }
+ */
+template <typename T, typename Delta>
+class VersionedBuffer {
+ public:
+  using ApplyFunc = std::function<void(T* data, const Delta& delta)>;
+  using Clock = std::chrono::steady_clock;
+
+  struct BufferStats {
+    uint64_t version = 0;
+    // 比最新版本落后多少个版本
+    uint64_t versions_behind = 0;
+    int64_t readers = 0;
+    bool is_current = false;
+    // 最后一次追上最新版本的时间
+    Clock::time_point last_update;
+  };
+
+  struct Stats {
+    // 最新写入的版本
+    uint64_t latest_version = 0;
+    // 读者能读到的版本, 小于 latest_version 说明有增量因为所有空闲 buffer 都被占用而没有发布
+    uint64_t published_version = 0;
+    size_t pending_deltas = 0;
+    std::vector<BufferStats> buffers;
+  };
+
+ private:
+  struct Buffer {
+    explicit Buffer(const T& d) : data(d) {
+    }
+    explicit Buffer(T&& d) : data(std::move(d)) {
+    }
+
+    T data;
+    uint64_t version = 0;
+    // 回放时抛出异常, data 不完整, 需要重建
+    bool stale = false;
+    Clock::time_point last_update = Clock::now();
+    // 读者数量, 写线程占用时为 kWriting
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> readers = {0};
+  };
+
+ public:
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&& other) noexcept : buffer_(std::exchange(other.buffer_, nullptr)) {
+    }
+    ~ReadGuard() {
+      if (buffer_ != nullptr) {
+        buffer_->readers.fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ReadGuard& operator=(ReadGuard&&) = delete;
+
+   public:
+    const T& operator*() const {
+      return buffer_->data;
+    }
+    const T* operator->() const {
+      return &buffer_->data;
+    }
+    uint64_t Version() const {
+      return buffer_->version;
+    }
+
+   private:
+    friend class VersionedBuffer;
+    explicit ReadGuard(Buffer* buffer) : buffer_(buffer) {
+    }
+
+   private:
+    Buffer* buffer_;
+  };
+
+ public:
+  /**
+   * @param buffer_num buffer 数量, 至少为 2, 越多越不容易因为慢读者而延迟发布
+   * @param data 初始数据, 会拷贝 buffer_num - 1 次
+   * @param apply 把一个增量应用到 buffer 上, 同一个增量会在每个 buffer 上各执行一次, 必须是确定性的
+   */
+  VersionedBuffer(size_t buffer_num, T data, ApplyFunc apply) : apply_(std::move(apply)) {
+    if (buffer_num < 2) {
+      throw std::invalid_argument("VersionedBuffer needs at least 2 buffers");
+    }
+    for (size_t i = 0; i + 1 < buffer_num; ++i) {
+      buffers_.emplace_back(new Buffer(data));
+    }
+    buffers_.emplace_back(new Buffer(std::move(data)));
+  }
+
+  VersionedBuffer(const VersionedBuffer&) = delete;
+  VersionedBuffer& operator=(const VersionedBuffer&) = delete;
+
+ public:
+  /**
+   * @brief 读当前发布的 buffer, 不会阻塞, ReadGuard 析构之前该 buffer 不会被修改
+   */
+  ReadGuard Read() const {
+    while (true) {
+      size_t idx = current_.load(std::memory_order_acquire);
+      Buffer* buffer = buffers_[idx].get();
+      // 写线程占用时 readers 为负数, 说明 idx 已经不是当前 buffer
+      if (buffer->readers.fetch_add(1, std::memory_order_acquire) >= 0 &&
+          current_.load(std::memory_order_acquire) == idx) {
+        return ReadGuard(buffer);
+      }
+      buffer->readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @brief 追加一个增量并尝试发布, 发布时抛出异常则撤销该增量并重新抛出
+   *
+   * @return uint64_t 该增量对应的版本号
+   */
+  uint64_t Update(Delta delta) {
+    std::lock_guard<std::mutex> lock(write_mtx_);
+    uint64_t version = ++latest_version_;
+    log_.emplace_back(version, std::move(delta));
+    try {
+      PublishLocked();
+    } catch (...) {
+      // 发布失败时新增量还没有在任何 buffer 上生效, 直接撤销
+      log_.pop_back();
+      --latest_version_;
+      throw;
+    }
+    return version;
+  }
+
+  /**
+   * @brief 全量替换数据, 之前的增量日志全部丢弃
+   *
+   * @return uint64_t 快照对应的版本号
+   */
+  uint64_t Reset(T data) {
+    std::lock_guard<std::mutex> lock(write_mtx_);
+    uint64_t version = ++latest_version_;
+    snapshot_ = std::make_shared<const T>(std::move(data));
+    snapshot_version_ = version;
+    log_.clear();
+    PublishLocked();
+    return version;
+  }
+
+  /**
+   * @brief 发布还在日志中的增量, 不会等待读者
+   *
+   * @return bool 发布之后读者是否能读到最新版本
+   */
+  bool Publish() {
+    std::lock_guard<std::mutex> lock(write_mtx_);
+    return PublishLocked();
+  }
+
+  Stats GetStats() const {
+    std::lock_guard<std::mutex> lock(write_mtx_);
+    Stats stats;
+    stats.latest_version = latest_version_;
+    stats.published_version = buffers_[current_.load(std::memory_order_relaxed)]->version;
+    stats.pending_deltas = log_.size();
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      BufferStats buffer_stats;
+      buffer_stats.version = buffers_[i]->version;
+      buffer_stats.versions_behind = latest_version_ - buffers_[i]->version;
+      buffer_stats.readers = std::max<int64_t>(0, buffers_[i]->readers.load(std::memory_order_relaxed));
+      buffer_stats.is_current = i == current_.load(std::memory_order_relaxed);
+      buffer_stats.last_update = buffers_[i]->last_update;
+      stats.buffers.push_back(buffer_stats);
+    }
+    return stats;
+  }
+
+ private:
+  static constexpr int64_t kWriting = INT64_MIN / 2;
+
+  bool PublishLocked() {
+    size_t current = current_.load(std::memory_order_relaxed);
+    if (buffers_[current]->version == latest_version_) {
+      return true;
+    }
+
+    // 优先选择版本最新的空闲 buffer, 需要回放的增量最少
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      if (i != current) {
+        candidates.push_back(i);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](size_t lhs, size_t rhs) {
+      return buffers_[lhs]->version > buffers_[rhs]->version;
+    });
+
+    for (size_t idx : candidates) {
+      Buffer* buffer = buffers_[idx].get();
+      int64_t expected = 0;
+      if (!buffer->readers.compare_exchange_strong(expected, kWriting, std::memory_order_acquire)) {
+        continue;
+      }
+      try {
+        CatchUp(buffer, *buffers_[current]);
+      } catch (...) {
+        buffer->readers.fetch_sub(kWriting, std::memory_order_release);
+        throw;
+      }
+      // 占用期间可能有读者短暂地加减过计数, 不能直接写 0
+      buffer->readers.fetch_sub(kWriting, std::memory_order_release);
+      current_.store(idx, std::memory_order_release);
+      TrimLog();
+      return true;
+    }
+    return false;
+  }
+
+  // 抛出异常时 buffer 保持 stale, 下次回放前从已发布的 buffer 重建
+  void CatchUp(Buffer* buffer, const Buffer& published) {
+    if (buffer->stale) {
+      // 已发布的 buffer 只会被读, 写线程持有 write_mtx_ 时可以直接拷贝
+      buffer->version = 0;
+      if (snapshot_ == nullptr || published.version >= snapshot_version_) {
+        buffer->data = published.data;
+        buffer->version = published.version;
+      }
+    }
+    buffer->stale = true;
+    if (snapshot_ != nullptr && buffer->version < snapshot_version_) {
+      buffer->data = *snapshot_;
+      buffer->version = snapshot_version_;
+    }
+    if (!log_.empty() && buffer->version < latest_version_) {
+      // 日志中的版本是连续的
+      size_t begin = buffer->version + 1 - log_.front().version;
+      for (size_t i = begin; i < log_.size(); ++i) {
+        if (log_[i].dropped) {
+          continue;
+        }
+        try {
+          apply_(&buffer->data, log_[i].delta);
+        } catch (...) {
+          // 非当前 buffer 的版本都不超过已发布版本, 更新的增量还没有在任何 buffer 上执行成功过
+          if (log_[i].version > published.version) {
+            log_[i].dropped = true;
+          }
+          throw;
+        }
+      }
+    }
+    buffer->stale = false;
+    buffer->version = latest_version_;
+    buffer->last_update = Clock::now();
+  }
+
+  // 丢弃所有 buffer 都已经应用过的增量和快照
+  void TrimLog() {
+    uint64_t min_version = latest_version_;
+    for (auto&& buffer : buffers_) {
+      // stale buffer 会从当前 buffer 重建, 不需要更早的日志
+      if (!buffer->stale) {
+        min_version = std::min(min_version, buffer->version);
+      }
+    }
+    while (!log_.empty() && log_.front().version <= min_version) {
+      log_.pop_front();
+    }
+    if (snapshot_ != nullptr && min_version >= snapshot_version_) {
+      snapshot_.reset();
+    }
+  }
+
+ private:
+  ApplyFunc apply_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> current_ = {0};
+
+  struct LogEntry {
+    LogEntry(uint64_t v, Delta&& d) : version(v), delta(std::move(d)) {
+    }
+
+    uint64_t version;
+    Delta delta;
+    // 回放时抛出异常被丢弃, 保留版本号使日志中的版本连续
+    bool dropped = false;
+  };
+
+  // 以下成员只在持有 write_mtx_ 时访问
+  mutable std::mutex write_mtx_;
+  uint64_t latest_version_ = 0;
+  // 版本号连续递增
+  std::deque<LogEntry> log_;
+  std::shared_ptr<const T> snapshot_;
+  uint64_t snapshot_version_ = 0;
+};
+
+}  // namespace util
@@ -1,4 +1,6 @@
+#include <future>
 #include <string>
+#include <vector>
 
 #include "http/http_client/http_client.h"
 
@@ -6,4 +8,34 @@ int main() {
   std::string resp;
   http_client::Get("www.baidu.com", 400, 200, &resp);
   printf("%s\n", resp.c_str());
+
+  // 异步客户端: 所有请求共享同一个事件线程和连接池
+  http_client::HttpClient::Options options;
+  options.max_host_connections = 4;
+  http_client::HttpClient client(options);
+  client.Start();
+
+  http_client::HttpRequest request;
+  request.url = "www.baidu.com";
+
+  // 1. 通过 std::future 获取结果
+  std::vector<std::future<http_client::HttpResponse>> futures;
+  for (int i = 0; i < 10; ++i) {
+    futures.emplace_back(client.AsyncDo(request));
+  }
+  for (auto&& future : futures) {
+    http_client::HttpResponse response = future.get();
+    printf("code:%d status:%ld size:%lu\n", response.code, response.status_code, response.body.size());
+  }
+
+  // 2. 通过回调获取结果, 回调在事件线程中执行
+  std::promise<void> done;
+  client.AsyncDo(request, [&done](http_client::HttpResponse* const response) {
+    printf("callback code:%d status:%ld size:%lu\n", response->code, response->status_code, response->body.size());
+    done.set_value();
+  });
+  done.get_future().wait();
+
+  client.Stop();
+  return 0;
 }
@@ -1,7 +1,14 @@
 #include "http/http_client/http_client.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <utility>
 
 #include "curl/curl.h"
 #include "logger/log.h"
@@ -23,15 +30,102 @@ int debug_func(CURL*, curl_infotype itype, char* p_data, size_t size, void*) {
   return 0;
 }
 
+namespace {
+
+// 根据 Content-Length 预分配内存的上限, 防止对端返回一个异常大的 Content-Length
+constexpr curl_off_t kMaxReserveSize = 64 * 1024 * 1024;
+
+// 写回调的上下文
+struct WriteContext {
+  CURL* curl = nullptr;
+  ResponseSink sink;
+  // sink 为 STRING 时的写入目标
+  std::string* str = nullptr;
+  std::size_t written = 0;
+  bool is_first_write = true;
+};
+
+// 首次写入时响应头已经接收完毕, 可以根据 Content-Length 预分配 string 或者提前检查 buffer 容量
+bool prepare_sink(WriteContext* const ctx) {
+  curl_off_t content_length = -1;
+  curl_easy_getinfo(ctx->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+  if (content_length <= 0) {
+    return true;
+  }
+
+  if (ctx->sink.type == ResponseSink::Type::STRING && ctx->str != nullptr) {
+    ctx->str->reserve(ctx->str->size() + std::min(content_length, kMaxReserveSize));
+  } else if (ctx->sink.type == ResponseSink::Type::BUFFER &&
+             static_cast<std::size_t>(content_length) > ctx->sink.capacity) {
+    LogError("content length %ld exceed buffer capacity %lu", content_length, ctx->sink.capacity);
+    return false;
+  }
+  return true;
+}
+
+bool write_fd(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LogError("write() fail, fd:%d err:%s", fd, strerror(errno));
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+}  // namespace
+
+// 返回值不等于 size * nmemb 时 curl 会以 CURLE_WRITE_ERROR 中止请求
 size_t write_callback_func(void* buffer, size_t size, size_t nmemb, void* p_data) {
-  std::string* str = reinterpret_cast<std::string*>(p_data);
-  if (nullptr == str || nullptr == buffer) {
-    return -1;
+  WriteContext* ctx = reinterpret_cast<WriteContext*>(p_data);
+  if (nullptr == ctx || nullptr == buffer) {
+    return 0;
   }
-  char* p_buffer = reinterpret_cast<char*>(buffer);
+  const char* p_buffer = reinterpret_cast<const char*>(buffer);
   // size always equals to 1
-  str->append(p_buffer, size * nmemb);
-  return nmemb;
+  std::size_t bytes = size * nmemb;
+  // Post/Get 传入的 resp 为空时没有写入目标, 让 curl 以 CURLE_WRITE_ERROR 失败
+  if (ctx->sink.type == ResponseSink::Type::STRING && nullptr == ctx->str) {
+    return 0;
+  }
+
+  if (ctx->is_first_write) {
+    ctx->is_first_write = false;
+    if (!prepare_sink(ctx)) {
+      return 0;
+    }
+  }
+
+  switch (ctx->sink.type) {
+    case ResponseSink::Type::STRING:
+      ctx->str->append(p_buffer, bytes);
+      break;
+    case ResponseSink::Type::BUFFER:
+      if (ctx->written + bytes > ctx->sink.capacity) {
+        LogError("response size exceed buffer capacity %lu", ctx->sink.capacity);
+        return 0;
+      }
+      ::memcpy(ctx->sink.buffer + ctx->written, p_buffer, bytes);
+      break;
+    case ResponseSink::Type::FD:
+      if (!write_fd(ctx->sink.fd, p_buffer, bytes)) {
+        return 0;
+      }
+      break;
+    case ResponseSink::Type::STREAM:
+      if (!ctx->sink.stream_func || !ctx->sink.stream_func(p_buffer, bytes)) {
+        return 0;
+      }
+      break;
+  }
+  ctx->written += bytes;
+  return bytes;
 }
 
 int Post(const std::string& url, const std::string& post_params, int timeout_ms, int conn_timeout_ms,
@@ -50,8 +144,11 @@ int Post(const std::string& url, const std::string& post_params, int timeout_ms,
   curl_easy_setopt(curl, CURLOPT_POST, 1);
   curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_params.c_str());
   curl_easy_setopt(curl, CURLOPT_READFUNCTION, NULL);
+  WriteContext write_ctx;
+  write_ctx.curl = curl;
+  write_ctx.str = resp;
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback_func);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void*>(resp));
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void*>(&write_ctx));
   curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
   if (nullptr == ca_path) {
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
@@ -87,8 +184,11 @@ int Get(const std::string& url, int timeout_ms, int conn_timeout_ms, std::string
   }
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl, CURLOPT_READFUNCTION, NULL);
+  WriteContext write_ctx;
+  write_ctx.curl = curl;
+  write_ctx.str = resp;
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback_func);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void*>(resp));
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void*>(&write_ctx));
   curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
   if (NULL == ca_path) {
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
@@ -110,4 +210,411 @@ int Get(const std::string& url, int timeout_ms, int conn_timeout_ms, std::string
   return res;
 }
 
+namespace {
+
+// curl_multi_poll 的最长等待时间, 新请求和 Stop 都会通过 curl_multi_wakeup 提前唤醒
+constexpr int kMultiPollTimeoutMs = 1000;
+
+std::once_flag g_curl_global_init_flag;
+
+// BatchDo 中单个请求的超时时间: 不超过剩余的 deadline, 0 表示 curl 的不超时, 这时也使用剩余的 deadline
+int clamp_timeout(int timeout_ms, int remaining_ms) {
+  if (timeout_ms <= 0) {
+    return remaining_ms;
+  }
+  return std::min(timeout_ms, remaining_ms);
+}
+
+}  // namespace
+
+struct HttpClient::Transfer {
+  CURL* easy = nullptr;
+  curl_slist* header_list = nullptr;
+  HttpRequest request;
+  HttpResponse response;
+  WriteContext write_ctx;
+  Callback callback;
+  // 所属的批次, 用于到达 deadline 时中止整批请求, 单个请求为 nullptr
+  const void* group = nullptr;
+};
+
+HttpClient::HttpClient() : HttpClient(Options()) {
+}
+
+HttpClient::HttpClient(const Options& options) : options_(options) {
+  // curl_global_init 不是线程安全的, 需要在创建任何 handle 之前调用且只调用一次
+  std::call_once(g_curl_global_init_flag, []() {
+    curl_global_init(CURL_GLOBAL_ALL);
+  });
+
+  CURLM* multi = curl_multi_init();
+  if (nullptr == multi) {
+    LogError("curl_multi_init fail");
+    return;
+  }
+  curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(options_.max_host_connections));
+  curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(options_.max_total_connections));
+  curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(options_.max_idle_connections));
+  // HTTP/2 时在同一条连接上多路复用
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  multi_handle_ = multi;
+}
+
+HttpClient::~HttpClient() {
+  Stop();
+  for (void* easy : idle_handles_) {
+    curl_easy_cleanup(reinterpret_cast<CURL*>(easy));
+  }
+  idle_handles_.clear();
+  if (multi_handle_) {
+    curl_multi_cleanup(reinterpret_cast<CURLM*>(multi_handle_));
+    multi_handle_ = nullptr;
+  }
+}
+
+bool HttpClient::Start() {
+  if (nullptr == multi_handle_) {
+    LogError("multi handle is null, HttpClient can't start");
+    return false;
+  }
+  if (!is_stop_) {
+    LogWarn("HttpClient is already started");
+    return true;
+  }
+  is_stop_ = false;
+  event_thread_ = std::thread(&HttpClient::run_event_loop, this);
+  return true;
+}
+
+void HttpClient::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(pending_mtx_);
+    if (is_stop_) {
+      return;
+    }
+    is_stop_ = true;
+  }
+  curl_multi_wakeup(reinterpret_cast<CURLM*>(multi_handle_));
+  if (event_thread_.joinable()) {
+    event_thread_.join();
+  }
+}
+
+void HttpClient::AsyncDo(const HttpRequest& request, const Callback& callback) {
+  submit_transfer(create_transfer(request, callback));
+}
+
+void HttpClient::submit_transfer(Transfer* transfer) {
+  if (nullptr == transfer->easy) {
+    finish_transfer(transfer, CURLE_FAILED_INIT);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pending_mtx_);
+    if (!is_stop_) {
+      pending_transfers_.push_back(transfer);
+      transfer = nullptr;
+    }
+  }
+  if (transfer) {
+    LogError("HttpClient is not running, url:%s", transfer->request.url.c_str());
+    finish_transfer(transfer, CURLE_FAILED_INIT);
+    return;
+  }
+  curl_multi_wakeup(reinterpret_cast<CURLM*>(multi_handle_));
+}
+
+std::future<HttpResponse> HttpClient::AsyncDo(const HttpRequest& request) {
+  // std::function 要求可拷贝, 所以用 std::shared_ptr 持有 std::promise
+  auto promise = std::make_shared<std::promise<HttpResponse>>();
+  std::future<HttpResponse> future = promise->get_future();
+  AsyncDo(request, [promise](HttpResponse* const response) {
+    promise->set_value(std::move(*response));
+  });
+  return future;
+}
+
+int HttpClient::Do(const HttpRequest& request, HttpResponse* const response) {
+  // 不能在回调中调用, 否则事件线程会阻塞等待自己
+  *response = AsyncDo(request).get();
+  return response->code;
+}
+
+int HttpClient::BatchDo(const std::vector<HttpRequest>& requests, int deadline_ms,
+                        std::vector<HttpResponse>* const responses) {
+  // 返回之前会等待所有回调执行完, 所以共享状态可以放在栈上
+  struct BatchState {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::size_t remaining = 0;
+    std::vector<HttpResponse> responses;
+  };
+  BatchState state;
+  state.remaining = requests.size();
+  state.responses.resize(requests.size());
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadline_ms);
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    int remaining_ms = std::max(1, static_cast<int>(remaining.count()));
+    HttpRequest request = requests[i];
+    request.timeout_ms = clamp_timeout(request.timeout_ms, remaining_ms);
+    request.conn_timeout_ms = clamp_timeout(request.conn_timeout_ms, remaining_ms);
+    Transfer* transfer = create_transfer(request, [&state, i](HttpResponse* const response) {
+      std::lock_guard<std::mutex> lock(state.mtx);
+      state.responses[i] = std::move(*response);
+      if (--state.remaining == 0) {
+        state.cv.notify_one();
+      }
+    });
+    transfer->group = &state;
+    submit_transfer(transfer);
+  }
+
+  auto is_all_done = [&state]() {
+    return state.remaining == 0;
+  };
+  std::unique_lock<std::mutex> lock(state.mtx);
+  if (!state.cv.wait_until(lock, deadline, is_all_done)) {
+    LogWarn("batch request reach deadline %d ms, finished:%lu total:%lu", deadline_ms,
+            requests.size() - state.remaining, requests.size());
+    lock.unlock();
+    // 未完成的请求仍然会写入调用方的 sink, 必须在事件线程中中止并等待回调执行完之后才能返回
+    // HttpClient 停止时事件线程退出前会结束所有请求, 不会一直等待
+    run_in_event_loop([this, &state]() {
+      abort_transfers(&state, CURLE_OPERATION_TIMEDOUT);
+    });
+    lock.lock();
+    state.cv.wait(lock, is_all_done);
+  }
+
+  int success_cnt = 0;
+  for (const HttpResponse& response : state.responses) {
+    if (response.code == CURLE_OK) {
+      ++success_cnt;
+    }
+  }
+  *responses = std::move(state.responses);
+  return success_cnt;
+}
+
+HttpClient::Transfer* HttpClient::create_transfer(const HttpRequest& request, const Callback& callback) {
+  Transfer* transfer = new Transfer();
+  transfer->request = request;
+  transfer->callback = callback;
+
+  CURL* curl = reinterpret_cast<CURL*>(acquire_easy_handle());
+  if (nullptr == curl) {
+    LogError("curl_easy_init fail");
+    return transfer;
+  }
+  transfer->easy = curl;
+
+  // curl 不会拷贝 url 和 post body, 所以这里引用的是 transfer 中持有的副本
+  const HttpRequest& req = transfer->request;
+  if (_HTTP_CLIENT_DEBUG) {
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, debug_func);
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, req.url.c_str());
+  if (req.method == HttpMethod::POST) {
+    curl_easy_setopt(curl, CURLOPT_POST, 1);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req.body.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(req.body.size()));
+  }
+  for (const std::string& header : req.headers) {
+    transfer->header_list = curl_slist_append(transfer->header_list, header.c_str());
+  }
+  if (transfer->header_list) {
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->header_list);
+  }
+  transfer->write_ctx.curl = curl;
+  transfer->write_ctx.sink = req.sink;
+  transfer->write_ctx.str = &transfer->response.body;
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback_func);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void*>(&transfer->write_ctx));
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, reinterpret_cast<void*>(transfer));
+  if (options_.ca_path.empty()) {
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, false);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, false);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, true);
+    curl_easy_setopt(curl, CURLOPT_CAINFO, options_.ca_path.c_str());
+  }
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1);
+  // without set this param, ms timeout is not work
+  // http://www.laruence.com/2014/01/21/2939.html
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, req.timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, req.conn_timeout_ms);
+  return transfer;
+}
+
+void HttpClient::finish_transfer(Transfer* transfer, int code) {
+  transfer->response.code = code;
+  transfer->response.body_size = transfer->write_ctx.written;
+  if (transfer->easy) {
+    long status_code = 0;
+    curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &status_code);
+    transfer->response.status_code = status_code;
+
+    HttpTiming* timing = &transfer->response.timing;
+    curl_off_t time_us = 0;
+    curl_easy_getinfo(transfer->easy, CURLINFO_NAMELOOKUP_TIME_T, &time_us);
+    timing->dns_us = time_us;
+    curl_easy_getinfo(transfer->easy, CURLINFO_CONNECT_TIME_T, &time_us);
+    timing->connect_us = time_us;
+    curl_easy_getinfo(transfer->easy, CURLINFO_APPCONNECT_TIME_T, &time_us);
+    timing->tls_us = time_us;
+    curl_easy_getinfo(transfer->easy, CURLINFO_STARTTRANSFER_TIME_T, &time_us);
+    timing->ttfb_us = time_us;
+    curl_easy_getinfo(transfer->easy, CURLINFO_TOTAL_TIME_T, &time_us);
+    timing->total_us = time_us;
+    // 没有经历的阶段 curl 返回 0(复用连接时的 connect, 非 https 的 tls), 取前一阶段的值, 保证单调递增
+    timing->connect_us = std::max(timing->connect_us, timing->dns_us);
+    timing->tls_us = std::max(timing->tls_us, timing->connect_us);
+    timing->ttfb_us = std::max(timing->ttfb_us, timing->tls_us);
+    timing->total_us = std::max(timing->total_us, timing->ttfb_us);
+    release_easy_handle(transfer->easy);
+    transfer->easy = nullptr;
+  }
+  if (transfer->header_list) {
+    curl_slist_free_all(transfer->header_list);
+    transfer->header_list = nullptr;
+  }
+  if (code != CURLE_OK) {
+    LogError("http request fail, err:%s url:%s", curl_easy_strerror(static_cast<CURLcode>(code)),
+             transfer->request.url.c_str());
+  }
+  if (transfer->callback) {
+    transfer->callback(&transfer->response);
+  }
+  delete transfer;
+}
+
+void* HttpClient::acquire_easy_handle() {
+  {
+    std::lock_guard<std::mutex> lock(handle_pool_mtx_);
+    if (!idle_handles_.empty()) {
+      void* easy = idle_handles_.back();
+      idle_handles_.pop_back();
+      return easy;
+    }
+  }
+  return curl_easy_init();
+}
+
+void HttpClient::release_easy_handle(void* easy) {
+  // curl_easy_reset 只重置选项, 保留 DNS 缓存和 TLS session 等信息
+  // 连接本身由 CURLM 的连接缓存持有, 不随 easy handle 释放
+  curl_easy_reset(reinterpret_cast<CURL*>(easy));
+  {
+    std::lock_guard<std::mutex> lock(handle_pool_mtx_);
+    if (idle_handles_.size() < options_.max_idle_handles) {
+      idle_handles_.push_back(easy);
+      return;
+    }
+  }
+  curl_easy_cleanup(reinterpret_cast<CURL*>(easy));
+}
+
+void HttpClient::run_in_event_loop(const std::function<void()>& task) {
+  {
+    std::lock_guard<std::mutex> lock(pending_mtx_);
+    if (is_stop_) {
+      return;
+    }
+    pending_tasks_.push_back(task);
+  }
+  curl_multi_wakeup(reinterpret_cast<CURLM*>(multi_handle_));
+}
+
+void HttpClient::abort_transfers(const void* group, int code) {
+  CURLM* multi = reinterpret_cast<CURLM*>(multi_handle_);
+  std::vector<Transfer*> aborted;
+  for (Transfer* transfer : running_transfers_) {
+    if (transfer->group == group) {
+      aborted.push_back(transfer);
+    }
+  }
+  for (Transfer* transfer : aborted) {
+    curl_multi_remove_handle(multi, transfer->easy);
+    running_transfers_.erase(transfer);
+    finish_transfer(transfer, code);
+  }
+}
+
+void HttpClient::run_event_loop() {
+  CURLM* multi = reinterpret_cast<CURLM*>(multi_handle_);
+  std::vector<Transfer*> new_transfers;
+  std::vector<std::function<void()>> tasks;
+
+  while (!is_stop_) {
+    // 1. 将新请求加入 CURLM, 再执行任务, 任务提交之前发起的请求都已经在 running_transfers_ 中
+    {
+      std::lock_guard<std::mutex> lock(pending_mtx_);
+      new_transfers.swap(pending_transfers_);
+      tasks.swap(pending_tasks_);
+    }
+    for (Transfer* transfer : new_transfers) {
+      CURLMcode mc = curl_multi_add_handle(multi, transfer->easy);
+      if (mc != CURLM_OK) {
+        LogError("curl_multi_add_handle fail, err:%s", curl_multi_strerror(mc));
+        finish_transfer(transfer, CURLE_FAILED_INIT);
+        continue;
+      }
+      running_transfers_.insert(transfer);
+    }
+    new_transfers.clear();
+    for (auto&& task : tasks) {
+      task();
+    }
+    tasks.clear();
+
+    // 2. 驱动所有连接上的 IO
+    int running_cnt = 0;
+    CURLMcode mc = curl_multi_perform(multi, &running_cnt);
+    if (mc != CURLM_OK) {
+      LogError("curl_multi_perform fail, err:%s", curl_multi_strerror(mc));
+    }
+
+    // 3. 处理已完成的请求
+    int msg_cnt = 0;
+    CURLMsg* msg = nullptr;
+    while ((msg = curl_multi_info_read(multi, &msg_cnt)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      Transfer* transfer = nullptr;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+      CURLcode result = msg->data.result;
+      curl_multi_remove_handle(multi, msg->easy_handle);
+      running_transfers_.erase(transfer);
+      finish_transfer(transfer, result);
+    }
+
+    // 4. 等待 IO 事件, 新请求、任务或者 Stop 会通过 curl_multi_wakeup 唤醒
+    mc = curl_multi_poll(multi, nullptr, 0, kMultiPollTimeoutMs, nullptr);
+    if (mc != CURLM_OK) {
+      LogError("curl_multi_poll fail, err:%s", curl_multi_strerror(mc));
+    }
+  }
+
+  // 退出前结束所有未完成的请求, Stop 之后不会再有新请求和任务加入
+  for (Transfer* transfer : running_transfers_) {
+    curl_multi_remove_handle(multi, transfer->easy);
+    finish_transfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+  }
+  running_transfers_.clear();
+  {
+    std::lock_guard<std::mutex> lock(pending_mtx_);
+    new_transfers.swap(pending_transfers_);
+    pending_tasks_.clear();
+  }
+  for (Transfer* transfer : new_transfers) {
+    finish_transfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+  }
+}
+
 }  // namespace http_client
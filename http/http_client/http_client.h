@@ -1,8 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+#include "util/macro_util.h"
+
 /**
  * 是否输出debug日志
  */
@@ -36,4 +45,212 @@ int Post(const std::string& url, const std::string& post_params, int timeout_ms,
  */
 int Get(const std::string& url, int timeout_ms, int conn_timeout_ms, std::string* resp, const char* ca_path = nullptr);
 
+/**
+ * @brief 响应 body 的写入目标, 默认写入 HttpResponse::body
+ *
+ * 大响应可以直接写入调用方预分配的内存、文件或者流式解析器, 避免先拼接成 std::string 再拷贝一次
+ */
+struct ResponseSink {
+  enum class Type {
+    STRING = 0,  // 写入 HttpResponse::body, 有 Content-Length 时预先 reserve
+    BUFFER = 1,  // 写入调用方预分配的内存, 超出容量时请求失败
+    FD = 2,      // 写入文件描述符, eg: 直接落盘
+    STREAM = 3,  // 每收到一段数据就回调一次, eg: 流式解析 json
+  };
+  // 在事件线程中回调, 返回 false 时中止请求
+  using StreamFunc = std::function<bool(const char* data, std::size_t size)>;
+
+  Type type = Type::STRING;
+  char* buffer = nullptr;
+  std::size_t capacity = 0;
+  int fd = -1;
+  StreamFunc stream_func;
+
+  static ResponseSink Buffer(char* buffer, std::size_t capacity) {
+    ResponseSink sink;
+    sink.type = Type::BUFFER;
+    sink.buffer = buffer;
+    sink.capacity = capacity;
+    return sink;
+  }
+
+  static ResponseSink Fd(int fd) {
+    ResponseSink sink;
+    sink.type = Type::FD;
+    sink.fd = fd;
+    return sink;
+  }
+
+  static ResponseSink Stream(const StreamFunc& stream_func) {
+    ResponseSink sink;
+    sink.type = Type::STREAM;
+    sink.stream_func = stream_func;
+    return sink;
+  }
+};
+
+enum class HttpMethod {
+  GET = 0,
+  POST = 1,
+};
+
+struct HttpRequest {
+  HttpMethod method = HttpMethod::GET;
+  std::string url;
+  // POST 请求的 body, eg: param1=val1&param2=val2
+  std::string body;
+  // 额外的请求头, eg: "Content-Type: application/json"
+  std::vector<std::string> headers;
+  // 传输超时时间
+  int timeout_ms = 1000;
+  // 连接超时时间
+  int conn_timeout_ms = 200;
+  // 响应 body 的写入目标
+  ResponseSink sink;
+};
+
+// 请求各阶段的耗时, 单位: 微秒, 均为从请求开始到该阶段结束的累计耗时, 单调递增
+// 没有经历的阶段等于前一阶段, eg: 复用连接时 connect 等于 dns, 非 https 请求 tls 等于 connect
+struct HttpTiming {
+  int64_t dns_us = 0;      // DNS 解析完成
+  int64_t connect_us = 0;  // TCP 连接建立
+  int64_t tls_us = 0;      // TLS 握手完成
+  int64_t ttfb_us = 0;     // 收到第一个字节
+  int64_t total_us = 0;    // 请求结束
+};
+
+struct HttpResponse {
+  // CURLcode, 0 表示请求成功
+  int code = 0;
+  // Http 状态码, eg: 200
+  int64_t status_code = 0;
+  // 仅在 sink 为 STRING 时有内容
+  std::string body;
+  // 写入 sink 的 body 字节数
+  std::size_t body_size = 0;
+  HttpTiming timing;
+};
+
+/**
+ * @brief 基于 curl multi 的异步 Http 客户端
+ *
+ * 1. 所有请求共享一个 CURLM, 由单个事件线程驱动, 调用方线程不会阻塞在网络 IO 上
+ * 2. CURLM 内部维护连接缓存, 同一 host 的请求会复用 keep-alive 连接, 避免重复的 TCP 和 TLS 握手
+ * 3. easy handle 在请求结束后 reset 并放回池中复用, 避免每个请求都 curl_easy_init / curl_easy_cleanup
+ */
+class HttpClient {
+ public:
+  struct Options {
+    // 每个 host 的最大连接数, 超过后新请求在 CURLM 内部排队, 0 表示不限制
+    int64_t max_host_connections = 8;
+    // 最大并发连接数, 0 表示不限制
+    int64_t max_total_connections = 64;
+    // 连接缓存中最多保留的空闲连接数
+    int64_t max_idle_connections = 64;
+    // easy handle 池中最多保留的空闲 handle 数
+    uint32_t max_idle_handles = 64;
+    // CA 证书的路径, 为空时不验证服务器端证书的有效性
+    std::string ca_path;
+  };
+
+  // 回调在事件线程中执行, 不要在回调中做耗时操作
+  using Callback = std::function<void(HttpResponse* const response)>;
+
+ public:
+  HttpClient();
+  explicit HttpClient(const Options& options);
+  ~HttpClient();
+
+ public:
+  /**
+   * @brief 启动事件线程
+   *
+   * @return bool 启动是否成功
+   */
+  bool Start();
+
+  /**
+   * @brief 停止事件线程, 尚未完成的请求以 CURLE_ABORTED_BY_CALLBACK 结束
+   *
+   */
+  void Stop();
+
+  /**
+   * @brief 发送异步请求, 请求完成后在事件线程中执行回调
+   *
+   * @param request
+   * @param callback
+   */
+  void AsyncDo(const HttpRequest& request, const Callback& callback);
+
+  /**
+   * @brief 发送异步请求, 通过 std::future 获取结果
+   *
+   * @param request
+   * @return std::future<HttpResponse>
+   */
+  std::future<HttpResponse> AsyncDo(const HttpRequest& request);
+
+  /**
+   * @brief 发送同步请求, 阻塞直至请求完成, 和 AsyncDo 共享连接池
+   *
+   * @param request
+   * @param response 输出参数
+   * @return int CURLcode, 0 表示成功
+   */
+  int Do(const HttpRequest& request, HttpResponse* const response);
+
+  /**
+   * @brief 批量并发请求, 所有请求都在事件线程上并发执行, 阻塞直至全部完成或者到达 deadline
+   *
+   * 每个请求的超时时间会被截断到发起请求时剩余的 deadline 以内, timeout_ms 为 0 时直接使用剩余的 deadline
+   * 到达 deadline 时在事件线程中中止未完成的请求(code 为 CURLE_OPERATION_TIMEDOUT)并等待中止完成,
+   * 返回之后不会再有数据写入请求的 sink
+   *
+   * @param requests
+   * @param deadline_ms 整批请求的最长耗时
+   * @param responses 输出参数, 和 requests 一一对应
+   * @return int 成功的请求数
+   */
+  int BatchDo(const std::vector<HttpRequest>& requests, int deadline_ms, std::vector<HttpResponse>* const responses);
+
+ private:
+  struct Transfer;
+
+ private:
+  void run_event_loop();
+  // 在事件线程中执行 task, HttpClient 已经停止时丢弃
+  void run_in_event_loop(const std::function<void()>& task);
+  // 中止 group 中所有已经加入 CURLM 的请求, 只能在事件线程中调用
+  void abort_transfers(const void* group, int code);
+  Transfer* create_transfer(const HttpRequest& request, const Callback& callback);
+  void submit_transfer(Transfer* transfer);
+  void finish_transfer(Transfer* transfer, int code);
+  void* acquire_easy_handle();
+  void release_easy_handle(void* easy);
+
+ private:
+  Options options_;
+
+  // CURLM*, 避免在头文件中引入 curl/curl.h
+  void* multi_handle_ = nullptr;
+
+  std::atomic<bool> is_stop_ = {true};
+  std::thread event_thread_;
+
+  // 等待事件线程加入 CURLM 的请求
+  std::mutex pending_mtx_;
+  std::vector<Transfer*> pending_transfers_;
+  std::vector<std::function<void()>> pending_tasks_;
+
+  // 已经加入 CURLM 的请求, 只在事件线程中访问
+  std::unordered_set<Transfer*> running_transfers_;
+
+  // 空闲的 easy handle 池
+  std::mutex handle_pool_mtx_;
+  std::vector<void*> idle_handles_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpClient)
+};
+
 }  // namespace http_client
@@ -0,0 +1,426 @@
+#include "http/http_client/http_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "curl/curl.h"
+#include "gtest/gtest.h"
+
+namespace http_client {
+
+namespace {
+
+/**
+ * @brief 本地的 Http/1.1 服务器, 每个连接一个线程, 支持 keep-alive
+ *
+ * /hello    Content-Length 为 5 的 "hello"
+ * /big      Content-Length 为 4096 的 body
+ * /chunked  没有 Content-Length 的 4096 字节 body, 发送后关闭连接
+ * /slow     Content-Length 很大, 每 20ms 发送 10 字节, 直到连接断开
+ * /hang     不返回响应, 直到连接断开或者服务器停止
+ */
+class LocalServer {
+ public:
+  LocalServer() {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    ::listen(listen_fd_, 128);
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = std::thread(&LocalServer::AcceptLoop, this);
+  }
+
+  ~LocalServer() {
+    Stop();
+  }
+
+  void Stop() {
+    if (stop_.exchange(true)) {
+      return;
+    }
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      for (int fd : conn_fds_) {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (auto&& thread : conn_threads_) {
+      thread.join();
+    }
+    for (int fd : conn_fds_) {
+      ::close(fd);
+    }
+    ::close(listen_fd_);
+  }
+
+  std::string Url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(port_) + path;
+  }
+
+  int accepted() const {
+    return accepted_.load();
+  }
+
+ private:
+  void AcceptLoop() {
+    while (!stop_) {
+      int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mtx_);
+      ++accepted_;
+      conn_fds_.push_back(fd);
+      conn_threads_.emplace_back(&LocalServer::Serve, this, fd);
+    }
+  }
+
+  void Serve(int fd) {
+    std::string buffer;
+    char data[4096];
+    while (!stop_) {
+      size_t header_end = buffer.find("\r\n\r\n");
+      if (header_end == std::string::npos) {
+        ssize_t n = ::recv(fd, data, sizeof(data), 0);
+        if (n <= 0) {
+          break;
+        }
+        buffer.append(data, n);
+        continue;
+      }
+      // 请求行: GET /path HTTP/1.1
+      size_t path_begin = buffer.find(' ') + 1;
+      std::string path = buffer.substr(path_begin, buffer.find(' ', path_begin) - path_begin);
+      buffer.erase(0, header_end + 4);
+      if (!Handle(fd, path)) {
+        break;
+      }
+    }
+    // fd 在 Stop 中关闭, 这里只断开连接
+    ::shutdown(fd, SHUT_RDWR);
+  }
+
+  // 返回 false 时关闭连接
+  bool Handle(int fd, const std::string& path) {
+    if (path == "/hello") {
+      return Send(fd, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+    }
+    if (path == "/big") {
+      return Send(fd, "HTTP/1.1 200 OK\r\nContent-Length: 4096\r\n\r\n" + std::string(4096, 'x'));
+    }
+    if (path == "/chunked") {
+      Send(fd, "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + std::string(4096, 'x'));
+      return false;
+    }
+    if (path == "/slow") {
+      if (!Send(fd, "HTTP/1.1 200 OK\r\nContent-Length: 1000000\r\n\r\n")) {
+        return false;
+      }
+      while (!stop_ && Send(fd, std::string(10, 'x'))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      return false;
+    }
+    if (path == "/hang") {
+      // 对端关闭连接时 fd 可读
+      struct pollfd pfd = {fd, POLLIN, 0};
+      while (!stop_ && ::poll(&pfd, 1, 20) == 0) {
+      }
+      return false;
+    }
+    return Send(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+  }
+
+  static bool Send(int fd, const std::string& data) {
+    return ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+  }
+
+ private:
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::atomic<bool> stop_ = {false};
+  std::atomic<int> accepted_ = {0};
+  std::thread accept_thread_;
+  std::mutex mtx_;
+  std::vector<int> conn_fds_;
+  std::vector<std::thread> conn_threads_;
+};
+
+int64_t ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TEST(HttpClientTest, async_do) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  HttpRequest request;
+  request.url = server.Url("/hello");
+
+  // 回调在事件线程中执行
+  std::promise<std::pair<int, std::string>> promise;
+  std::thread::id caller_id = std::this_thread::get_id();
+  std::atomic<bool> in_caller_thread = {true};
+  client.AsyncDo(request, [&](HttpResponse* const response) {
+    in_caller_thread = std::this_thread::get_id() == caller_id;
+    promise.set_value({response->code, response->body});
+  });
+  auto result = promise.get_future().get();
+  ASSERT_EQ(result.first, CURLE_OK);
+  ASSERT_EQ(result.second, "hello");
+  ASSERT_FALSE(in_caller_thread);
+
+  std::vector<std::future<HttpResponse>> futures;
+  for (int i = 0; i < 8; ++i) {
+    futures.push_back(client.AsyncDo(request));
+  }
+  for (auto&& future : futures) {
+    HttpResponse response = future.get();
+    ASSERT_EQ(response.code, CURLE_OK);
+    ASSERT_EQ(response.status_code, 200);
+    ASSERT_EQ(response.body, "hello");
+  }
+
+  HttpResponse response;
+  request.url = server.Url("/not_found");
+  ASSERT_EQ(client.Do(request, &response), CURLE_OK);
+  ASSERT_EQ(response.status_code, 404);
+  client.Stop();
+
+  // 停止之后的请求直接失败
+  request.url = server.Url("/hello");
+  ASSERT_EQ(client.AsyncDo(request).get().code, CURLE_FAILED_INIT);
+}
+
+TEST(HttpClientTest, connection_reuse) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  HttpRequest request;
+  request.url = server.Url("/hello");
+  for (int i = 0; i < 5; ++i) {
+    HttpResponse response;
+    ASSERT_EQ(client.Do(request, &response), CURLE_OK);
+    ASSERT_EQ(response.body, "hello");
+  }
+  // 顺序的请求复用同一个 keep-alive 连接
+  ASSERT_EQ(server.accepted(), 1);
+  client.Stop();
+}
+
+TEST(HttpClientTest, stop_aborts_in_flight) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  HttpRequest request;
+  request.url = server.Url("/hang");
+  request.timeout_ms = 10000;
+  std::vector<std::future<HttpResponse>> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures.push_back(client.AsyncDo(request));
+  }
+  // 等待请求发出
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto start = std::chrono::steady_clock::now();
+  client.Stop();
+  ASSERT_LT(ElapsedMs(start), 2000);
+  for (auto&& future : futures) {
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    ASSERT_EQ(future.get().code, CURLE_ABORTED_BY_CALLBACK);
+  }
+}
+
+TEST(HttpClientTest, batch_do_deadline) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  std::atomic<size_t> received = {0};
+  std::vector<HttpRequest> requests(3);
+  requests[0].url = server.Url("/hello");
+  requests[1].url = server.Url("/slow");
+  requests[1].timeout_ms = 10000;
+  requests[1].sink = ResponseSink::Stream([&received](const char*, std::size_t size) {
+    received += size;
+    return true;
+  });
+  // 0 不能被当作 curl 的不超时
+  requests[2].url = server.Url("/hang");
+  requests[2].timeout_ms = 0;
+  requests[2].conn_timeout_ms = 0;
+
+  std::vector<HttpResponse> responses;
+  auto start = std::chrono::steady_clock::now();
+  int success_cnt = client.BatchDo(requests, 300, &responses);
+  ASSERT_LT(ElapsedMs(start), 2000);
+  ASSERT_EQ(success_cnt, 1);
+  ASSERT_EQ(responses.size(), 3u);
+  ASSERT_EQ(responses[0].code, CURLE_OK);
+  ASSERT_EQ(responses[0].body, "hello");
+  ASSERT_EQ(responses[1].code, CURLE_OPERATION_TIMEDOUT);
+  ASSERT_EQ(responses[2].code, CURLE_OPERATION_TIMEDOUT);
+
+  // 返回之后未完成的请求已经被中止, 不会再写入 sink
+  size_t received_at_return = received.load();
+  ASSERT_GT(received_at_return, 0u);
+  ASSERT_EQ(responses[1].body_size, received_at_return);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_EQ(received.load(), received_at_return);
+
+  // 所有请求都在 deadline 之前完成时不等待 deadline
+  requests.assign(4, HttpRequest());
+  for (auto&& request : requests) {
+    request.url = server.Url("/hello");
+  }
+  start = std::chrono::steady_clock::now();
+  ASSERT_EQ(client.BatchDo(requests, 5000, &responses), 4);
+  ASSERT_LT(ElapsedMs(start), 2000);
+  client.Stop();
+}
+
+TEST(HttpClientTest, buffer_sink) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  std::vector<char> buffer(8192);
+  HttpRequest request;
+  request.url = server.Url("/big");
+  request.sink = ResponseSink::Buffer(buffer.data(), buffer.size());
+  HttpResponse response = client.AsyncDo(request).get();
+  ASSERT_EQ(response.code, CURLE_OK);
+  ASSERT_EQ(response.body_size, 4096u);
+  ASSERT_TRUE(response.body.empty());
+  ASSERT_EQ(std::string(buffer.data(), 4096), std::string(4096, 'x'));
+
+  // Content-Length 超过容量时在写入之前失败
+  request.sink = ResponseSink::Buffer(buffer.data(), 1024);
+  response = client.AsyncDo(request).get();
+  ASSERT_EQ(response.code, CURLE_WRITE_ERROR);
+  ASSERT_EQ(response.body_size, 0u);
+
+  // 没有 Content-Length 时在写满之后失败
+  request.url = server.Url("/chunked");
+  response = client.AsyncDo(request).get();
+  ASSERT_EQ(response.code, CURLE_WRITE_ERROR);
+  ASSERT_LE(response.body_size, 1024u);
+  client.Stop();
+}
+
+TEST(HttpClientTest, fd_sink) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  char path[] = "/tmp/http_client_test_XXXXXX";
+  int fd = ::mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ::unlink(path);
+
+  HttpRequest request;
+  request.url = server.Url("/chunked");
+  request.sink = ResponseSink::Fd(fd);
+  HttpResponse response = client.AsyncDo(request).get();
+  ASSERT_EQ(response.code, CURLE_OK);
+  ASSERT_EQ(response.body_size, 4096u);
+
+  std::string content(8192, '\0');
+  ASSERT_EQ(::pread(fd, &content[0], content.size(), 0), 4096);
+  content.resize(4096);
+  ASSERT_EQ(content, std::string(4096, 'x'));
+  ::close(fd);
+  client.Stop();
+}
+
+TEST(HttpClientTest, stream_sink) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  std::string received;
+  HttpRequest request;
+  request.url = server.Url("/big");
+  request.sink = ResponseSink::Stream([&received](const char* data, std::size_t size) {
+    received.append(data, size);
+    return true;
+  });
+  HttpResponse response = client.AsyncDo(request).get();
+  ASSERT_EQ(response.code, CURLE_OK);
+  ASSERT_EQ(received, std::string(4096, 'x'));
+
+  // 返回 false 时中止请求, 之后不再回调
+  int calls = 0;
+  request.url = server.Url("/slow");
+  request.timeout_ms = 10000;
+  request.sink = ResponseSink::Stream([&calls](const char*, std::size_t) {
+    return ++calls < 3;
+  });
+  auto start = std::chrono::steady_clock::now();
+  response = client.AsyncDo(request).get();
+  ASSERT_LT(ElapsedMs(start), 2000);
+  ASSERT_EQ(response.code, CURLE_WRITE_ERROR);
+  ASSERT_EQ(calls, 3);
+  client.Stop();
+}
+
+TEST(HttpClientTest, null_response) {
+  LocalServer server;
+
+  // 没有写入目标时请求失败, 不会访问空指针
+  ASSERT_EQ(Get(server.Url("/hello"), 1000, 1000, nullptr), CURLE_WRITE_ERROR);
+  ASSERT_EQ(Post(server.Url("/hello"), "a=1", 1000, 1000, nullptr), CURLE_WRITE_ERROR);
+
+  std::string resp;
+  ASSERT_EQ(Get(server.Url("/hello"), 1000, 1000, &resp), CURLE_OK);
+  ASSERT_EQ(resp, "hello");
+}
+
+TEST(HttpClientTest, timing) {
+  LocalServer server;
+  HttpClient client;
+  ASSERT_TRUE(client.Start());
+
+  HttpRequest request;
+  request.url = server.Url("/big");
+  for (int i = 0; i < 2; ++i) {
+    HttpResponse response;
+    ASSERT_EQ(client.Do(request, &response), CURLE_OK);
+    const HttpTiming& timing = response.timing;
+    // 各阶段都是从请求开始的累计耗时, 第二次请求复用连接, 非 https 请求没有 TLS 握手
+    ASSERT_GE(timing.dns_us, 0);
+    ASSERT_LE(timing.dns_us, timing.connect_us);
+    ASSERT_EQ(timing.tls_us, timing.connect_us);
+    ASSERT_LE(timing.tls_us, timing.ttfb_us);
+    ASSERT_LE(timing.ttfb_us, timing.total_us);
+    ASSERT_GT(timing.total_us, 0);
+  }
+  client.Stop();
+}
+
+}  // namespace http_client
@@ -18,6 +18,13 @@ $curl "127.0.0.1:8888/echo?name=tomocat"
 int main() {
   http_server::HttpServer http_server(8888);
   http_server.RegisterHandler("/echo", echo);
+
+  // 超过 1KB 的响应按照 Accept-Encoding 压缩, 并缓存最近 128 个压缩结果
+  http_server::CompressOption compress_option;
+  compress_option.min_size = 1024;
+  compress_option.level = 6;
+  compress_option.cache_capacity = 128;
+  http_server.EnableCompression(compress_option);
   http_server.Start();
   return 0;
 }
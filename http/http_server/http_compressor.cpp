@@ -0,0 +1,188 @@
+#include "http/http_server/http_compressor.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <utility>
+
+#include "logger/log.h"
+#include "util/string/string_util.h"
+
+namespace http_server {
+
+namespace {
+
+// zlib 的 windowBits, 加上 16 表示输出 gzip 格式的头部和尾部
+constexpr int kZlibWindowBits = 15;
+constexpr int kGzipWindowBits = kZlibWindowBits + 16;
+constexpr int kZlibMemLevel = 8;
+
+}  // namespace
+
+HttpCompressor::HttpCompressor(const CompressOption& option) : option_(option) {
+  if (option_.level < Z_BEST_SPEED || option_.level > Z_BEST_COMPRESSION) {
+    LogWarn("invalid compress level %d, use default level %d instead", option_.level, Z_DEFAULT_COMPRESSION);
+    option_.level = Z_DEFAULT_COMPRESSION;
+  }
+}
+
+ContentEncoding HttpCompressor::Negotiate(const std::string& accept_encoding) {
+  // 每种编码的 q 值, 小于 0 表示请求头中没有提到该编码
+  double gzip_q = -1;
+  double deflate_q = -1;
+  double identity_q = -1;
+  double star_q = -1;
+
+  // eg: "gzip, deflate;q=0.5, br", q=0 表示客户端明确拒绝该编码
+  std::stringstream ss(accept_encoding);
+  std::string token;
+  while (std::getline(ss, token, ',')) {
+    std::string coding = token;
+    double quality = 1.0;
+    std::size_t pos = token.find(';');
+    if (pos != std::string::npos) {
+      coding = token.substr(0, pos);
+      std::size_t q_pos = token.find("q=", pos);
+      if (q_pos != std::string::npos) {
+        quality = std::atof(token.c_str() + q_pos + 2);
+      }
+    }
+    util::trim(&coding);
+    std::transform(coding.begin(), coding.end(), coding.begin(), ::tolower);
+    if (coding == "gzip" || coding == "x-gzip") {
+      gzip_q = std::max(gzip_q, quality);
+    } else if (coding == "deflate") {
+      deflate_q = std::max(deflate_q, quality);
+    } else if (coding == "identity") {
+      identity_q = std::max(identity_q, quality);
+    } else if (coding == "*") {
+      star_q = std::max(star_q, quality);
+    }
+  }
+
+  // RFC 9110 12.5.3: * 只作用于请求头中没有提到的编码, 没有提到且没有 * 时压缩编码不可接受
+  // identity 默认可接受但没有权重, 只有明确给出更高的 q 值时才优先于压缩编码
+  auto resolve = [star_q](double quality, double default_quality) {
+    if (quality >= 0) {
+      return quality;
+    }
+    return star_q >= 0 ? star_q : default_quality;
+  };
+  gzip_q = resolve(gzip_q, 0);
+  deflate_q = resolve(deflate_q, 0);
+  identity_q = resolve(identity_q, 0);
+
+  // 选择 q 值最高的编码, q 值相同时依次优先 gzip、deflate
+  if (gzip_q > 0 && gzip_q >= deflate_q && gzip_q >= identity_q) {
+    return ContentEncoding::GZIP;
+  }
+  if (deflate_q > 0 && deflate_q >= identity_q) {
+    return ContentEncoding::DEFLATE;
+  }
+  return ContentEncoding::IDENTITY;
+}
+
+const char* HttpCompressor::EncodingName(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::GZIP:
+      return "gzip";
+    case ContentEncoding::DEFLATE:
+      return "deflate";
+    default:
+      return "identity";
+  }
+}
+
+int HttpCompressor::Compress(ContentEncoding encoding, const std::string& body, std::string* const output) {
+  if (encoding == ContentEncoding::IDENTITY) {
+    LogError("identity encoding doesn't need to compress");
+    return -1;
+  }
+
+  if (option_.cache_capacity == 0) {
+    return deflate_body(encoding, body, output);
+  }
+
+  uint64_t key = cache_key(encoding, body);
+  if (lookup_cache(key, encoding, body, output)) {
+    return 0;
+  }
+  int ret = deflate_body(encoding, body, output);
+  CHECK_RET(ret);
+  insert_cache(key, encoding, body, *output);
+  return 0;
+}
+
+int HttpCompressor::deflate_body(ContentEncoding encoding, const std::string& body, std::string* const output) {
+  z_stream stream;
+  ::memset(&stream, 0, sizeof(stream));
+  int window_bits = encoding == ContentEncoding::GZIP ? kGzipWindowBits : kZlibWindowBits;
+  int ret = deflateInit2(&stream, option_.level, Z_DEFLATED, window_bits, kZlibMemLevel, Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK) {
+    LogError("deflateInit2() fail, ret:%d", ret);
+    return -1;
+  }
+
+  // deflateBound 给出压缩结果的上界, 一次性分配好输出空间后只需调用一次 deflate
+  output->resize(deflateBound(&stream, body.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+  stream.avail_in = body.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream.avail_out = output->size();
+
+  ret = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (ret != Z_STREAM_END) {
+    LogError("deflate() fail, ret:%d body_size:%lu", ret, body.size());
+    output->clear();
+    return -1;
+  }
+  output->resize(stream.total_out);
+  return 0;
+}
+
+uint64_t HttpCompressor::cache_key(ContentEncoding encoding, const std::string& body) {
+  uint64_t hash = std::hash<std::string>()(body);
+  return hash ^ (static_cast<uint64_t>(encoding) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+bool HttpCompressor::lookup_cache(uint64_t key, ContentEncoding encoding, const std::string& body,
+                                  std::string* const output) {
+  std::lock_guard<std::mutex> lock(cache_mtx_);
+  auto iter = cache_index_.find(key);
+  if (iter == cache_index_.end()) {
+    return false;
+  }
+  const CacheEntry& entry = *(iter->second);
+  if (entry.encoding != encoding || entry.raw != body) {
+    return false;
+  }
+  *output = entry.compressed;
+  lru_list_.splice(lru_list_.begin(), lru_list_, iter->second);
+  return true;
+}
+
+void HttpCompressor::insert_cache(uint64_t key, ContentEncoding encoding, const std::string& body,
+                                  const std::string& compressed) {
+  std::lock_guard<std::mutex> lock(cache_mtx_);
+  auto iter = cache_index_.find(key);
+  if (iter != cache_index_.end()) {
+    lru_list_.erase(iter->second);
+    cache_index_.erase(iter);
+  }
+
+  lru_list_.push_front(CacheEntry{key, encoding, body, compressed});
+  cache_index_[key] = lru_list_.begin();
+
+  while (lru_list_.size() > option_.cache_capacity) {
+    cache_index_.erase(lru_list_.back().key);
+    lru_list_.pop_back();
+  }
+}
+
+}  // namespace http_server
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "util/macro_util.h"
+
+namespace http_server {
+
+enum class ContentEncoding {
+  IDENTITY = 0,
+  GZIP = 1,
+  DEFLATE = 2,
+};
+
+struct CompressOption {
+  // body 小于该值时不压缩, 小包压缩的收益抵不上 CPU 开销和压缩头部的额外字节
+  std::size_t min_size = 1024;
+  // zlib 压缩等级, 取值 [1, 9], 等级越高压缩率越高, CPU 开销也越大
+  int level = 6;
+  // 已压缩 body 的 LRU 缓存条数, 0 表示不开启缓存
+  std::size_t cache_capacity = 0;
+};
+
+/**
+ * @brief 基于 zlib 的 Http 响应压缩器, 支持 gzip 和 deflate 两种 Content-Encoding
+ *
+ * 开启缓存后以 body 的哈希值为 key 缓存压缩结果, 重复的响应 body 可以直接命中缓存而无需再次压缩
+ */
+class HttpCompressor {
+ public:
+  explicit HttpCompressor(const CompressOption& option);
+  ~HttpCompressor() = default;
+
+ public:
+  /**
+   * @brief 根据请求头 Accept-Encoding 协商压缩方式, 选择 q 值最高的编码, q 值相同时优先选择 gzip
+   *
+   * "*" 只作用于请求头中没有提到的编码, eg: "gzip;q=0, *" 拒绝 gzip, 接受 deflate
+   *
+   * @param accept_encoding 请求头 Accept-Encoding 的值, eg: "gzip, deflate;q=0.5"
+   * @return ContentEncoding 客户端不支持压缩或者 identity 的 q 值更高时返回 IDENTITY
+   */
+  static ContentEncoding Negotiate(const std::string& accept_encoding);
+
+  /**
+   * @brief 返回 Content-Encoding 响应头对应的值, eg: "gzip"
+   */
+  static const char* EncodingName(ContentEncoding encoding);
+
+  /**
+   * @brief 压缩 body, 开启缓存时会优先查缓存
+   *
+   * @param encoding 压缩方式, 不能是 IDENTITY
+   * @param body 待压缩内容
+   * @param output 输出参数, 压缩后的内容
+   * @return int 成功返回 0
+   */
+  int Compress(ContentEncoding encoding, const std::string& body, std::string* const output);
+
+  const CompressOption& option() const {
+    return option_;
+  }
+
+ private:
+  struct CacheEntry {
+    uint64_t key;
+    ContentEncoding encoding;
+    // 保留原始 body 用于比对, 防止哈希冲突时返回错误的压缩结果
+    std::string raw;
+    std::string compressed;
+  };
+
+ private:
+  int deflate_body(ContentEncoding encoding, const std::string& body, std::string* const output);
+  static uint64_t cache_key(ContentEncoding encoding, const std::string& body);
+  bool lookup_cache(uint64_t key, ContentEncoding encoding, const std::string& body, std::string* const output);
+  void insert_cache(uint64_t key, ContentEncoding encoding, const std::string& body, const std::string& compressed);
+
+ private:
+  CompressOption option_;
+
+  std::mutex cache_mtx_;
+  // 链表头部为最近使用的元素
+  std::list<CacheEntry> lru_list_;
+  std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> cache_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpCompressor)
+};
+
+}  // namespace http_server
@@ -0,0 +1,115 @@
+#include "http/http_server/http_compressor.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace http_server {
+
+namespace {
+
+// 用 zlib 解压, gzip 和 deflate 格式都能自动识别
+std::string Inflate(const std::string& compressed) {
+  z_stream stream;
+  ::memset(&stream, 0, sizeof(stream));
+  // windowBits 加上 32 表示自动识别 gzip 和 zlib 头部
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+    return "";
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+
+  std::string output;
+  char buffer[4096];
+  int ret;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    ret = inflate(&stream, Z_NO_FLUSH);
+    output.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (ret == Z_OK);
+  inflateEnd(&stream);
+  return ret == Z_STREAM_END ? output : "";
+}
+
+}  // namespace
+
+TEST(HttpCompressorTest, negotiate) {
+  // 没有提到压缩编码时不压缩
+  ASSERT_EQ(HttpCompressor::Negotiate(""), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("identity"), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("br"), ContentEncoding::IDENTITY);
+
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("x-gzip"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("deflate"), ContentEncoding::DEFLATE);
+  ASSERT_EQ(HttpCompressor::Negotiate("GZIP"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("deflate, gzip"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip, deflate, br"), ContentEncoding::GZIP);
+
+  // q 值
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip, deflate;q=0.5"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0.4, deflate;q=0.5"), ContentEncoding::DEFLATE);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0, deflate"), ContentEncoding::DEFLATE);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0, deflate;q=0"), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0.5, identity"), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0.5, identity;q=0"), ContentEncoding::GZIP);
+
+  // * 只作用于没有提到的编码
+  ASSERT_EQ(HttpCompressor::Negotiate("*"), ContentEncoding::GZIP);
+  ASSERT_EQ(HttpCompressor::Negotiate("*;q=0"), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0, *"), ContentEncoding::DEFLATE);
+  ASSERT_EQ(HttpCompressor::Negotiate("*, gzip;q=0"), ContentEncoding::DEFLATE);
+  ASSERT_EQ(HttpCompressor::Negotiate("gzip;q=0, deflate;q=0, *"), ContentEncoding::IDENTITY);
+  ASSERT_EQ(HttpCompressor::Negotiate("deflate, *;q=0.5"), ContentEncoding::DEFLATE);
+}
+
+TEST(HttpCompressorTest, compress) {
+  std::string body;
+  for (int i = 0; i < 1000; ++i) {
+    body += "hello world " + std::to_string(i) + "\n";
+  }
+
+  CompressOption option;
+  HttpCompressor compressor(option);
+  std::string output;
+  ASSERT_NE(compressor.Compress(ContentEncoding::IDENTITY, body, &output), 0);
+  for (ContentEncoding encoding : {ContentEncoding::GZIP, ContentEncoding::DEFLATE}) {
+    ASSERT_EQ(compressor.Compress(encoding, body, &output), 0);
+    ASSERT_LT(output.size(), body.size());
+    ASSERT_EQ(Inflate(output), body);
+  }
+  // gzip 格式的魔数
+  ASSERT_EQ(compressor.Compress(ContentEncoding::GZIP, body, &output), 0);
+  ASSERT_EQ(output.substr(0, 2), "\x1f\x8b");
+
+  ASSERT_EQ(compressor.Compress(ContentEncoding::GZIP, "", &output), 0);
+  ASSERT_EQ(Inflate(output), "");
+}
+
+TEST(HttpCompressorTest, cache) {
+  CompressOption option;
+  option.cache_capacity = 2;
+  HttpCompressor compressor(option);
+
+  std::string bodies[] = {std::string(2048, 'a'), std::string(2048, 'b'), std::string(2048, 'c')};
+  std::string first;
+  std::string output;
+  for (int round = 0; round < 2; ++round) {
+    for (auto&& body : bodies) {
+      for (ContentEncoding encoding : {ContentEncoding::GZIP, ContentEncoding::DEFLATE}) {
+        ASSERT_EQ(compressor.Compress(encoding, body, &output), 0);
+        ASSERT_EQ(Inflate(output), body);
+      }
+    }
+  }
+  // 命中缓存时结果和重新压缩一致
+  ASSERT_EQ(compressor.Compress(ContentEncoding::GZIP, bodies[2], &first), 0);
+  ASSERT_EQ(compressor.Compress(ContentEncoding::GZIP, bodies[2], &output), 0);
+  ASSERT_EQ(first, output);
+}
+
+}  // namespace http_server
@@ -117,6 +117,42 @@ int HttpEpollEventHandler::handle_http_request(HttpRequest* req, HttpResponse* r
   uri2handler[uri](req, resp);
   LogInfo("handler http request successfully! code:%d msg:%s", resp->status_line.stauts_code,
           resp->status_line.msg.c_str());
+
+  // 在处理请求的阶段一次性完成压缩, 后续 OnWriteable 只负责分段发送
+  if (compressor) {
+    compress_response(req, resp);
+  }
+  return 0;
+}
+
+int HttpEpollEventHandler::compress_response(HttpRequest* req, HttpResponse* resp) {
+  if (resp->body.size() < compressor->option().min_size) {
+    return 0;
+  }
+  // handler 已经自行设置了编码
+  if (resp->headers.find("Content-Encoding") != resp->headers.end()) {
+    return 0;
+  }
+
+  auto iter = req->headers.find("Accept-Encoding");
+  if (iter == req->headers.end()) {
+    return 0;
+  }
+  ContentEncoding encoding = HttpCompressor::Negotiate(iter->second);
+  if (encoding == ContentEncoding::IDENTITY) {
+    return 0;
+  }
+
+  std::string compressed;
+  if (compressor->Compress(encoding, resp->body, &compressed)) {
+    LogError("compress response fail, uri:%s encoding:%s", req->uri.c_str(), HttpCompressor::EncodingName(encoding));
+    return -1;
+  }
+  LogInfo("compress response successfully! uri:%s encoding:%s size:%lu->%lu", req->uri.c_str(),
+          HttpCompressor::EncodingName(encoding), resp->body.size(), compressed.size());
+  resp->body.swap(compressed);
+  resp->headers["Content-Encoding"] = HttpCompressor::EncodingName(encoding);
+  resp->headers["Vary"] = "Accept-Encoding";
   return 0;
 }
 
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "http/http_server/epoll_event_handler.h"
+#include "http/http_server/http_compressor.h"
 #include "http/http_server/http_request.h"
 #include "http/http_server/http_response.h"
 
@@ -33,9 +34,12 @@ class HttpEpollEventHandler : public EpollEventHandler {
 
  public:
   std::map<std::string, HttpHandler> uri2handler;
+  // 为空时不压缩响应
+  HttpCompressor* compressor = nullptr;
 
  private:
   int handle_http_request(HttpRequest* req, HttpResponse* resp);
+  int compress_response(HttpRequest* req, HttpResponse* resp);
 };
 
 }  // namespace http_server
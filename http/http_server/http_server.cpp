@@ -22,6 +22,10 @@ HttpServer::~HttpServer() {
     delete epoll_socket_;
     epoll_socket_ = nullptr;
   }
+  if (compressor_) {
+    delete compressor_;
+    compressor_ = nullptr;
+  }
 }
 
 int HttpServer::Start() {
@@ -33,4 +37,12 @@ void HttpServer::RegisterHandler(std::string path, HttpHandler handler) {
   epoll_event_handler_->uri2handler[path] = handler;
 }
 
+void HttpServer::EnableCompression(const CompressOption& option) {
+  if (compressor_) {
+    delete compressor_;
+  }
+  compressor_ = new HttpCompressor(option);
+  epoll_event_handler_->compressor = compressor_;
+}
+
 }  // namespace http_server
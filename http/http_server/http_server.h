@@ -4,6 +4,7 @@
 #include <unordered_map>
 
 #include "http/http_server/epoll_socket.h"
+#include "http/http_server/http_compressor.h"
 #include "http/http_server/http_epoll_event_handler.h"
 
 namespace http_server {
@@ -28,6 +29,12 @@ class HttpServer {
    * @param handler
    */
   void RegisterHandler(std::string path, HttpHandler handler);
+  /**
+   * @brief 开启响应压缩, 根据请求头 Accept-Encoding 协商使用 gzip 或 deflate, 需要在 Start 之前调用
+   *
+   * @param option 压缩阈值、压缩等级和压缩结果缓存容量
+   */
+  void EnableCompression(const CompressOption& option);
   /**
    * @brief 阻塞式启动Http服务
    *
@@ -38,6 +45,7 @@ class HttpServer {
  private:
   HttpEpollEventHandler* epoll_event_handler_;
   EpollSocket* epoll_socket_;
+  HttpCompressor* compressor_ = nullptr;
 };
 
 }  // namespace http_server
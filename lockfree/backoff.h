@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+
+namespace cpputil {
+namespace lock_free {
+
+// 自旋等待时提示 CPU, 降低功耗并让出超线程的执行资源
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 指数退避, CAS 失败后调用 Pause, 每次等待的时间翻倍, 超过上限后让出 CPU
+ *
+ * eg:
+ *     ExponentialBackoff backoff;
+ *     while (!head.compare_exchange_weak(...)) {
+ *       backoff.Pause();
+ *     }
+ */
+class ExponentialBackoff {
+ public:
+  explicit ExponentialBackoff(uint32_t min_spins = 4, uint32_t max_spins = 1024)
+      : min_spins_(min_spins), max_spins_(max_spins), spins_(min_spins) {
+  }
+
+ public:
+  void Pause() {
+    if (spins_ > max_spins_) {
+      std::this_thread::yield();
+      return;
+    }
+    for (uint32_t i = 0; i < spins_; ++i) {
+      CpuRelax();
+    }
+    spins_ *= 2;
+  }
+
+  void Reset() {
+    spins_ = min_spins_;
+  }
+
+ private:
+  uint32_t min_spins_;
+  uint32_t max_spins_;
+  uint32_t spins_;
+};
+
+}  // namespace lock_free
+}  // namespace cpputil
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lockfree/lockfree_stack.h"
+
+/**
+ * 对比 LockFreeStack 和 std::mutex + std::vector 在 1..N 个线程下的吞吐
+ *
+ * 每个线程循环执行 Push + Pop, 模拟对象池的空闲链表: 取出一个对象, 用完后放回
+ *
+ * $./lockfree_stack_benchmark [max_threads]
+ */
+namespace {
+
+constexpr int kOpsPerThread = 1000000;
+
+class MutexStack {
+ public:
+  void Push(int value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    data_.push_back(value);
+  }
+
+  bool Pop(int* value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (data_.empty()) {
+      return false;
+    }
+    *value = data_.back();
+    data_.pop_back();
+    return true;
+  }
+
+ private:
+  std::mutex mtx_;
+  std::vector<int> data_;
+};
+
+// 返回每秒完成的 Push + Pop 次数
+template <typename Stack>
+double Bench(Stack* stack, int threads) {
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([stack, i]() {
+      int value = i;
+      for (int j = 0; j < kOpsPerThread; ++j) {
+        stack->Push(value);
+        stack->Pop(&value);
+      }
+    });
+  }
+  for (auto&& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return static_cast<double>(threads) * kOpsPerThread / cost.count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+
+  printf("%-8s %18s %18s\n", "threads", "LockFreeStack", "mutex+vector");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    cpputil::lock_free::LockFreeStack<int> lockfree_stack(threads);
+    MutexStack mutex_stack;
+    double lockfree_ops = Bench(&lockfree_stack, threads);
+    double mutex_ops = Bench(&mutex_stack, threads);
+    printf("%-8d %16.0f/s %16.0f/s\n", threads, lockfree_ops, mutex_ops);
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "lockfree/mpmc_queue.h"
+
+/**
+ * 对比 MpmcQueue 和 std::mutex + std::queue 在 N 个生产者、N 个消费者下的吞吐
+ *
+ * 1. MpmcQueue: 阻塞的 Push/Pop
+ * 2. MpmcQueue bulk: 每次 PushBulk/PopBulk 最多 kBatchSize 个元素
+ * 3. mutex+queue: 有界队列, 用两个条件变量等待
+ *
+ * $./mpmc_queue_benchmark [max_threads]
+ */
+namespace {
+
+constexpr int kItemsPerProducer = 500000;
+constexpr size_t kCapacity = 1024;
+constexpr size_t kBatchSize = 32;
+
+class MutexQueue {
+ public:
+  void Push(int value) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    not_full_.wait(lock, [this]() {
+      return queue_.size() < kCapacity;
+    });
+    queue_.push(value);
+    not_empty_.notify_one();
+  }
+
+  void Pop(int* value) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    not_empty_.wait(lock, [this]() {
+      return !queue_.empty();
+    });
+    *value = queue_.front();
+    queue_.pop();
+    not_full_.notify_one();
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::queue<int> queue_;
+};
+
+// 返回每秒传递的元素个数
+template <typename ProduceFunc, typename ConsumeFunc>
+double Bench(int threads, ProduceFunc produce, ConsumeFunc consume) {
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(produce);
+    workers.emplace_back(consume);
+  }
+  for (auto&& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return static_cast<double>(threads) * kItemsPerProducer / cost.count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+
+  printf("%-8s %18s %18s %18s\n", "threads", "MpmcQueue", "MpmcQueue bulk", "mutex+queue");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    cpputil::lock_free::MpmcQueue<int> queue(kCapacity);
+    double single = Bench(
+        threads,
+        [&queue]() {
+          for (int i = 0; i < kItemsPerProducer; ++i) {
+            queue.Push(i);
+          }
+        },
+        [&queue]() {
+          int value;
+          for (int i = 0; i < kItemsPerProducer; ++i) {
+            queue.Pop(&value);
+          }
+        });
+
+    double bulk = Bench(
+        threads,
+        [&queue]() {
+          int values[kBatchSize];
+          for (int i = 0; i < kItemsPerProducer; i += kBatchSize) {
+            size_t n = std::min(kBatchSize, static_cast<size_t>(kItemsPerProducer - i));
+            for (size_t k = 0; k < n; ++k) {
+              values[k] = i + static_cast<int>(k);
+            }
+            queue.PushBulk(values, n);
+          }
+        },
+        [&queue]() {
+          int values[kBatchSize];
+          for (int i = 0; i < kItemsPerProducer;) {
+            i += static_cast<int>(
+                queue.PopBulk(values, std::min(kBatchSize, static_cast<size_t>(kItemsPerProducer - i))));
+          }
+        });
+
+    MutexQueue mutex_queue;
+    double mutex = Bench(
+        threads,
+        [&mutex_queue]() {
+          for (int i = 0; i < kItemsPerProducer; ++i) {
+            mutex_queue.Push(i);
+          }
+        },
+        [&mutex_queue]() {
+          int value;
+          for (int i = 0; i < kItemsPerProducer; ++i) {
+            mutex_queue.Pop(&value);
+          }
+        });
+
+    printf("%-8d %16.0f/s %16.0f/s %16.0f/s\n", threads, single, bulk, mutex);
+  }
+  return 0;
+}
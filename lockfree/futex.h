@@ -0,0 +1,29 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace cpputil {
+namespace lock_free {
+
+/**
+ * @brief *addr 等于 expected 时睡眠, 直到被 FutexWake 唤醒; 不相等时立即返回, 也可能被虚假唤醒
+ */
+inline void FutexWait(std::atomic<uint32_t>* addr, uint32_t expected) {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bit");
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief 最多唤醒 n 个在 addr 上等待的线程
+ */
+inline void FutexWake(std::atomic<uint32_t>* addr, int n) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+}  // namespace lock_free
+}  // namespace cpputil
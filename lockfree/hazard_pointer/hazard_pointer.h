@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "util/macro_util.h"
+
+namespace cpputil {
+namespace lock_free {
+
+/**
+ * @brief hazard pointer, 用于无锁数据结构中的内存回收
+ *
+ * 1. 读线程访问共享指针之前先用 HazardPointer::Protect 把指针发布到自己的 hazard 槽位中
+ * 2. 写线程摘下旧对象后调用 Retire, 对象先放到线程本地的待回收列表中
+ * 3. 待回收列表达到阈值时扫描所有槽位, 只删除没有被任何槽位保护的对象
+ *    回收的对象很大、不能攒到阈值时用 RetireAndReclaim, 每次都立即扫描
+ *
+ * 读路径只写自己独占的槽位, 不修改任何引用计数, 也不需要加锁
+ * 槽位获取后缓存在线程本地, 线程退出时归还; 线程退出时没删除的对象交给下一次扫描处理
+ *
+ * eg:
+ *     std::atomic<Node*> head;
+ *     {
+ *       cpputil::lock_free::HazardPointer hp;
+ *       Node* node = hp.Protect(head);
+ *       // 在 hp 析构或者 Reset 之前 node 不会被删除
+ *     }
+ *     Node* old = head.exchange(new_node);
+ *     cpputil::lock_free::Retire(old);
+ */
+class HazardPointerDomain {
+ public:
+  struct alignas(CACHE_LINE_SIZE) Record {
+    std::atomic<const void*> ptr = {nullptr};
+    std::atomic<bool> active = {false};
+    Record* next = nullptr;
+  };
+
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+  };
+
+  // 进程内唯一, 故意不析构, 避免线程局部变量析构时访问已经析构的 domain
+  static HazardPointerDomain& Instance() {
+    static HazardPointerDomain* domain = new HazardPointerDomain();
+    return *domain;
+  }
+
+  Record* AcquireRecord() {
+    for (Record* rec = head_.load(std::memory_order_acquire); rec != nullptr; rec = rec->next) {
+      bool expected = false;
+      if (!rec->active.load(std::memory_order_relaxed) &&
+          rec->active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        return rec;
+      }
+    }
+    Record* rec = new Record();
+    rec->active.store(true, std::memory_order_relaxed);
+    Record* old_head = head_.load(std::memory_order_relaxed);
+    do {
+      rec->next = old_head;
+    } while (!head_.compare_exchange_weak(old_head, rec, std::memory_order_release, std::memory_order_relaxed));
+    record_num_.fetch_add(1, std::memory_order_relaxed);
+    return rec;
+  }
+
+  void ReleaseRecord(Record* rec) {
+    rec->ptr.store(nullptr, std::memory_order_release);
+    rec->active.store(false, std::memory_order_release);
+  }
+
+  // 待回收对象超过该值时扫描, 和槽位数量成正比, 保证每次扫描的均摊成本为 O(1)
+  size_t ScanThreshold() const {
+    return std::max<size_t>(64, 2 * record_num_.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * @brief 删除 retired 中没有被保护的对象, 剩下的留在 retired 中
+   */
+  void Scan(std::vector<Retired>* retired) {
+    AdoptOrphans(retired);
+    // 和 Protect 中的 seq_cst store 配对, 保证看到在摘下对象之前发布的 hazard 指针
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<const void*> hazards;
+    for (Record* rec = head_.load(std::memory_order_acquire); rec != nullptr; rec = rec->next) {
+      const void* ptr = rec->ptr.load(std::memory_order_acquire);
+      if (ptr != nullptr) {
+        hazards.push_back(ptr);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    auto keep = std::partition(retired->begin(), retired->end(), [&hazards](const Retired& r) {
+      return std::binary_search(hazards.begin(), hazards.end(), static_cast<const void*>(r.ptr));
+    });
+    for (auto it = keep; it != retired->end(); ++it) {
+      it->deleter(it->ptr);
+    }
+    retired->erase(keep, retired->end());
+  }
+
+  // 线程退出时还被保护的对象交给其他线程回收
+  void AddOrphans(std::vector<Retired>* retired) {
+    if (retired->empty()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(orphan_mtx_);
+    orphans_.insert(orphans_.end(), retired->begin(), retired->end());
+    has_orphans_.store(true, std::memory_order_release);
+    retired->clear();
+  }
+
+ private:
+  HazardPointerDomain() = default;
+  DISALLOW_COPY_AND_ASSIGN(HazardPointerDomain);
+
+  void AdoptOrphans(std::vector<Retired>* retired) {
+    if (!has_orphans_.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(orphan_mtx_);
+    retired->insert(retired->end(), orphans_.begin(), orphans_.end());
+    orphans_.clear();
+    has_orphans_.store(false, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<Record*> head_ = {nullptr};
+  std::atomic<size_t> record_num_ = {0};
+
+  std::mutex orphan_mtx_;
+  std::vector<Retired> orphans_;
+  std::atomic<bool> has_orphans_ = {false};
+};
+
+namespace internal {
+
+// 线程本地的槽位缓存和待回收列表
+class HazardThreadCache {
+ public:
+  static HazardThreadCache& Get() {
+    thread_local HazardThreadCache cache;
+    return cache;
+  }
+
+  ~HazardThreadCache() {
+    HazardPointerDomain& domain = HazardPointerDomain::Instance();
+    for (size_t i = 0; i < free_num_; ++i) {
+      domain.ReleaseRecord(free_records_[i]);
+    }
+    if (!retired_.empty()) {
+      domain.Scan(&retired_);
+      domain.AddOrphans(&retired_);
+    }
+  }
+
+  HazardPointerDomain::Record* Acquire() {
+    if (free_num_ > 0) {
+      return free_records_[--free_num_];
+    }
+    return HazardPointerDomain::Instance().AcquireRecord();
+  }
+
+  void Release(HazardPointerDomain::Record* rec) {
+    rec->ptr.store(nullptr, std::memory_order_release);
+    if (free_num_ < kCacheSize) {
+      free_records_[free_num_++] = rec;
+    } else {
+      HazardPointerDomain::Instance().ReleaseRecord(rec);
+    }
+  }
+
+  void Retire(void* ptr, void (*deleter)(void*), bool scan_now) {
+    retired_.push_back({ptr, deleter});
+    HazardPointerDomain& domain = HazardPointerDomain::Instance();
+    if (scan_now || retired_.size() >= domain.ScanThreshold()) {
+      domain.Scan(&retired_);
+    }
+  }
+
+ private:
+  HazardThreadCache() = default;
+
+ private:
+  static constexpr size_t kCacheSize = 8;
+  HazardPointerDomain::Record* free_records_[kCacheSize];
+  size_t free_num_ = 0;
+  std::vector<HazardPointerDomain::Retired> retired_;
+};
+
+}  // namespace internal
+
+/**
+ * @brief 独占一个 hazard 槽位, 析构时清空并归还, 只能在创建它的线程中使用
+ */
+class HazardPointer {
+ public:
+  HazardPointer() : rec_(internal::HazardThreadCache::Get().Acquire()) {
+  }
+  ~HazardPointer() {
+    if (rec_ != nullptr) {
+      internal::HazardThreadCache::Get().Release(rec_);
+    }
+  }
+
+  HazardPointer(HazardPointer&& other) noexcept : rec_(std::exchange(other.rec_, nullptr)) {
+  }
+  HazardPointer(const HazardPointer&) = delete;
+  HazardPointer& operator=(const HazardPointer&) = delete;
+  HazardPointer& operator=(HazardPointer&&) = delete;
+
+ public:
+  /**
+   * @brief 读取 src 并保护读到的指针, 返回之后直到下一次 Protect/Reset 之前该对象不会被回收
+   *
+   * src 被并发修改时会重试, 是 lock-free 而不是 wait-free 的
+   */
+  template <typename T>
+  T* Protect(const std::atomic<T*>& src) {
+    T* ptr = src.load(std::memory_order_relaxed);
+    while (true) {
+      rec_->ptr.store(ptr, std::memory_order_seq_cst);
+      T* current = src.load(std::memory_order_seq_cst);
+      if (current == ptr) {
+        return ptr;
+      }
+      ptr = current;
+    }
+  }
+
+  void Reset() {
+    rec_->ptr.store(nullptr, std::memory_order_release);
+  }
+
+ private:
+  HazardPointerDomain::Record* rec_;
+};
+
+/**
+ * @brief 回收一个已经从共享结构中摘下的对象, 没有 hazard 指针保护它之后 delete
+ */
+template <typename T>
+void Retire(T* ptr) {
+  internal::HazardThreadCache::Get().Retire(
+      const_cast<void*>(static_cast<const void*>(ptr)),
+      [](void* p) {
+        delete static_cast<T*>(p);
+      },
+      false);
+}
+
+/**
+ * @brief 回收一个已经从共享结构中摘下的对象, 并立即扫描一次: 没有被保护的对象(包括之前留下的)马上 delete
+ *
+ * 每次调用都要遍历所有槽位, 适合对象很大、回收不频繁的场景; 仍然被保护的对象留到当前线程的下一次扫描
+ */
+template <typename T>
+void RetireAndReclaim(T* ptr) {
+  internal::HazardThreadCache::Get().Retire(
+      const_cast<void*>(static_cast<const void*>(ptr)),
+      [](void* p) {
+        delete static_cast<T*>(p);
+      },
+      true);
+}
+
+}  // namespace lock_free
+}  // namespace cpputil
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "lockfree/backoff.h"
+#include "util/macro_util.h"
+
+namespace cpputil {
+namespace lock_free {
+
+/*
+ * Node1->next = Node2;
+ * Node2->next = Node3;
+ *
+ *              +------------------+ <-----+ stack top
+ *              |                  |
+ * head +---->  |      Node 1      |
+ *              |                  |
+ *              +------------------+
+ *              |                  |
+ *              |      Node 2      |
+ *              |                  |
+ *              +------------------+
+ *              |                  |
+ *              |      Node 3      |
+ *              |                  |
+ *              +------------------+ <-----+ stack bottom
+ *
+ * 1. 节点从栈自带的节点池中分配, 节点池按 64, 128, 256, ... 个节点一块地增长, 栈析构之前不释放
+ *    弹出的节点放回无锁的空闲链表, 预热之后 Push/Pop 不再调用 malloc
+ * 2. 节点的内存在栈的生命周期内一直有效, 所以 Pop 读到一个刚被其他线程弹出的节点的 next 也不会访问已释放的内存
+ * 3. 栈顶是 64 bit 的 (tag, 节点下标), 每次修改 tag 加一, 节点被弹出又压回时 CAS 会失败, 避免 ABA 问题
+ * 4. 栈顶 CAS 失败时先到消除数组中和并发的 Pop/Push 直接交换节点, 仍然失败再指数退避, 高并发下不会都挤在栈顶上
+ *
+ * 之所以没提供 Empty()、Size() 和 Top() 等方法, 是因为在并发场景下这些方法并没有意义
+ *
+ * eg:
+ *     cpputil::lock_free::LockFreeStack<int> stack;
+ *     stack.Push(1);
+ *     int value;
+ *     if (stack.Pop(&value)) {
+ *       ...
+ *     }
+ */
+template <typename T>
+class LockFreeStack {
+ private:
+  struct Node {
+    alignas(T) unsigned char storage[sizeof(T)];
+    // 下一个节点的下标, 节点被弹出之后其他线程仍然可能读到它, 所以是原子变量
+    std::atomic<uint32_t> next = {kNullIndex};
+
+    T* Value() {
+      return reinterpret_cast<T*>(storage);
+    }
+  };
+
+  static constexpr uint32_t kNullIndex = UINT32_MAX;
+  // 第 k 块有 (1 << (kFirstChunkBits + k)) 个节点
+  static constexpr uint32_t kFirstChunkBits = 6;
+  static constexpr uint32_t kMaxChunks = 32 - kFirstChunkBits;
+  // 所有块的节点总数, 不超过 kNullIndex
+  static constexpr uint32_t kMaxNodes = ((1u << kMaxChunks) - 1) << kFirstChunkBits;
+
+  /**
+   * @brief 带 tag 的节点下标栈, 栈和空闲链表共用
+   */
+  class TaggedStack {
+   public:
+    void Push(LockFreeStack* owner, uint32_t index) {
+      while (!TryPush(owner, index)) {
+      }
+    }
+
+    uint32_t Pop(LockFreeStack* owner) {
+      uint32_t index;
+      while (!TryPop(owner, &index)) {
+      }
+      return index;
+    }
+
+    // 尝试一次 CAS, 失败说明有竞争
+    bool TryPush(LockFreeStack* owner, uint32_t index) {
+      uint64_t head = head_.load(std::memory_order_relaxed);
+      owner->NodeAt(index)->next.store(Index(head), std::memory_order_relaxed);
+      return head_.compare_exchange_weak(head, Pack(index, Tag(head) + 1), std::memory_order_release,
+                                         std::memory_order_relaxed);
+    }
+
+    // 尝试一次 CAS, 失败说明有竞争; 成功时 index 为弹出的节点, 栈为空时为 kNullIndex
+    bool TryPop(LockFreeStack* owner, uint32_t* index) {
+      uint64_t head = head_.load(std::memory_order_acquire);
+      *index = Index(head);
+      if (*index == kNullIndex) {
+        return true;
+      }
+      // 节点可能已经被其他线程弹出, 读到的 next 是旧值, 但这时 tag 已经变化, 下面的 CAS 一定失败
+      uint32_t next = owner->NodeAt(*index)->next.load(std::memory_order_relaxed);
+      return head_.compare_exchange_weak(head, Pack(next, Tag(head) + 1), std::memory_order_acquire,
+                                         std::memory_order_relaxed);
+    }
+
+   private:
+    static uint64_t Pack(uint32_t index, uint32_t tag) {
+      return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+    static uint32_t Index(uint64_t head) {
+      return static_cast<uint32_t>(head);
+    }
+    static uint32_t Tag(uint64_t head) {
+      return static_cast<uint32_t>(head >> 32);
+    }
+
+   private:
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_ = {Pack(kNullIndex, 0)};
+  };
+
+  /**
+   * @brief 消除数组: 在栈顶上 CAS 失败的 Push 和 Pop 在这里直接交换节点, 不再访问栈顶
+   *
+   * Push 把节点下标挂到一个随机槽位上等待一小段时间, 同一时刻到达该槽位的 Pop 把它取走,
+   * 效果等价于先 Push 再 Pop; 没有被取走时撤回, 回到栈顶重试
+   */
+  class EliminationArray {
+   public:
+    bool TryPush(uint32_t index) {
+      Slot& slot = slots_[RandomSlot()];
+      uint64_t expected = kEmpty;
+      uint64_t offer = static_cast<uint64_t>(index) + 1;
+      if (!slot.state.compare_exchange_strong(expected, offer, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        return false;
+      }
+      for (int i = 0; i < kWaitSpins; ++i) {
+        if (slot.state.load(std::memory_order_acquire) == kTaken) {
+          slot.state.store(kEmpty, std::memory_order_release);
+          return true;
+        }
+        CpuRelax();
+      }
+      if (slot.state.compare_exchange_strong(offer, kEmpty, std::memory_order_relaxed)) {
+        return false;
+      }
+      // 撤回之前刚好被取走
+      slot.state.store(kEmpty, std::memory_order_release);
+      return true;
+    }
+
+    bool TryPop(uint32_t* index) {
+      Slot& slot = slots_[RandomSlot()];
+      uint64_t state = slot.state.load(std::memory_order_relaxed);
+      if (state == kEmpty || state == kTaken) {
+        return false;
+      }
+      if (!slot.state.compare_exchange_strong(state, kTaken, std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+        return false;
+      }
+      *index = static_cast<uint32_t>(state - 1);
+      return true;
+    }
+
+   private:
+    static constexpr uint32_t kSlotNum = 16;
+    static constexpr int kWaitSpins = 128;
+    static constexpr uint64_t kEmpty = 0;
+    static constexpr uint64_t kTaken = UINT64_MAX;
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+      // kEmpty, kTaken 或者等待交换的节点下标 + 1
+      std::atomic<uint64_t> state = {kEmpty};
+    };
+
+    // xorshift, 每个线程独立的随机数
+    static uint32_t RandomSlot() {
+      thread_local uint32_t seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&seed)) | 1;
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      return seed & (kSlotNum - 1);
+    }
+
+   private:
+    Slot slots_[kSlotNum];
+  };
+
+ public:
+  /**
+   * @param reserve 预先分配的节点数量
+   */
+  explicit LockFreeStack(size_t reserve = 0) {
+    for (auto&& chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < reserve; ++i) {
+      free_list_.Push(this, AllocateNode());
+    }
+  }
+
+  // 析构时弹出所有元素
+  ~LockFreeStack() {
+    uint32_t index;
+    while ((index = stack_.Pop(this)) != kNullIndex) {
+      NodeAt(index)->Value()->~T();
+    }
+    for (uint32_t k = 0; k < kMaxChunks; ++k) {
+      delete[] chunks_[k].load(std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  void Push(const T& value) {
+    Emplace(value);
+  }
+
+  void Push(T&& value) {
+    Emplace(std::move(value));
+  }
+
+  template <typename... Args>
+  void Emplace(Args&&... args) {
+    uint32_t index = free_list_.Pop(this);
+    if (index == kNullIndex) {
+      index = AllocateNode();
+    }
+    Node* node = NodeAt(index);
+    try {
+      new (node->storage) T(std::forward<Args>(args)...);
+    } catch (...) {
+      free_list_.Push(this, index);
+      throw;
+    }
+    ExponentialBackoff backoff;
+    while (!stack_.TryPush(this, index)) {
+      if (elimination_.TryPush(index)) {
+        return;
+      }
+      backoff.Pause();
+    }
+  }
+
+  /**
+   * @return bool 栈为空时返回 false
+   */
+  bool Pop(T* value) {
+    uint32_t index;
+    ExponentialBackoff backoff;
+    while (!stack_.TryPop(this, &index)) {
+      if (elimination_.TryPop(&index)) {
+        break;
+      }
+      backoff.Pause();
+    }
+    if (index == kNullIndex) {
+      return false;
+    }
+    // CAS 成功之后当前线程独占该节点
+    T* stored = NodeAt(index)->Value();
+    *value = std::move(*stored);
+    stored->~T();
+    free_list_.Push(this, index);
+    return true;
+  }
+
+ private:
+  Node* NodeAt(uint32_t index) {
+    uint32_t k = ChunkOf(index);
+    uint32_t offset = index - (((1u << k) - 1) << kFirstChunkBits);
+    return chunks_[k].load(std::memory_order_acquire) + offset;
+  }
+
+  // 下标 index 所在的块: 第 k 块的起始下标为 ((1 << k) - 1) << kFirstChunkBits
+  static uint32_t ChunkOf(uint32_t index) {
+    return 31 - __builtin_clz((index >> kFirstChunkBits) + 1);
+  }
+
+  // 分配一个从未使用过的节点, 所在的块不存在时创建, 多个线程同时创建时只保留一个
+  uint32_t AllocateNode() {
+    uint32_t index = next_index_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= kMaxNodes) {
+      throw std::bad_alloc();
+    }
+    uint32_t k = ChunkOf(index);
+    if (chunks_[k].load(std::memory_order_acquire) == nullptr) {
+      Node* chunk = new Node[static_cast<size_t>(1) << (k + kFirstChunkBits)];
+      Node* expected = nullptr;
+      if (!chunks_[k].compare_exchange_strong(expected, chunk, std::memory_order_acq_rel)) {
+        delete[] chunk;
+      }
+    }
+    return index;
+  }
+
+ private:
+  TaggedStack stack_;
+  EliminationArray elimination_;
+  TaggedStack free_list_;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> next_index_ = {0};
+  std::atomic<Node*> chunks_[kMaxChunks];
+
+  DISALLOW_COPY_AND_ASSIGN(LockFreeStack);
+};
+
+}  // namespace lock_free
+}  // namespace cpputil
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "lockfree/backoff.h"
+#include "lockfree/futex.h"
+#include "util/macro_util.h"
+
+namespace cpputil {
+namespace lock_free {
+
+/**
+ * @brief 有界的多生产者多消费者无锁队列, 参考 Dmitry Vyukov 的 bounded MPMC queue
+ *
+ * 1. 容量向上取整为 2 的幂, 每个槽位带一个序号 sequence, 生产者和消费者分别 CAS 自己的位置 enqueue_pos_/dequeue_pos_
+ *    - sequence == pos: 槽位空闲, 等待第 pos 次写入
+ *    - sequence == pos + 1: 槽位已经写入, 等待第 pos 次读取
+ * 2. enqueue_pos_ 和 dequeue_pos_ 放在不同的 cache line 上, 生产者之间和消费者之间才有竞争
+ * 3. TryPush/TryPop 不阻塞; Push/Pop 先自旋, 仍然失败时在 futex 上睡眠, 没有线程等待时不会有系统调用
+ * 4. TryPushBulk/TryPopBulk 一次 CAS 占用多个连续的槽位
+ *
+ * eg:
+ *     cpputil::lock_free::MpmcQueue<int> queue(1024);
+ *     queue.Push(1);
+ *     int value;
+ *     queue.Pop(&value);
+ */
+template <typename T>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(size_t capacity) : mask_(RoundUpPowerOfTwo(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcQueue() {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+    for (; pos != end; ++pos) {
+      cells_[pos & mask_].Value()->~T();
+    }
+  }
+
+ public:
+  size_t Capacity() const {
+    return mask_ + 1;
+  }
+
+  // 并发修改时只是一个近似值
+  size_t SizeApprox() const {
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+  /**
+   * @return bool 队列已满时返回 false
+   */
+  template <typename... Args>
+  bool TryEmplace(Args&&... args) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->storage) T(std::forward<Args>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    not_empty_.Notify(1);
+    return true;
+  }
+
+  bool TryPush(const T& value) {
+    return TryEmplace(value);
+  }
+
+  bool TryPush(T&& value) {
+    return TryEmplace(std::move(value));
+  }
+
+  /**
+   * @return bool 队列为空时返回 false
+   */
+  bool TryPop(T* value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* stored = cell->Value();
+    *value = std::move(*stored);
+    stored->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    not_full_.Notify(1);
+    return true;
+  }
+
+  /**
+   * @brief 从 first 开始最多拷贝 n 个元素入队, 一次 CAS 占用所有能用的空闲槽位
+   *        需要移动元素时传入 std::make_move_iterator
+   *
+   * @return size_t 实际入队的元素个数, 队列已满时为 0
+   */
+  template <typename InputIt>
+  size_t TryPushBulk(InputIt first, size_t n) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t count;
+    while (true) {
+      count = 0;
+      intptr_t diff = 0;
+      while (count < n) {
+        size_t sequence = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire);
+        diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + count);
+        if (diff != 0) {
+          break;
+        }
+        ++count;
+      }
+      if (count == 0) {
+        if (diff < 0 || n == 0) {
+          return 0;
+        }
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < count; ++i, ++first) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      new (cell.storage) T(*first);
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    not_empty_.Notify(static_cast<int>(count));
+    return count;
+  }
+
+  /**
+   * @brief 最多出队 max_n 个元素, 依次写入 out, 一次 CAS 占用所有已经写入的槽位
+   *
+   * @return size_t 实际出队的元素个数, 队列为空时为 0
+   */
+  template <typename OutputIt>
+  size_t TryPopBulk(OutputIt out, size_t max_n) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t count;
+    while (true) {
+      count = 0;
+      intptr_t diff = 0;
+      while (count < max_n) {
+        size_t sequence = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire);
+        diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + count + 1);
+        if (diff != 0) {
+          break;
+        }
+        ++count;
+      }
+      if (count == 0) {
+        if (diff < 0 || max_n == 0) {
+          return 0;
+        }
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < count; ++i, ++out) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      T* stored = cell.Value();
+      *out = std::move(*stored);
+      stored->~T();
+      cell.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    not_full_.Notify(static_cast<int>(count));
+    return count;
+  }
+
+  /**
+   * @brief 阻塞直到入队成功
+   */
+  void Push(const T& value) {
+    not_full_.WaitUntil([this, &value]() {
+      return TryPush(value);
+    });
+  }
+
+  void Push(T&& value) {
+    not_full_.WaitUntil([this, &value]() {
+      return TryPush(std::move(value));
+    });
+  }
+
+  /**
+   * @brief 阻塞直到出队成功
+   */
+  void Pop(T* value) {
+    not_empty_.WaitUntil([this, value]() {
+      return TryPop(value);
+    });
+  }
+
+  /**
+   * @brief 阻塞直到 n 个元素全部入队
+   */
+  template <typename ForwardIt>
+  void PushBulk(ForwardIt first, size_t n) {
+    while (n > 0) {
+      size_t count = 0;
+      not_full_.WaitUntil([&]() {
+        count = TryPushBulk(first, n);
+        return count > 0;
+      });
+      std::advance(first, count);
+      n -= count;
+    }
+  }
+
+  /**
+   * @brief 阻塞直到至少出队一个元素
+   *
+   * @return size_t 实际出队的元素个数, max_n 大于 0 时在 [1, max_n] 之间
+   */
+  template <typename OutputIt>
+  size_t PopBulk(OutputIt out, size_t max_n) {
+    size_t count = 0;
+    if (max_n == 0) {
+      return 0;
+    }
+    not_empty_.WaitUntil([&]() {
+      count = TryPopBulk(out, max_n);
+      return count > 0;
+    });
+    return count;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* Value() {
+      return reinterpret_cast<T*>(storage);
+    }
+  };
+
+  /**
+   * @brief 基于 futex 的等待队列, 只有存在等待者时 Notify 才会发起系统调用
+   */
+  class alignas(CACHE_LINE_SIZE) Waiters {
+   public:
+    template <typename TryFunc>
+    void WaitUntil(TryFunc&& try_func) {
+      ExponentialBackoff backoff;
+      for (int i = 0; i < kSpinRounds; ++i) {
+        if (try_func()) {
+          return;
+        }
+        backoff.Pause();
+      }
+      while (true) {
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        // 和 Notify 中的 fence 配对: 要么这里的 try_func 看到对方的修改, 要么对方看到 waiters_ > 0
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (try_func()) {
+          waiters_.fetch_sub(1, std::memory_order_relaxed);
+          return;
+        }
+        FutexWait(&seq_, seq);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+
+    void Notify(int n) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (waiters_.load(std::memory_order_relaxed) > 0) {
+        seq_.fetch_add(1, std::memory_order_release);
+        FutexWake(&seq_, n);
+      }
+    }
+
+   private:
+    static constexpr int kSpinRounds = 16;
+
+    std::atomic<uint32_t> seq_ = {0};
+    std::atomic<int32_t> waiters_ = {0};
+  };
+
+  static size_t RoundUpPowerOfTwo(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+ private:
+  const size_t mask_;
+  const std::unique_ptr<Cell[]> cells_;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos_ = {0};
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos_ = {0};
+  Waiters not_empty_;
+  Waiters not_full_;
+
+  DISALLOW_COPY_AND_ASSIGN(MpmcQueue);
+};
+
+}  // namespace lock_free
+}  // namespace cpputil
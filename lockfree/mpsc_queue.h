@@ -0,0 +1,229 @@
+#pragma once
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <system_error>
+
+#include "util/macro_util.h"
+
+namespace cpputil {
+namespace lock_free {
+
+/**
+ * @brief 侵入式节点, 放入 MpscQueue 的类型需要继承它
+ */
+struct MpscNode {
+  std::atomic<MpscNode*> next = {nullptr};
+};
+
+/**
+ * @brief 无界的多生产者单消费者侵入式队列, 参考 Dmitry Vyukov 的 intrusive MPSC node-based queue
+ *
+ * 1. 生产者只做一次原子 exchange 和一次 store, 是 wait-free 的, 不分配内存
+ * 2. 队列不拥有节点, Pop 返回的节点由消费者负责释放
+ * 3. 生产者在 exchange 和 store 之间被挂起时, 它之后入队的节点暂时不可见, Pop 会返回 nullptr,
+ *    等该生产者完成 store 之后才能继续出队
+ *
+ * eg:
+ *     struct Task : cpputil::lock_free::MpscNode {
+ *       std::function<void()> func;
+ *     };
+ *     cpputil::lock_free::MpscQueue<Task> queue;
+ *     queue.Push(new Task{...});
+ *     queue.DrainBatch([](Task* task) {
+ *       task->func();
+ *       delete task;
+ *     });
+ */
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {
+  }
+
+ public:
+  /**
+   * @brief 可以在任意线程中调用
+   */
+  void Push(T* node) {
+    PushNode(node);
+  }
+
+  /**
+   * @brief 只能在消费者线程中调用
+   *
+   * @return T* 队列为空时返回 nullptr
+   */
+  T* Pop() {
+    MpscNode* tail = tail_;
+    MpscNode* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    // tail 是最后一个可见的节点, 只有它确实是队尾时才能取出: 先放回 stub 作为新的队尾
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    PushNode(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief 最多出队 max_n 个节点, 依次调用 func(T*), 只能在消费者线程中调用
+   *
+   * @return size_t 出队的节点个数
+   */
+  template <typename F>
+  size_t DrainBatch(F&& func, size_t max_n = std::numeric_limits<size_t>::max()) {
+    size_t count = 0;
+    while (count < max_n) {
+      T* node = Pop();
+      if (node == nullptr) {
+        break;
+      }
+      ++count;
+      func(node);
+    }
+    return count;
+  }
+
+ private:
+  void PushNode(MpscNode* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+ private:
+  // 生产者写入的一端
+  alignas(CACHE_LINE_SIZE) std::atomic<MpscNode*> head_;
+  // 消费者读取的一端, 只有消费者访问
+  alignas(CACHE_LINE_SIZE) MpscNode* tail_;
+  MpscNode stub_;
+
+  DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+/**
+ * @brief 带 eventfd 的 MpscQueue, 消费者没有节点可处理时可以睡眠, 生产者入队后唤醒它
+ *
+ * 1. 连续的多次 Push 只写一次 eventfd, 消费者开始 Drain 之后的 Push 才会再次写入
+ * 2. fd() 可以注册到 epoll(例如 tcp::EventLoop::AddFd), 可读时在事件线程中调用 Drain;
+ *    没有 epoll 的消费者(例如日志刷盘线程)可以用 Wait 阻塞等待
+ * 3. Drain 因为 max_n 没有取完时会自己重新写 eventfd, 剩下的节点在下一轮处理, 不会饿死其他 fd
+ *
+ * eg:
+ *     cpputil::lock_free::MpscInbox<Task> inbox;
+ *     loop.AddFd(inbox.fd(), EPOLLIN, [&inbox](uint32_t) {
+ *       inbox.Drain([](Task* task) {
+ *         task->func();
+ *         delete task;
+ *       }, 64);
+ *     });
+ *     // 工作线程中
+ *     inbox.Push(new Task{...});
+ */
+template <typename T>
+class MpscInbox {
+ public:
+  MpscInbox() : event_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (event_fd_ == -1) {
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+  }
+
+  ~MpscInbox() {
+    ::close(event_fd_);
+  }
+
+ public:
+  int fd() const {
+    return event_fd_;
+  }
+
+  /**
+   * @brief 可以在任意线程中调用
+   */
+  void Push(T* node) {
+    queue_.Push(node);
+    if (!notified_.exchange(true, std::memory_order_acq_rel)) {
+      Notify();
+    }
+  }
+
+  /**
+   * @brief 清空 eventfd 并最多出队 max_n 个节点, 只能在消费者线程中调用
+   *
+   * @return size_t 出队的节点个数
+   */
+  template <typename F>
+  size_t Drain(F&& func, size_t max_n = std::numeric_limits<size_t>::max()) {
+    uint64_t count = 0;
+    while (::read(event_fd_, &count, sizeof(count)) > 0) {
+    }
+    // 之后的 Push 都会重新写 eventfd; exchange 同时保证看到已经通知过的 Push 入队的节点
+    notified_.exchange(false, std::memory_order_acq_rel);
+    size_t drained = queue_.DrainBatch(func, max_n);
+    if (drained == max_n && !notified_.exchange(true, std::memory_order_acq_rel)) {
+      Notify();
+    }
+    return drained;
+  }
+
+  /**
+   * @brief 阻塞直到有 Push 的通知或者超时, 只能在消费者线程中调用
+   *
+   * @param timeout_ms 小于 0 时一直等待
+   * @return bool 是否有通知
+   */
+  bool Wait(int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = event_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ret;
+    do {
+      ret = ::poll(&pfd, 1, timeout_ms);
+    } while (ret == -1 && errno == EINTR);
+    return ret > 0;
+  }
+
+ private:
+  void Notify() {
+    uint64_t one = 1;
+    while (::write(event_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+  }
+
+ private:
+  MpscQueue<T> queue_;
+  int event_fd_;
+  // 是否已经写过 eventfd 且消费者还没有开始 Drain
+  alignas(CACHE_LINE_SIZE) std::atomic<bool> notified_ = {false};
+
+  DISALLOW_COPY_AND_ASSIGN(MpscInbox);
+};
+
+}  // namespace lock_free
+}  // namespace cpputil
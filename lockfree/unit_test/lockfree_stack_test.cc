@@ -0,0 +1,109 @@
+#include "lockfree/lockfree_stack.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpputil {
+
+namespace lock_free {
+
+TEST(LockFreeStackTest, usage) {
+  LockFreeStack<std::string> stack;
+  std::string value;
+  ASSERT_FALSE(stack.Pop(&value));
+
+  stack.Push("a");
+  stack.Emplace(3, 'b');
+  ASSERT_TRUE(stack.Pop(&value));
+  ASSERT_EQ(value, "bbb");
+  ASSERT_TRUE(stack.Pop(&value));
+  ASSERT_EQ(value, "a");
+  ASSERT_FALSE(stack.Pop(&value));
+}
+
+TEST(LockFreeStackTest, destruct_test) {
+  auto counter = std::make_shared<int>(0);
+  {
+    LockFreeStack<std::shared_ptr<int>> stack(16);
+    for (int i = 0; i < 1000; ++i) {
+      stack.Push(counter);
+    }
+    std::shared_ptr<int> value;
+    ASSERT_TRUE(stack.Pop(&value));
+    value.reset();
+    ASSERT_EQ(counter.use_count(), 1 + 999);
+  }
+  // 析构时销毁栈中剩余的元素
+  ASSERT_EQ(counter.use_count(), 1);
+}
+
+// 多个线程同时 Push/Pop, 每个元素恰好被弹出一次
+TEST(LockFreeStackTest, concurrency_push_pop) {
+  constexpr int kThreadCnt = 8;
+  constexpr int kLoopCount = 20000;
+
+  LockFreeStack<int> stack;
+  std::vector<std::atomic<int>> popped(kThreadCnt * kLoopCount);
+  std::vector<std::thread> thread_list;
+  for (int i = 0; i < kThreadCnt; ++i) {
+    thread_list.emplace_back([&stack, &popped, i]() {
+      for (int j = 0; j < kLoopCount; ++j) {
+        stack.Push(i * kLoopCount + j);
+        int value;
+        if (stack.Pop(&value)) {
+          ++popped[value];
+        }
+      }
+    });
+  }
+  for (auto&& thread : thread_list) {
+    thread.join();
+  }
+  int value;
+  while (stack.Pop(&value)) {
+    ++popped[value];
+  }
+  for (auto&& count : popped) {
+    ASSERT_EQ(count.load(), 1);
+  }
+}
+
+// 一半线程只 Push, 一半线程只 Pop, 竞争时大量操作通过消除数组完成
+TEST(LockFreeStackTest, concurrency_producer_consumer) {
+  constexpr int kProducerCnt = 4;
+  constexpr int kLoopCount = 50000;
+
+  LockFreeStack<int> stack;
+  std::atomic<int64_t> sum = {0};
+  std::atomic<int> consumed = {0};
+  std::vector<std::thread> thread_list;
+  for (int i = 0; i < kProducerCnt; ++i) {
+    thread_list.emplace_back([&stack]() {
+      for (int j = 1; j <= kLoopCount; ++j) {
+        stack.Push(j);
+      }
+    });
+    thread_list.emplace_back([&stack, &sum, &consumed]() {
+      int value;
+      while (consumed.load() < kProducerCnt * kLoopCount) {
+        if (stack.Pop(&value)) {
+          sum += value;
+          ++consumed;
+        }
+      }
+    });
+  }
+  for (auto&& thread : thread_list) {
+    thread.join();
+  }
+  ASSERT_EQ(sum.load(), static_cast<int64_t>(kProducerCnt) * kLoopCount * (kLoopCount + 1) / 2);
+}
+
+}  // namespace lock_free
+
+}  // namespace cpputil
@@ -0,0 +1,111 @@
+#include "lockfree/mpmc_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpputil {
+
+namespace lock_free {
+
+TEST(MpmcQueueTest, usage) {
+  MpmcQueue<std::string> queue(3);
+  ASSERT_EQ(queue.Capacity(), 4u);
+
+  std::string value;
+  ASSERT_FALSE(queue.TryPop(&value));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.TryPush(std::to_string(i)));
+  }
+  ASSERT_FALSE(queue.TryPush("4"));
+  ASSERT_EQ(queue.SizeApprox(), 4u);
+
+  // 先进先出
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.TryPop(&value));
+    ASSERT_EQ(value, std::to_string(i));
+  }
+  ASSERT_FALSE(queue.TryPop(&value));
+}
+
+TEST(MpmcQueueTest, bulk_test) {
+  MpmcQueue<int> queue(8);
+  std::vector<int> input = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  ASSERT_EQ(queue.TryPushBulk(input.begin(), input.size()), 8u);
+  ASSERT_EQ(queue.TryPushBulk(input.begin(), input.size()), 0u);
+
+  std::vector<int> output;
+  ASSERT_EQ(queue.TryPopBulk(std::back_inserter(output), 5), 5u);
+  ASSERT_EQ(queue.TryPopBulk(std::back_inserter(output), 5), 3u);
+  ASSERT_EQ(queue.TryPopBulk(std::back_inserter(output), 5), 0u);
+  ASSERT_EQ(output, std::vector<int>(input.begin(), input.begin() + 8));
+}
+
+TEST(MpmcQueueTest, destruct_test) {
+  auto counter = std::make_shared<int>(0);
+  {
+    MpmcQueue<std::shared_ptr<int>> queue(16);
+    for (int i = 0; i < 10; ++i) {
+      queue.Push(counter);
+    }
+    ASSERT_EQ(counter.use_count(), 11);
+  }
+  // 析构时销毁队列中剩余的元素
+  ASSERT_EQ(counter.use_count(), 1);
+}
+
+// 多个生产者和消费者通过阻塞接口收发, 队列很小, 两边都会在 futex 上等待
+TEST(MpmcQueueTest, concurrency_push_pop) {
+  constexpr int kThreadCnt = 4;
+  constexpr int kLoopCount = 50000;
+
+  MpmcQueue<int> queue(16);
+  std::vector<std::atomic<int>> popped(kThreadCnt * kLoopCount);
+  std::vector<std::thread> thread_list;
+  for (int i = 0; i < kThreadCnt; ++i) {
+    thread_list.emplace_back([&queue, i]() {
+      for (int j = 0; j < kLoopCount; ++j) {
+        if (j % 2 == 0) {
+          queue.Push(i * kLoopCount + j);
+        } else {
+          int values[] = {i * kLoopCount + j};
+          queue.PushBulk(values, 1);
+        }
+      }
+    });
+    thread_list.emplace_back([&queue, &popped]() {
+      int received = 0;
+      while (received < kLoopCount) {
+        if (received % 2 == 0) {
+          int value;
+          queue.Pop(&value);
+          ++popped[value];
+          ++received;
+        } else {
+          int values[4];
+          size_t count = queue.PopBulk(values, std::min(4, kLoopCount - received));
+          for (size_t k = 0; k < count; ++k) {
+            ++popped[values[k]];
+          }
+          received += static_cast<int>(count);
+        }
+      }
+    });
+  }
+  for (auto&& thread : thread_list) {
+    thread.join();
+  }
+  for (auto&& count : popped) {
+    ASSERT_EQ(count.load(), 1);
+  }
+}
+
+}  // namespace lock_free
+
+}  // namespace cpputil
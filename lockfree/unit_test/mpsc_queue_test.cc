@@ -0,0 +1,145 @@
+#include "lockfree/mpsc_queue.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpputil {
+
+namespace lock_free {
+
+namespace {
+
+struct Item : MpscNode {
+  explicit Item(int v) : value(v) {
+  }
+  int value;
+};
+
+}  // namespace
+
+TEST(MpscQueueTest, usage) {
+  MpscQueue<Item> queue;
+  ASSERT_EQ(queue.Pop(), nullptr);
+
+  Item items[] = {Item(0), Item(1), Item(2)};
+  for (auto&& item : items) {
+    queue.Push(&item);
+  }
+  // 先进先出
+  ASSERT_EQ(queue.Pop()->value, 0);
+  std::vector<int> values;
+  auto collect = [&values](Item* item) {
+    values.push_back(item->value);
+  };
+  ASSERT_EQ(queue.DrainBatch(collect, 1), 1u);
+  queue.Push(&items[0]);
+  ASSERT_EQ(queue.DrainBatch(collect), 2u);
+  ASSERT_EQ(values, std::vector<int>({1, 2, 0}));
+  ASSERT_EQ(queue.Pop(), nullptr);
+}
+
+// 多个生产者并发入队, 每个生产者的节点按入队顺序出队
+TEST(MpscQueueTest, concurrency_push) {
+  constexpr int kThreadCnt = 4;
+  constexpr int kLoopCount = 50000;
+
+  MpscQueue<Item> queue;
+  std::vector<std::thread> thread_list;
+  for (int i = 0; i < kThreadCnt; ++i) {
+    thread_list.emplace_back([&queue, i]() {
+      for (int j = 0; j < kLoopCount; ++j) {
+        queue.Push(new Item(i * kLoopCount + j));
+      }
+    });
+  }
+
+  std::vector<int> last(kThreadCnt, -1);
+  int received = 0;
+  while (received < kThreadCnt * kLoopCount) {
+    received += static_cast<int>(queue.DrainBatch([&last](Item* item) {
+      int producer = item->value / kLoopCount;
+      EXPECT_GT(item->value, last[producer]);
+      last[producer] = item->value;
+      delete item;
+    }));
+  }
+  for (auto&& thread : thread_list) {
+    thread.join();
+  }
+  ASSERT_EQ(queue.Pop(), nullptr);
+}
+
+// 消费者在 epoll 上睡眠, 生产者入队后唤醒它
+TEST(MpscInboxTest, epoll_wakeup) {
+  constexpr int kThreadCnt = 4;
+  constexpr int kLoopCount = 20000;
+
+  MpscInbox<Item> inbox;
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_NE(epoll_fd, -1);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = inbox.fd();
+  ASSERT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inbox.fd(), &ev), 0);
+
+  std::vector<std::thread> thread_list;
+  for (int i = 0; i < kThreadCnt; ++i) {
+    thread_list.emplace_back([&inbox]() {
+      for (int j = 0; j < kLoopCount; ++j) {
+        inbox.Push(new Item(j));
+        if (j % 1000 == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+  }
+
+  int received = 0;
+  int64_t sum = 0;
+  struct epoll_event events[1];
+  while (received < kThreadCnt * kLoopCount) {
+    // 没有通知时不应该一直等待, 超时说明丢失了唤醒
+    ASSERT_EQ(epoll_wait(epoll_fd, events, 1, 5000), 1);
+    received += static_cast<int>(inbox.Drain(
+        [&sum](Item* item) {
+          sum += item->value;
+          delete item;
+        },
+        256));
+  }
+  for (auto&& thread : thread_list) {
+    thread.join();
+  }
+  ASSERT_EQ(sum, static_cast<int64_t>(kThreadCnt) * kLoopCount * (kLoopCount - 1) / 2);
+  ASSERT_FALSE(inbox.Wait(0));
+  close(epoll_fd);
+}
+
+TEST(MpscInboxTest, wait) {
+  MpscInbox<Item> inbox;
+  ASSERT_FALSE(inbox.Wait(10));
+  Item item(1);
+  std::thread producer([&inbox, &item]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    inbox.Push(&item);
+  });
+  ASSERT_TRUE(inbox.Wait(-1));
+  Item* popped = nullptr;
+  auto collect = [&popped](Item* node) {
+    popped = node;
+  };
+  ASSERT_EQ(inbox.Drain(collect), 1u);
+  ASSERT_EQ(popped, &item);
+  producer.join();
+}
+
+}  // namespace lock_free
+
+}  // namespace cpputil
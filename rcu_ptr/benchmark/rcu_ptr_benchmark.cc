@@ -0,0 +1,135 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "rcu_ptr/rcu_ptr.h"
+
+/**
+ * 对比多线程读的吞吐, 同时有一个写线程每毫秒替换一次数据
+ *
+ * 1. atomic_load: 旧实现, std::atomic_load 读 std::shared_ptr, libstdc++ 中使用全局的互斥锁池
+ * 2. Load: rcu_ptr::Load, hazard pointer 保护后拷贝 std::shared_ptr, 仍然修改引用计数
+ * 3. ReadLock: rcu_ptr::ReadLock, 只写线程独占的 hazard 槽位
+ *
+ * 以及多个写线程并发修改一个较大的 std::vector 时的写吞吐
+ *
+ * 4. Update: 每个写线程各自深拷贝, CAS 失败后整体重试
+ * 5. CombiningUpdate: 并发的写合并成一个批次, 每批只拷贝和发布一次
+ *
+ * $./rcu_ptr_benchmark [threads]
+ */
+namespace {
+
+using Data = std::vector<int>;
+constexpr auto kDuration = std::chrono::seconds(1);
+// 防止读操作被优化掉
+std::atomic<size_t> g_sink = {0};
+
+template <typename ReadFunc, typename WriteFunc>
+double Bench(int threads, ReadFunc read, WriteFunc write) {
+  std::atomic<bool> stop = {false};
+  std::atomic<int64_t> reads = {0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < threads; ++i) {
+    readers.emplace_back([&]() {
+      int64_t local = 0;
+      size_t sum = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        sum += read();
+        ++local;
+      }
+      reads.fetch_add(local, std::memory_order_relaxed);
+      g_sink.fetch_add(sum, std::memory_order_relaxed);
+    });
+  }
+  std::thread writer([&]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      write();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  std::this_thread::sleep_for(kDuration);
+  stop = true;
+  for (auto&& reader : readers) {
+    reader.join();
+  }
+  writer.join();
+  return reads.load() / std::chrono::duration<double>(kDuration).count();
+}
+
+template <typename UpdateFunc>
+double BenchWrite(int threads, UpdateFunc update) {
+  constexpr int kUpdates = 2000;
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> writers;
+  for (int i = 0; i < threads; ++i) {
+    writers.emplace_back([&update]() {
+      for (int j = 0; j < kUpdates; ++j) {
+        update([j](Data* data) {
+          (*data)[j % data->size()] += 1;
+        });
+      }
+    });
+  }
+  for (auto&& writer : writers) {
+    writer.join();
+  }
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return threads * kUpdates / cost.count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+
+  std::shared_ptr<const Data> sp = std::make_shared<Data>(16, 1);
+  double atomic_load = Bench(
+      threads,
+      [&sp]() {
+        return std::atomic_load_explicit(&sp, std::memory_order_acquire)->size();
+      },
+      [&sp]() {
+        std::atomic_store_explicit(&sp, std::shared_ptr<const Data>(std::make_shared<Data>(16, 1)),
+                                   std::memory_order_release);
+      });
+
+  util::rcu_ptr<Data> rp(std::make_shared<Data>(16, 1));
+  auto write = [&rp]() {
+    rp.Store(std::make_shared<Data>(16, 1));
+  };
+  double load = Bench(
+      threads,
+      [&rp]() {
+        return rp.Load()->size();
+      },
+      write);
+  double read_lock = Bench(
+      threads,
+      [&rp]() {
+        return rp.ReadLock()->size();
+      },
+      write);
+
+  constexpr size_t kLargeSize = 100000;
+  util::rcu_ptr<Data> large(std::make_shared<Data>(kLargeSize, 0));
+  double update = BenchWrite(threads, [&large](auto&& func) {
+    large.Update(func);
+  });
+  double combining_update = BenchWrite(threads, [&large](auto&& func) {
+    large.CombiningUpdate(func);
+  });
+
+  printf("threads:%d\n", threads);
+  printf("%-12s %15.0f reads/s\n", "atomic_load", atomic_load);
+  printf("%-12s %15.0f reads/s\n", "Load", load);
+  printf("%-12s %15.0f reads/s\n", "ReadLock", read_lock);
+  printf("%-16s %11.0f updates/s\n", "Update", update);
+  printf("%-16s %11.0f updates/s\n", "CombiningUpdate", combining_update);
+  return 0;
+}
@@ -1,30 +1,106 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <memory>   // std::shared_ptr
+#include <mutex>
+#include <type_traits>
 #include <utility>  // std::move
+#include <vector>
+
+#include "lockfree/hazard_pointer/hazard_pointer.h"
 
 namespace util {
 
+/**
+ * @brief RCU 指针, 读不加锁, 写通过 CAS 发布新的副本
+ *
+ * 当前数据的 std::shared_ptr 放在一个堆上的 Holder 中, 用原子的裸指针指向它:
+ * 1. 读线程用 hazard pointer 保护 Holder, 不修改引用计数, 也不经过 libstdc++ 中 std::atomic_load 使用的全局锁
+ * 2. 写线程原子地替换 Holder 指针, 旧的 Holder 在没有读线程保护它之后才被回收
+ *    旧的 Holder 持有整份旧数据, 所以每次写都立即扫描回收, 不会攒下多个旧版本;
+ *    写的时候仍被 ReadGuard 保护的旧版本在同一线程的下一次写时回收
+ */
 template <typename T>
 class rcu_ptr {
+ private:
+  struct Holder {
+    explicit Holder(std::shared_ptr<const T> s) : sp(std::move(s)) {
+    }
+    std::shared_ptr<const T> sp;
+  };
+
  public:
-  rcu_ptr() = default;
-  ~rcu_ptr() = default;
+  /**
+   * @brief 读保护, 存活期间拿到的数据不会被回收, 只能在创建它的线程中使用
+   */
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&&) noexcept = default;
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ReadGuard& operator=(ReadGuard&&) = delete;
+
+   public:
+    const T& operator*() const {
+      return *data_;
+    }
+    const T* operator->() const {
+      return data_;
+    }
+    const T* get() const {
+      return data_;
+    }
+    explicit operator bool() const {
+      return data_ != nullptr;
+    }
+
+   private:
+    friend class rcu_ptr;
+    explicit ReadGuard(const std::atomic<Holder*>& holder) : data_(hp_.Protect(holder)->sp.get()) {
+    }
+
+   private:
+    cpputil::lock_free::HazardPointer hp_;
+    const T* data_;
+  };
+
+ public:
+  rcu_ptr() : holder_(new Holder(nullptr)) {
+  }
+  ~rcu_ptr() {
+    delete holder_.load(std::memory_order_relaxed);
+  }
   rcu_ptr(const rcu_ptr& rhs) = delete;
   rcu_ptr& operator=(const rcu_ptr& rhs) = delete;
   rcu_ptr(rcu_ptr&&) = delete;
-  explicit rcu_ptr(const std::shared_ptr<const T>& sp) : sp_(sp) {
+  explicit rcu_ptr(const std::shared_ptr<const T>& sp) : holder_(new Holder(sp)) {
   }
 
  public:
+  /**
+   * @brief 不修改引用计数地读取当前数据, 适合短小的读操作
+   *
+   * eg:
+   *     auto guard = rp.ReadLock();
+   *     size_t size = guard->size();
+   *
+   * @return ReadGuard 析构之前数据不会被回收, 数据为空时 operator bool 返回 false
+   */
+  inline ReadGuard ReadLock() const {
+    return ReadGuard(holder_);
+  }
+
   /**
    * @brief return a std::shared_ptr<const T> by value, therefore it is thread safe
+   *        the read path is lock-free, but the returned copy still bumps the reference count
    *
    * @return std::shared_ptr<const T>
    */
   inline std::shared_ptr<const T> Load() const {
-    return std::atomic_load_explicit(&sp_, std::memory_order_consume);
+    cpputil::lock_free::HazardPointer hp;
+    return hp.Protect(holder_)->sp;
   }
 
   /**
@@ -34,7 +110,7 @@ class rcu_ptr {
    * @param r
    */
   inline void Store(const std::shared_ptr<const T>& r) {
-    std::atomic_store_explicit(&sp_, r, std::memory_order_release);
+    Publish(new Holder(r));
   }
   /**
    * @brief receive a std::shared_ptr<const T> as an rvalue reference parameter
@@ -43,7 +119,7 @@ class rcu_ptr {
    * @param r
    */
   inline void Store(const std::shared_ptr<const T>&& r) {
-    std::atomic_store_explicit(&sp_, std::move(r), std::memory_order_release);
+    Publish(new Holder(std::move(r)));
   }
 
   /**
@@ -55,20 +131,124 @@ class rcu_ptr {
    */
   template <typename F>
   void Update(F&& func) {
-    std::shared_ptr<const T> sp_copy = std::atomic_load_explicit(&sp_, std::memory_order_consume);
-    std::shared_ptr<T> sp_deep_copy;
-    do {
-      if (sp_copy) {
-        sp_deep_copy = std::make_shared<T>(*sp_copy);
+    CopyAndPublish([&func](T* data) {
+      std::forward<F>(func)(data);
+    });
+  }
+
+  /**
+   * @brief 合并并发写: 写线程把 func 放入队列, 由其中一个写线程(leader)把队列中所有的 func
+   *        依次应用到同一份拷贝上并只发布一次, 其余写线程等待自己所在的批次发布后返回
+   *
+   * 1. 多个写线程并发修改很大的 T 时, 避免 Update 中每个写线程各自深拷贝、CAS 失败后整体重试
+   * 2. func 抛出的异常在调用它的写线程中重新抛出, 同一批次中其他 func 的修改照常发布
+   * 3. 和 Update/Store 并发时 CAS 可能失败, 这时整个批次在新的数据上重新执行, 所以 func 也可能被调用多次
+   * 4. 拷贝 T 时抛出异常(eg: std::bad_alloc)则整个批次都不发布, 批次中每个写线程都重新抛出该异常
+   *
+   * @tparam F is a lambda expression that receives a T* for the copy of the actual data
+   * @param func
+   */
+  template <typename F>
+  void CombiningUpdate(F&& func) {
+    CombineRequest req;
+    // F 可能是 const 的, 去掉 const 保存, 调用时再转回原来的类型
+    req.ctx = const_cast<void*>(static_cast<const void*>(std::addressof(func)));
+    req.invoke = [](void* ctx, T* data) {
+      (*static_cast<std::remove_reference_t<F>*>(ctx))(data);
+    };
+
+    std::unique_lock<std::mutex> lock(combine_mtx_);
+    pending_.push_back(&req);
+    while (!req.done) {
+      if (combining_) {
+        combine_cv_.wait(lock);
+        continue;
+      }
+      combining_ = true;
+      std::vector<CombineRequest*> batch;
+      batch.swap(pending_);
+      lock.unlock();
+      // 拷贝 T 或者分配内存失败时整个批次都没有发布, 异常交给批次中的每个写线程, 不能让等待者永远阻塞
+      std::exception_ptr batch_exception;
+      try {
+        ApplyBatch(batch);
+      } catch (...) {
+        batch_exception = std::current_exception();
+      }
+      lock.lock();
+      for (CombineRequest* r : batch) {
+        if (batch_exception) {
+          r->exception = batch_exception;
+        }
+        r->done = true;
       }
-      std::forward<F>(func)(sp_deep_copy.get());
-    } while (!std::atomic_compare_exchange_strong_explicit(&sp_, &sp_copy,
-                                                           std::shared_ptr<const T>(std::move(sp_deep_copy)),
-                                                           std::memory_order_release, std::memory_order_consume));
+      combining_ = false;
+      combine_cv_.notify_all();
+    }
+    lock.unlock();
+    if (req.exception) {
+      std::rethrow_exception(req.exception);
+    }
   }
 
  private:
-  std::shared_ptr<const T> sp_;
+  struct CombineRequest {
+    void* ctx = nullptr;
+    void (*invoke)(void* ctx, T* data) = nullptr;
+    std::exception_ptr exception;
+    // 由 combine_mtx_ 保护
+    bool done = false;
+  };
+
+  void ApplyBatch(const std::vector<CombineRequest*>& batch) {
+    CopyAndPublish([&batch](T* data) {
+      for (CombineRequest* r : batch) {
+        r->exception = nullptr;
+        try {
+          r->invoke(r->ctx, data);
+        } catch (...) {
+          r->exception = std::current_exception();
+        }
+      }
+    });
+  }
+
+  // 深拷贝当前数据, 用 mutate 修改后 CAS 发布, 失败时在新的数据上重试
+  template <typename Mutator>
+  void CopyAndPublish(Mutator&& mutate) {
+    cpputil::lock_free::HazardPointer hp;
+    Holder* old_holder = hp.Protect(holder_);
+    while (true) {
+      std::shared_ptr<T> sp_deep_copy;
+      if (old_holder->sp) {
+        sp_deep_copy = std::make_shared<T>(*old_holder->sp);
+      }
+      mutate(sp_deep_copy.get());
+      Holder* new_holder = new Holder(std::move(sp_deep_copy));
+      if (holder_.compare_exchange_strong(old_holder, new_holder, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed)) {
+        hp.Reset();
+        cpputil::lock_free::RetireAndReclaim(old_holder);
+        return;
+      }
+      delete new_holder;
+      old_holder = hp.Protect(holder_);
+    }
+  }
+
+  void Publish(Holder* new_holder) {
+    Holder* old_holder = holder_.exchange(new_holder, std::memory_order_acq_rel);
+    cpputil::lock_free::RetireAndReclaim(old_holder);
+  }
+
+ private:
+  std::atomic<Holder*> holder_;
+
+  // CombiningUpdate 的等待队列
+  std::mutex combine_mtx_;
+  std::condition_variable combine_cv_;
+  std::vector<CombineRequest*> pending_;
+  bool combining_ = false;
 };
 
 }  // namespace util
@@ -0,0 +1,213 @@
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "rcu_ptr/rcu_ptr.h"
+
+namespace {
+
+// 记录存活对象数量, 用于检查回收是否正确
+struct Counted {
+  static std::atomic<int> alive;
+  explicit Counted(int v) : value(v) {
+    ++alive;
+  }
+  Counted(const Counted& other) : value(other.value) {
+    ++alive;
+  }
+  ~Counted() {
+    --alive;
+  }
+  int value;
+};
+std::atomic<int> Counted::alive = {0};
+
+// fail_copy 为 true 时拷贝构造抛出异常
+struct ThrowOnCopy {
+  static std::atomic<bool> fail_copy;
+  ThrowOnCopy() = default;
+  ThrowOnCopy(const ThrowOnCopy& other) : values(other.values) {
+    if (fail_copy) {
+      throw std::runtime_error("copy failed");
+    }
+  }
+  std::vector<int> values;
+};
+std::atomic<bool> ThrowOnCopy::fail_copy = {false};
+
+}  // namespace
+
+TEST(RcuPtrTest, read_lock_test) {
+  util::rcu_ptr<std::vector<int>> empty;
+  ASSERT_FALSE(empty.ReadLock());
+  ASSERT_EQ(empty.Load(), nullptr);
+
+  util::rcu_ptr<std::vector<int>> rp(std::make_shared<std::vector<int>>());
+  rp.Update([](std::vector<int>* data) {
+    data->push_back(1);
+  });
+  {
+    auto guard = rp.ReadLock();
+    ASSERT_TRUE(guard);
+    ASSERT_EQ(guard->size(), 1u);
+  }
+  rp.Store(std::make_shared<std::vector<int>>(3, 0));
+  ASSERT_EQ(rp.ReadLock()->size(), 3u);
+  ASSERT_EQ(rp.Load()->size(), 3u);
+}
+
+TEST(RcuPtrTest, reclaim_test) {
+  {
+    util::rcu_ptr<Counted> rp(std::make_shared<Counted>(0));
+    ASSERT_EQ(Counted::alive.load(), 1);
+    for (int i = 1; i <= 100; ++i) {
+      rp.Store(std::make_shared<Counted>(i));
+      ASSERT_EQ(Counted::alive.load(), 1);
+      rp.Update([](Counted* data) {
+        ++data->value;
+      });
+      ASSERT_EQ(Counted::alive.load(), 1);
+    }
+  }
+  ASSERT_EQ(Counted::alive.load(), 0);
+
+  util::rcu_ptr<Counted> rp(std::make_shared<Counted>(0));
+  {
+    auto guard = rp.ReadLock();
+    for (int i = 1; i <= 100; ++i) {
+      rp.Store(std::make_shared<Counted>(i));
+    }
+    // 只有被 ReadGuard 保护的旧数据和当前数据存活
+    ASSERT_EQ(guard->value, 0);
+    ASSERT_EQ(Counted::alive.load(), 2);
+  }
+  // ReadGuard 析构之后, 下一次写回收之前保留的旧数据
+  rp.Store(std::make_shared<Counted>(0));
+  ASSERT_EQ(Counted::alive.load(), 1);
+}
+
+TEST(RcuPtrTest, concurrent_test) {
+  util::rcu_ptr<std::vector<int>> rp(std::make_shared<std::vector<int>>());
+  std::atomic<bool> stop = {false};
+  std::atomic<bool> failed = {false};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&rp, &stop, &failed]() {
+      while (!stop) {
+        auto guard = rp.ReadLock();
+        // 每个版本都是 0, 1, 2, ... 的前缀
+        for (size_t j = 0; j < guard->size(); ++j) {
+          if ((*guard)[j] != static_cast<int>(j)) {
+            failed = true;
+          }
+        }
+      }
+    });
+  }
+
+  const int kWriters = 2;
+  const int kUpdates = 500;
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kWriters; ++i) {
+    writers.emplace_back([&rp]() {
+      for (int j = 0; j < kUpdates; ++j) {
+        rp.Update([](std::vector<int>* data) {
+          data->push_back(static_cast<int>(data->size()));
+        });
+      }
+    });
+  }
+  for (auto&& writer : writers) {
+    writer.join();
+  }
+  stop = true;
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  ASSERT_FALSE(failed);
+  ASSERT_EQ(rp.Load()->size(), static_cast<size_t>(kWriters * kUpdates));
+}
+
+TEST(RcuPtrTest, combining_update_test) {
+  util::rcu_ptr<std::vector<int>> rp(std::make_shared<std::vector<int>>());
+  std::atomic<int> calls = {0};
+
+  const int kWriters = 4;
+  const int kUpdates = 500;
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kWriters; ++i) {
+    writers.emplace_back([&rp, &calls]() {
+      for (int j = 0; j < kUpdates; ++j) {
+        rp.CombiningUpdate([&calls](std::vector<int>* data) {
+          ++calls;
+          data->push_back(static_cast<int>(data->size()));
+        });
+      }
+    });
+  }
+  for (auto&& writer : writers) {
+    writer.join();
+  }
+  auto guard = rp.ReadLock();
+  ASSERT_EQ(guard->size(), static_cast<size_t>(kWriters * kUpdates));
+  ASSERT_EQ(calls.load(), kWriters * kUpdates);
+  for (size_t i = 0; i < guard->size(); ++i) {
+    ASSERT_EQ((*guard)[i], static_cast<int>(i));
+  }
+
+  // 异常只在抛出它的写线程中重新抛出
+  ASSERT_THROW(rp.CombiningUpdate([](std::vector<int>*) {
+    throw std::runtime_error("update failed");
+  }),
+               std::runtime_error);
+  rp.CombiningUpdate([](std::vector<int>* data) {
+    data->clear();
+  });
+  ASSERT_TRUE(rp.ReadLock()->empty());
+
+  // const 左值的 functor
+  const auto push_one = [](std::vector<int>* data) {
+    data->push_back(1);
+  };
+  rp.CombiningUpdate(push_one);
+  rp.Update(push_one);
+  ASSERT_EQ(rp.ReadLock()->size(), 2u);
+}
+
+TEST(RcuPtrTest, combining_update_copy_throws) {
+  util::rcu_ptr<ThrowOnCopy> rp(std::make_shared<ThrowOnCopy>());
+  auto push_one = [](ThrowOnCopy* data) {
+    data->values.push_back(1);
+  };
+
+  // 拷贝失败时批次中的每个写线程都收到异常, 数据保持不变
+  ThrowOnCopy::fail_copy = true;
+  const int kWriters = 4;
+  std::atomic<int> failed = {0};
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kWriters; ++i) {
+    writers.emplace_back([&rp, &failed, &push_one]() {
+      for (int j = 0; j < 100; ++j) {
+        try {
+          rp.CombiningUpdate(push_one);
+        } catch (const std::runtime_error&) {
+          ++failed;
+        }
+      }
+    });
+  }
+  for (auto&& writer : writers) {
+    writer.join();
+  }
+  ASSERT_EQ(failed.load(), kWriters * 100);
+  ASSERT_TRUE(rp.ReadLock()->values.empty());
+
+  // 之后的写不会被卡住
+  ThrowOnCopy::fail_copy = false;
+  rp.CombiningUpdate(push_one);
+  ASSERT_EQ(rp.ReadLock()->values.size(), 1u);
+}
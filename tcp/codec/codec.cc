@@ -0,0 +1,117 @@
+#include "tcp/codec/codec.h"
+
+namespace tcp {
+
+bool DelimiterCodec::Decode(ByteRingBuffer* const buffer, std::vector<std::string>* const frames) const {
+  if (delim_.empty()) {
+    if (buffer->ReadableSize() > 0) {
+      std::string frame;
+      buffer->PeekTo(0, buffer->ReadableSize(), &frame);
+      buffer->Consume(buffer->ReadableSize());
+      frames->emplace_back(std::move(frame));
+    }
+    return true;
+  }
+
+  std::size_t pos = 0;
+  while ((pos = buffer->Find(delim_, buffer->ScanOffset())) != ByteRingBuffer::npos) {
+    if (pos > max_frame_size_) {
+      return false;
+    }
+    std::string frame;
+    frame.reserve(pos);
+    buffer->PeekTo(0, pos, &frame);
+    buffer->Consume(pos + delim_.size());
+    frames->emplace_back(std::move(frame));
+  }
+
+  // 末尾不足 delim_.size() 的字节可能是被拆开的分隔符, 下次从这里重新查找
+  std::size_t readable = buffer->ReadableSize();
+  buffer->SetScanOffset(readable >= delim_.size() ? readable - delim_.size() + 1 : 0);
+
+  // 剩下的是半包, 超过上限仍未读到 delim 说明数据非法
+  return readable <= max_frame_size_ + delim_.size();
+}
+
+void DelimiterCodec::Encode(const char* data, std::size_t size, std::string* const out) const {
+  out->reserve(out->size() + size + delim_.size());
+  out->append(data, size);
+  out->append(delim_);
+}
+
+bool LengthPrefixCodec::Decode(ByteRingBuffer* const buffer, std::vector<std::string>* const frames) const {
+  while (true) {
+    uint64_t length = 0;
+    int header_size = DecodeLength(*buffer, &length);
+    if (header_size < 0 || length > max_frame_size_) {
+      return false;
+    }
+    if (header_size == 0) {
+      return true;
+    }
+
+    std::size_t frame_size = header_size + length;
+    if (buffer->ReadableSize() < frame_size) {
+      // 一次性为整帧预留空间, 后续数据直接读进缓冲区, 不会因为多次扩容反复搬移
+      buffer->Reserve(frame_size - buffer->ReadableSize());
+      return true;
+    }
+
+    std::string frame;
+    frame.reserve(length);
+    buffer->PeekTo(header_size, length, &frame);
+    buffer->Consume(frame_size);
+    frames->emplace_back(std::move(frame));
+  }
+}
+
+void LengthPrefixCodec::Encode(const char* data, std::size_t size, std::string* const out) const {
+  out->reserve(out->size() + size + 5);
+  uint32_t length = static_cast<uint32_t>(size);
+  if (length_type_ == LengthType::FIXED32) {
+    out->push_back(static_cast<char>((length >> 24) & 0xFF));
+    out->push_back(static_cast<char>((length >> 16) & 0xFF));
+    out->push_back(static_cast<char>((length >> 8) & 0xFF));
+    out->push_back(static_cast<char>(length & 0xFF));
+  } else {
+    while (length >= 0x80) {
+      out->push_back(static_cast<char>((length & 0x7F) | 0x80));
+      length >>= 7;
+    }
+    out->push_back(static_cast<char>(length));
+  }
+  out->append(data, size);
+}
+
+int LengthPrefixCodec::DecodeLength(const ByteRingBuffer& buffer, uint64_t* const length) const {
+  std::size_t readable = buffer.ReadableSize();
+  if (length_type_ == LengthType::FIXED32) {
+    if (readable < 4) {
+      return 0;
+    }
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+      value = (value << 8) | static_cast<uint8_t>(buffer.At(i));
+    }
+    *length = value;
+    return 4;
+  }
+
+  static constexpr std::size_t kMaxVarintSize = 5;
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < kMaxVarintSize; ++i) {
+    if (i >= readable) {
+      return 0;
+    }
+    uint8_t byte = static_cast<uint8_t>(buffer.At(i));
+    value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      *length = value;
+      return static_cast<int>(i + 1);
+    }
+  }
+  // 超过 5 字节仍未结束, 不是合法的 32 位 varint
+  return -1;
+}
+
+}  // namespace tcp
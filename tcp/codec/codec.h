@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tcp/codec/ring_buffer.h"
+
+namespace tcp {
+
+/**
+ * @brief 帧编解码接口
+ *
+ * 解码状态全部保存在连接自己的 ByteRingBuffer 中, Codec 本身无状态, 可以在多个连接和线程之间共享
+ */
+class Codec {
+ public:
+  Codec() = default;
+  virtual ~Codec() = default;
+
+ public:
+  /**
+   * @brief 从 buffer 中解码出尽可能多的完整帧(不含分隔符或长度头), 半包留在 buffer 中等待后续数据
+   *
+   * @param buffer 连接的接收缓冲区, 已解码的数据会被消费掉
+   * @param frames 输出参数, 追加解码出的帧
+   * @return bool 数据非法(eg: 帧长度超过上限)时返回 false, 调用方应断开连接
+   */
+  virtual bool Decode(ByteRingBuffer* const buffer, std::vector<std::string>* const frames) const = 0;
+
+  /**
+   * @brief 将 payload 编码成一帧追加到 out
+   *
+   * @param data
+   * @param size
+   * @param out
+   */
+  virtual void Encode(const char* data, std::size_t size, std::string* const out) const = 0;
+
+  void Encode(const std::string& payload, std::string* const out) const {
+    Encode(payload.data(), payload.size(), out);
+  }
+};
+
+/**
+ * @brief 基于分隔符的编解码, eg: 以 '\n' 结尾的文本协议
+ *
+ * 分隔符为空时不做切分, 每次解码把收到的所有数据作为一帧
+ */
+class DelimiterCodec : public Codec {
+ public:
+  explicit DelimiterCodec(const std::string& delim, std::size_t max_frame_size = 1024 * 1024)
+      : delim_(delim), max_frame_size_(max_frame_size) {
+  }
+
+ public:
+  bool Decode(ByteRingBuffer* const buffer, std::vector<std::string>* const frames) const override;
+  void Encode(const char* data, std::size_t size, std::string* const out) const override;
+  using Codec::Encode;
+
+ private:
+  std::string delim_;
+  std::size_t max_frame_size_;
+};
+
+/**
+ * @brief 基于长度前缀的二进制编解码
+ *
+ * 每帧由长度头和 payload 组成, 长度头支持两种格式:
+ * 1. FIXED32: 4 字节大端无符号整数
+ * 2. VARINT: protobuf 风格的 varint, 每字节低 7 位有效, 最高位表示后面是否还有字节, 最多 5 字节
+ *
+ * 解析出长度头后会一次性为整帧预留空间, 大帧后续的数据直接读进缓冲区, 整帧只在解码完成时拷贝一次
+ */
+class LengthPrefixCodec : public Codec {
+ public:
+  enum class LengthType {
+    FIXED32 = 0,
+    VARINT = 1,
+  };
+
+ public:
+  explicit LengthPrefixCodec(LengthType length_type, std::size_t max_frame_size = 64 * 1024 * 1024)
+      : length_type_(length_type), max_frame_size_(max_frame_size) {
+  }
+
+ public:
+  bool Decode(ByteRingBuffer* const buffer, std::vector<std::string>* const frames) const override;
+  void Encode(const char* data, std::size_t size, std::string* const out) const override;
+  using Codec::Encode;
+
+ private:
+  /**
+   * @brief 解析长度头
+   *
+   * @return int 长度头的字节数, 数据不足时返回 0, 数据非法时返回 -1
+   */
+  int DecodeLength(const ByteRingBuffer& buffer, uint64_t* const length) const;
+
+ private:
+  LengthType length_type_;
+  std::size_t max_frame_size_;
+};
+
+}  // namespace tcp
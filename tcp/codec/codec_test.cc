@@ -0,0 +1,147 @@
+#include "tcp/codec/codec.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tcp {
+
+TEST(ByteRingBufferTest, wrap_around_and_grow) {
+  ByteRingBuffer buffer(16);
+  EXPECT_EQ(16u, buffer.Capacity());
+
+  // 先写 12 字节再消费 10 字节, 使后续写入发生回绕
+  buffer.Append("0123456789ab", 12);
+  buffer.Consume(10);
+  buffer.Append("cdefghij", 8);
+  EXPECT_EQ(10u, buffer.ReadableSize());
+  EXPECT_EQ(16u, buffer.Capacity());
+
+  std::string out;
+  buffer.PeekTo(0, buffer.ReadableSize(), &out);
+  EXPECT_EQ("abcdefghij", out);
+  EXPECT_EQ(3u, buffer.Find("def", 0));
+  EXPECT_EQ(ByteRingBuffer::npos, buffer.Find("xyz", 0));
+
+  // 扩容后数据保持不变
+  buffer.Reserve(100);
+  EXPECT_GE(buffer.WritableSize(), 100u);
+  out.clear();
+  buffer.PeekTo(0, buffer.ReadableSize(), &out);
+  EXPECT_EQ("abcdefghij", out);
+}
+
+TEST(DelimiterCodecTest, decode_partial_and_multiple_frames) {
+  DelimiterCodec codec("\r\n");
+  ByteRingBuffer buffer(16);
+  std::vector<std::string> frames;
+
+  // 分隔符被拆在两次读中
+  buffer.Append("hello\r", 6);
+  EXPECT_TRUE(codec.Decode(&buffer, &frames));
+  EXPECT_TRUE(frames.empty());
+
+  buffer.Append("\nworld\r\nfoo", 11);
+  EXPECT_TRUE(codec.Decode(&buffer, &frames));
+  ASSERT_EQ(2u, frames.size());
+  EXPECT_EQ("hello", frames[0]);
+  EXPECT_EQ("world", frames[1]);
+  EXPECT_EQ(3u, buffer.ReadableSize());
+
+  std::string encoded;
+  codec.Encode("bar", &encoded);
+  EXPECT_EQ("bar\r\n", encoded);
+}
+
+TEST(DelimiterCodecTest, resume_scan) {
+  DelimiterCodec codec("\r\n\r\n");
+  ByteRingBuffer buffer(16);
+  std::vector<std::string> frames;
+
+  // 已经查找过的数据不会重复扫描, 末尾可能是分隔符前缀的 3 字节除外
+  buffer.Append("abcdef", 6);
+  EXPECT_TRUE(codec.Decode(&buffer, &frames));
+  EXPECT_TRUE(frames.empty());
+  EXPECT_EQ(3u, buffer.ScanOffset());
+
+  // 逐字节到达, 分隔符被拆在多次读中
+  const std::string input = "\r\n\r\nhead\r\n\r\n\r\n\r\ntail";
+  for (char c : input) {
+    buffer.Append(&c, 1);
+    EXPECT_TRUE(codec.Decode(&buffer, &frames));
+    EXPECT_LE(buffer.ScanOffset(), buffer.ReadableSize());
+  }
+  ASSERT_EQ(3u, frames.size());
+  EXPECT_EQ("abcdef", frames[0]);
+  EXPECT_EQ("head", frames[1]);
+  EXPECT_EQ("", frames[2]);
+  EXPECT_EQ(4u, buffer.ReadableSize());
+  EXPECT_EQ(1u, buffer.ScanOffset());
+
+  buffer.Consume(2);
+  EXPECT_EQ(0u, buffer.ScanOffset());
+  buffer.Clear();
+  EXPECT_EQ(0u, buffer.ScanOffset());
+}
+
+TEST(DelimiterCodecTest, frame_too_large) {
+  DelimiterCodec codec("\n", 8);
+  ByteRingBuffer buffer;
+  std::vector<std::string> frames;
+
+  buffer.Append("0123456789", 10);
+  EXPECT_FALSE(codec.Decode(&buffer, &frames));
+}
+
+TEST(LengthPrefixCodecTest, round_trip) {
+  for (auto type : {LengthPrefixCodec::LengthType::FIXED32, LengthPrefixCodec::LengthType::VARINT}) {
+    LengthPrefixCodec codec(type);
+    std::vector<std::string> payloads = {"", "a", std::string(127, 'b'), std::string(128, 'c'),
+                                         std::string(100000, 'd')};
+    std::string wire;
+    for (auto&& payload : payloads) {
+      codec.Encode(payload, &wire);
+    }
+
+    // 每次只喂 1000 字节, 模拟大帧被拆成多次读取
+    ByteRingBuffer buffer(64);
+    std::vector<std::string> frames;
+    for (std::size_t pos = 0; pos < wire.size(); pos += 1000) {
+      std::size_t size = std::min<std::size_t>(1000, wire.size() - pos);
+      buffer.Append(wire.data() + pos, size);
+      EXPECT_TRUE(codec.Decode(&buffer, &frames));
+    }
+    EXPECT_EQ(payloads, frames);
+    EXPECT_EQ(0u, buffer.ReadableSize());
+  }
+}
+
+TEST(LengthPrefixCodecTest, header_format) {
+  std::string wire;
+  LengthPrefixCodec(LengthPrefixCodec::LengthType::FIXED32).Encode(std::string(258, 'x'), &wire);
+  EXPECT_EQ(std::string("\x00\x00\x01\x02", 4), wire.substr(0, 4));
+
+  wire.clear();
+  LengthPrefixCodec(LengthPrefixCodec::LengthType::VARINT).Encode(std::string(300, 'x'), &wire);
+  EXPECT_EQ(std::string("\xAC\x02", 2), wire.substr(0, 2));
+}
+
+TEST(LengthPrefixCodecTest, invalid_frame) {
+  LengthPrefixCodec codec(LengthPrefixCodec::LengthType::VARINT, 1024);
+  std::vector<std::string> frames;
+
+  // 长度超过上限
+  ByteRingBuffer buffer;
+  std::string wire;
+  codec.Encode(std::string(2048, 'x'), &wire);
+  buffer.Append(wire.data(), 2);
+  EXPECT_FALSE(codec.Decode(&buffer, &frames));
+
+  // varint 超过 5 字节
+  ByteRingBuffer bad_buffer;
+  bad_buffer.Append("\xFF\xFF\xFF\xFF\xFF\xFF", 6);
+  EXPECT_FALSE(codec.Decode(&bad_buffer, &frames));
+}
+
+}  // namespace tcp
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tcp {
+
+/**
+ * @brief 可扩容的字节环形缓冲区, 用于在连接上重组被拆开的帧
+ *
+ * 1. 容量始终是 2 的幂, 下标通过掩码取模
+ * 2. read_idx_ 和 write_idx_ 单调递增, 二者之差即为可读字节数
+ * 3. 通过 WritableSpans + readv 可以直接从 socket 读入环形缓冲区, 不需要中间缓冲
+ */
+class ByteRingBuffer {
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+ public:
+  explicit ByteRingBuffer(std::size_t initial_capacity = 4096) {
+    data_.resize(RoundUpPowerOfTwo(std::max<std::size_t>(initial_capacity, 16)));
+    mask_ = data_.size() - 1;
+  }
+
+ public:
+  std::size_t ReadableSize() const {
+    return write_idx_ - read_idx_;
+  }
+
+  std::size_t WritableSize() const {
+    return data_.size() - ReadableSize();
+  }
+
+  std::size_t Capacity() const {
+    return data_.size();
+  }
+
+  /**
+   * @brief 保证至少有 size 字节的可写空间, 扩容时会把可读数据整理到缓冲区开头
+   *
+   * @param size
+   */
+  void Reserve(std::size_t size) {
+    if (WritableSize() >= size) {
+      return;
+    }
+    std::size_t readable = ReadableSize();
+    std::vector<char> new_data(RoundUpPowerOfTwo(readable + size));
+    Peek(0, readable, new_data.data());
+    data_.swap(new_data);
+    mask_ = data_.size() - 1;
+    read_idx_ = 0;
+    write_idx_ = readable;
+  }
+
+  /**
+   * @brief 获取可写区域, 因为环形回绕最多有两段
+   *
+   * @param iov 输出参数, 至少有两个元素
+   * @return int 可写区域的段数
+   */
+  int WritableSpans(struct iovec* iov) {
+    std::size_t writable = WritableSize();
+    if (writable == 0) {
+      return 0;
+    }
+    std::size_t pos = write_idx_ & mask_;
+    std::size_t first = std::min(writable, data_.size() - pos);
+    iov[0].iov_base = data_.data() + pos;
+    iov[0].iov_len = first;
+    if (first == writable) {
+      return 1;
+    }
+    iov[1].iov_base = data_.data();
+    iov[1].iov_len = writable - first;
+    return 2;
+  }
+
+  /**
+   * @brief 确认通过 WritableSpans 写入了 size 字节
+   *
+   * @param size
+   */
+  void CommitWrite(std::size_t size) {
+    write_idx_ += size;
+  }
+
+  void Append(const char* data, std::size_t size) {
+    Reserve(size);
+    std::size_t pos = write_idx_ & mask_;
+    std::size_t first = std::min(size, data_.size() - pos);
+    ::memcpy(data_.data() + pos, data, first);
+    ::memcpy(data_.data(), data + first, size - first);
+    write_idx_ += size;
+  }
+
+  /**
+   * @brief 返回第 offset 个可读字节
+   */
+  char At(std::size_t offset) const {
+    return data_[(read_idx_ + offset) & mask_];
+  }
+
+  /**
+   * @brief 从第 offset 个可读字节开始拷贝 size 字节到 dst, 不移动读下标
+   */
+  void Peek(std::size_t offset, std::size_t size, char* dst) const {
+    std::size_t pos = (read_idx_ + offset) & mask_;
+    std::size_t first = std::min(size, data_.size() - pos);
+    ::memcpy(dst, data_.data() + pos, first);
+    ::memcpy(dst + first, data_.data(), size - first);
+  }
+
+  /**
+   * @brief 从第 offset 个可读字节开始取出 size 字节追加到 out, 不移动读下标
+   */
+  void PeekTo(std::size_t offset, std::size_t size, std::string* const out) const {
+    std::size_t pos = (read_idx_ + offset) & mask_;
+    std::size_t first = std::min(size, data_.size() - pos);
+    out->append(data_.data() + pos, first);
+    out->append(data_.data(), size - first);
+  }
+
+  void Consume(std::size_t size) {
+    size = std::min(size, ReadableSize());
+    read_idx_ += size;
+    scan_offset_ -= std::min(size, scan_offset_);
+    // 读空时重置下标, 让后续数据尽量连续存放
+    if (read_idx_ == write_idx_) {
+      read_idx_ = write_idx_ = 0;
+    }
+  }
+
+  void Clear() {
+    read_idx_ = write_idx_ = 0;
+    scan_offset_ = 0;
+  }
+
+  /**
+   * @brief 解码器已经查找过的位置(相对于读下标), 半包时下次从这里继续查找, 不必每次从头扫描
+   *
+   * Consume 时随读下标一起前移
+   */
+  std::size_t ScanOffset() const {
+    return scan_offset_;
+  }
+
+  void SetScanOffset(std::size_t offset) {
+    scan_offset_ = std::min(offset, ReadableSize());
+  }
+
+  /**
+   * @brief 从第 from 个可读字节开始查找 pattern
+   *
+   * @return std::size_t 相对于读下标的偏移, 找不到时返回 npos
+   */
+  std::size_t Find(const std::string& pattern, std::size_t from) const {
+    std::size_t readable = ReadableSize();
+    if (pattern.empty() || readable < pattern.size()) {
+      return npos;
+    }
+    std::size_t last = readable - pattern.size();
+    for (std::size_t i = from; i <= last; ++i) {
+      // 先用 memchr 在连续的一段内找到首字符, 再逐字节比较剩余部分
+      std::size_t pos = (read_idx_ + i) & mask_;
+      std::size_t span = std::min(last - i + 1, data_.size() - pos);
+      const void* hit = ::memchr(data_.data() + pos, pattern[0], span);
+      if (hit == nullptr) {
+        i += span - 1;
+        continue;
+      }
+      i += static_cast<const char*>(hit) - (data_.data() + pos);
+      std::size_t k = 1;
+      while (k < pattern.size() && At(i + k) == pattern[k]) {
+        ++k;
+      }
+      if (k == pattern.size()) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+ private:
+  static std::size_t RoundUpPowerOfTwo(std::size_t n) {
+    std::size_t power = 1;
+    while (power < n) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+ private:
+  std::vector<char> data_;
+  std::size_t mask_ = 0;
+  uint64_t read_idx_ = 0;
+  uint64_t write_idx_ = 0;
+  std::size_t scan_offset_ = 0;
+};
+
+}  // namespace tcp
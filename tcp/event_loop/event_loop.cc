@@ -0,0 +1,226 @@
+#include "tcp/event_loop/event_loop.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "logger/log.h"
+
+namespace tcp {
+
+EventLoop::EventLoop(const std::string& name) : name_(name) {
+}
+
+EventLoop::~EventLoop() {
+  Stop();
+  if (wakeup_fd_ != -1) {
+    close(wakeup_fd_);
+    wakeup_fd_ = -1;
+  }
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
+
+bool EventLoop::Start() {
+  if (!is_stop_) {
+    LOG_WARN << "[" << name_ << "]: event loop is already started";
+    return true;
+  }
+
+  if (epoll_fd_ == -1) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+      LOG_ERROR << "[" << name_ << "]: epoll_create1() fail: " << std::strerror(errno);
+      return false;
+    }
+  }
+
+  if (wakeup_fd_ == -1) {
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+      LOG_ERROR << "[" << name_ << "]: eventfd() fail: " << std::strerror(errno);
+      return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeup_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev) == -1) {
+      LOG_ERROR << "[" << name_ << "]: epoll_ctl() fail: " << std::strerror(errno);
+      return false;
+    }
+  }
+
+  is_stop_ = false;
+  thread_ = std::thread(&EventLoop::Loop, this);
+  return true;
+}
+
+void EventLoop::Stop() {
+  if (is_stop_.exchange(true)) {
+    return;
+  }
+  Wakeup();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void EventLoop::RunInLoop(Task task) {
+  if (IsInLoopThread()) {
+    task();
+    return;
+  }
+  QueueInLoop(std::move(task));
+}
+
+void EventLoop::QueueInLoop(Task task) {
+  bool need_wakeup = false;
+  {
+    std::lock_guard<std::mutex> lock(task_mtx_);
+    // 队列非空时说明已经唤醒过了, 避免重复写 eventfd
+    need_wakeup = pending_tasks_.empty();
+    pending_tasks_.emplace_back(std::move(task));
+  }
+  if (need_wakeup || IsInLoopThread()) {
+    Wakeup();
+  }
+}
+
+void EventLoop::RunAfter(int64_t delay_ms, Task task) {
+  // 在调用时确定到期时间, 不受投递延迟影响
+  Clock::time_point expire_time = Clock::now() + std::chrono::milliseconds(std::max<int64_t>(delay_ms, 0));
+  auto shared_task = std::make_shared<Task>(std::move(task));
+  RunInLoop([this, expire_time, shared_task]() {
+    Timer timer;
+    timer.expire_time = expire_time;
+    timer.seq = next_timer_seq_++;
+    timer.task = std::move(*shared_task);
+    timers_.emplace_back(std::move(timer));
+    std::push_heap(timers_.begin(), timers_.end(), TimerGreater());
+  });
+}
+
+bool EventLoop::AddFd(int fd, uint32_t events, EventCallback callback) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    LOG_ERROR << "[" << name_ << "]: epoll_ctl() add fd " << fd << " fail: " << std::strerror(errno);
+    return false;
+  }
+  fd_to_callback_[fd] = std::make_shared<EventCallback>(std::move(callback));
+  return true;
+}
+
+bool EventLoop::ModifyFd(int fd, uint32_t events) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == -1) {
+    LOG_ERROR << "[" << name_ << "]: epoll_ctl() modify fd " << fd << " fail: " << std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::RemoveFd(int fd) {
+  // 内核 2.6.9 之前 EPOLL_CTL_DEL 要求 event 参数非空
+  struct epoll_event ev;
+  ::memset(&ev, 0, sizeof(ev));
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &ev);
+  fd_to_callback_.erase(fd);
+}
+
+void EventLoop::Wakeup() {
+  uint64_t one = 1;
+  if (write(wakeup_fd_, &one, sizeof(one)) != sizeof(one)) {
+    LOG_ERROR << "[" << name_ << "]: write eventfd fail: " << std::strerror(errno);
+  }
+}
+
+void EventLoop::HandleWakeup() {
+  uint64_t cnt = 0;
+  while (read(wakeup_fd_, &cnt, sizeof(cnt)) > 0) {
+  }
+}
+
+void EventLoop::DoPendingTasks() {
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(task_mtx_);
+    tasks.swap(pending_tasks_);
+  }
+  for (auto&& task : tasks) {
+    task();
+  }
+}
+
+int EventLoop::CalcEpollTimeout() const {
+  if (timers_.empty()) {
+    return -1;
+  }
+  auto remain = timers_.front().expire_time - Clock::now();
+  if (remain <= Clock::duration::zero()) {
+    return 0;
+  }
+  // 向上取整, 避免提前醒来后空转
+  auto remain_ms = std::chrono::ceil<std::chrono::milliseconds>(remain).count();
+  return static_cast<int>(std::min<int64_t>(remain_ms, std::numeric_limits<int>::max()));
+}
+
+void EventLoop::DoExpiredTimers() {
+  Clock::time_point now = Clock::now();
+  while (!timers_.empty() && timers_.front().expire_time <= now) {
+    std::pop_heap(timers_.begin(), timers_.end(), TimerGreater());
+    Task task = std::move(timers_.back().task);
+    timers_.pop_back();
+    task();
+  }
+}
+
+void EventLoop::Loop() {
+  thread_id_.store(std::this_thread::get_id(), std::memory_order_release);
+  struct epoll_event events[kMaxEpollEvents];
+
+  while (!is_stop_) {
+    int fd_cnt = epoll_wait(epoll_fd_, events, kMaxEpollEvents, CalcEpollTimeout());
+    if (fd_cnt == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR << "[" << name_ << "]: epoll_wait() fail: " << std::strerror(errno);
+      break;
+    }
+
+    for (int i = 0; i < fd_cnt; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == wakeup_fd_) {
+        HandleWakeup();
+        continue;
+      }
+      // 前面的回调可能已经移除了该 fd
+      auto iter = fd_to_callback_.find(fd);
+      if (iter == fd_to_callback_.end()) {
+        continue;
+      }
+      std::shared_ptr<EventCallback> callback = iter->second;
+      (*callback)(events[i].events);
+    }
+
+    DoExpiredTimers();
+    DoPendingTasks();
+  }
+
+  DoPendingTasks();
+  timers_.clear();
+  thread_id_.store(std::thread::id(), std::memory_order_release);
+}
+
+}  // namespace tcp
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util/macro_util.h"
+
+namespace tcp {
+
+/**
+ * @brief 单线程 Reactor: 一个 epoll 实例 + 一个事件线程
+ *
+ * 1. fd 的注册、修改和回调都只在事件线程中进行, 因此回调中访问连接状态无需加锁
+ * 2. 其他线程通过 RunInLoop 投递任务, 任务队列由 eventfd 唤醒事件线程
+ * 3. 定时任务保存在最小堆中, 由 epoll_wait 的超时时间驱动
+ */
+class EventLoop {
+ public:
+  using EventCallback = std::function<void(uint32_t events)>;
+  using Task = std::function<void()>;
+
+ public:
+  explicit EventLoop(const std::string& name);
+  ~EventLoop();
+
+ public:
+  /**
+   * @brief 创建 epoll 实例并启动事件线程
+   *
+   * @return bool 启动是否成功
+   */
+  bool Start();
+
+  /**
+   * @brief 停止并等待事件线程退出, 已经投递的任务会在退出前执行完, 不能在事件线程中调用
+   *
+   */
+  void Stop();
+
+  /**
+   * @brief 在事件线程中执行 task, 如果当前就在事件线程中则直接执行
+   *
+   * @param task
+   */
+  void RunInLoop(Task task);
+
+  /**
+   * @brief 将 task 放入任务队列, 由事件线程在本轮事件处理完后执行
+   *
+   * @param task
+   */
+  void QueueInLoop(Task task);
+
+  /**
+   * @brief delay_ms 毫秒后在事件线程中执行 task, 可以在任意线程中调用, 事件线程退出时未到期的任务会被丢弃
+   *
+   * @param delay_ms
+   * @param task
+   */
+  void RunAfter(int64_t delay_ms, Task task);
+
+  bool IsInLoopThread() const {
+    return std::this_thread::get_id() == thread_id_.load(std::memory_order_acquire);
+  }
+
+  const std::string& name() const {
+    return name_;
+  }
+
+ public:
+  // 以下接口只能在事件线程中调用
+
+  /**
+   * @brief 注册 fd 及其事件回调
+   *
+   * @param fd
+   * @param events eg: EPOLLIN | EPOLLET
+   * @param callback 参数为 epoll_wait 返回的事件
+   * @return bool
+   */
+  bool AddFd(int fd, uint32_t events, EventCallback callback);
+  bool ModifyFd(int fd, uint32_t events);
+  void RemoveFd(int fd);
+
+ private:
+  void Loop();
+  void Wakeup();
+  void HandleWakeup();
+  void DoPendingTasks();
+  int CalcEpollTimeout() const;
+  void DoExpiredTimers();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Timer {
+    Clock::time_point expire_time;
+    // 到期时间相同时按添加顺序执行
+    uint64_t seq = 0;
+    Task task;
+  };
+
+  // 用于 std::push_heap/std::pop_heap 构造最小堆
+  struct TimerGreater {
+    bool operator()(const Timer& lhs, const Timer& rhs) const {
+      if (lhs.expire_time != rhs.expire_time) {
+        return lhs.expire_time > rhs.expire_time;
+      }
+      return lhs.seq > rhs.seq;
+    }
+  };
+
+ private:
+  static constexpr uint32_t kMaxEpollEvents = 128;
+
+ private:
+  std::string name_;
+  int32_t epoll_fd_ = -1;
+  // 用于唤醒阻塞在 epoll_wait 中的事件线程
+  int32_t wakeup_fd_ = -1;
+
+  std::atomic<bool> is_stop_ = {true};
+  std::thread thread_;
+  std::atomic<std::thread::id> thread_id_;
+
+  std::mutex task_mtx_;
+  std::vector<Task> pending_tasks_;
+
+  // 回调中可能会移除 fd 自身, 使用 std::shared_ptr 保证回调执行期间不被析构
+  std::unordered_map<int32_t, std::shared_ptr<EventCallback>> fd_to_callback_;
+
+  // 只在事件线程中访问
+  std::vector<Timer> timers_;
+  uint64_t next_timer_seq_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(EventLoop);
+};
+
+}  // namespace tcp
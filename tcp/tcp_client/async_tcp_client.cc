@@ -0,0 +1,430 @@
+#include "tcp/tcp_client/async_tcp_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "logger/log.h"
+
+namespace tcp {
+
+std::shared_ptr<AsyncTcpClient> AsyncTcpClient::Create(EventLoop* loop, const std::string& name,
+                                                       const std::string& server_ip, uint16_t server_port,
+                                                       std::shared_ptr<const Codec> codec, const Options& options) {
+  if (!codec) {
+    codec = std::make_shared<DelimiterCodec>("\n");
+  }
+  // 构造函数是私有的, 无法使用 std::make_shared
+  return std::shared_ptr<AsyncTcpClient>(
+      new AsyncTcpClient(loop, name, server_ip, server_port, std::move(codec), options));
+}
+
+std::shared_ptr<AsyncTcpClient> AsyncTcpClient::Create(EventLoop* loop, const std::string& name,
+                                                       const std::string& server_ip, uint16_t server_port) {
+  return Create(loop, name, server_ip, server_port, nullptr, Options());
+}
+
+AsyncTcpClient::AsyncTcpClient(EventLoop* loop, const std::string& name, const std::string& server_ip,
+                               uint16_t server_port, std::shared_ptr<const Codec> codec, const Options& options)
+    : loop_(loop),
+      name_(name),
+      server_ip_(server_ip),
+      server_port_(server_port),
+      codec_(std::move(codec)),
+      options_(options) {
+}
+
+AsyncTcpClient::~AsyncTcpClient() {
+  OutboundNode* node = outbound_head_.exchange(nullptr);
+  while (node != nullptr) {
+    OutboundNode* next = node->next;
+    delete node;
+    node = next;
+  }
+
+  // 最后一个引用可能在其他线程中释放, fd 需要回到事件线程中移除
+  if (sockfd_ != -1) {
+    EventLoop* loop = loop_;
+    int32_t fd = sockfd_;
+    loop_->RunInLoop([loop, fd]() {
+      loop->RemoveFd(fd);
+      close(fd);
+    });
+  }
+}
+
+void AsyncTcpClient::Connect() {
+  is_active_ = true;
+  std::weak_ptr<AsyncTcpClient> weak_self = shared_from_this();
+  loop_->RunInLoop([weak_self]() {
+    auto self = weak_self.lock();
+    if (self && self->sockfd_ == -1) {
+      self->reconnect_delay_ms_ = 0;
+      self->StartConnect();
+    }
+  });
+}
+
+void AsyncTcpClient::Disconnect() {
+  is_active_ = false;
+  std::weak_ptr<AsyncTcpClient> weak_self = shared_from_this();
+  loop_->RunInLoop([weak_self]() {
+    auto self = weak_self.lock();
+    if (!self) {
+      return;
+    }
+    // 让已经安排的超时和重连任务失效
+    ++self->connect_seq_;
+    self->CloseSocket();
+    self->DrainOutbound();
+    std::size_t dropped = 0;
+    for (auto&& data : self->outbound_) {
+      dropped += data.size();
+    }
+    self->outbound_.clear();
+    self->pending_bytes_ -= dropped;
+    LOG_INFO << "[" << self->name_ << "]: disconnected by user";
+  });
+}
+
+bool AsyncTcpClient::Send(const std::string& payload) {
+  auto node = new OutboundNode();
+  codec_->Encode(payload, &node->data);
+
+  std::size_t size = node->data.size();
+  if (pending_bytes_.fetch_add(size) + size > options_.max_pending_bytes) {
+    pending_bytes_ -= size;
+    delete node;
+    LOG_WARN << "[" << name_ << "]: pending bytes reach " << options_.max_pending_bytes << ", drop message";
+    return false;
+  }
+
+  // 压入之后 node 可能立即被事件线程取走并释放, 之后只能使用局部变量 head
+  OutboundNode* head = outbound_head_.load(std::memory_order_relaxed);
+  do {
+    node->next = head;
+  } while (!outbound_head_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+  // 链表原本非空时说明已经有发送任务在排队了, 不必再唤醒事件线程
+  if (head == nullptr) {
+    std::weak_ptr<AsyncTcpClient> weak_self = shared_from_this();
+    loop_->QueueInLoop([weak_self]() {
+      auto self = weak_self.lock();
+      if (self) {
+        self->DrainOutbound();
+        if (self->state_ == State::CONNECTED) {
+          self->FlushOutbound();
+        }
+      }
+    });
+  }
+  return true;
+}
+
+void AsyncTcpClient::StartConnect() {
+  uint64_t connect_seq = ++connect_seq_;
+
+  struct sockaddr_in server_addr;
+  memset(&server_addr, 0, sizeof(server_addr));
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_port = htons(server_port_);
+  if (inet_pton(AF_INET, server_ip_.c_str(), &server_addr.sin_addr) != 1) {
+    // 地址非法时重连也没有意义
+    LOG_ERROR << "[" << name_ << "]: invalid server ip: " << server_ip_;
+    is_active_ = false;
+    return;
+  }
+
+  sockfd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (sockfd_ == -1) {
+    HandleError(std::string("socket() fail: ") + std::strerror(errno));
+    return;
+  }
+
+  int ret = connect(sockfd_, (struct sockaddr*)&server_addr, sizeof(server_addr));
+  if (ret == -1 && errno != EINPROGRESS) {
+    HandleError(std::string("connect() fail: ") + std::strerror(errno));
+    return;
+  }
+
+  // 连接建立后 fd 变为可写, 先监听 EPOLLOUT
+  std::weak_ptr<AsyncTcpClient> weak_self = shared_from_this();
+  bool ok = loop_->AddFd(sockfd_, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [weak_self](uint32_t events) {
+    auto self = weak_self.lock();
+    if (self) {
+      self->HandleEvent(events);
+    }
+  });
+  if (!ok) {
+    close(sockfd_);
+    sockfd_ = -1;
+    ScheduleReconnect();
+    return;
+  }
+  is_writing_ = true;
+  state_ = State::CONNECTING;
+
+  if (ret == 0) {
+    HandleConnected();
+    return;
+  }
+  loop_->RunAfter(options_.connect_timeout_ms, [weak_self, connect_seq]() {
+    auto self = weak_self.lock();
+    if (self) {
+      self->HandleConnectTimeout(connect_seq);
+    }
+  });
+}
+
+void AsyncTcpClient::HandleConnectTimeout(uint64_t connect_seq) {
+  if (connect_seq == connect_seq_ && state_ == State::CONNECTING) {
+    HandleError("connect timeout");
+  }
+}
+
+void AsyncTcpClient::HandleEvent(uint32_t events) {
+  if (state_ == State::CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+      err = errno;
+    }
+    if (err != 0) {
+      HandleError(std::string("connect() fail: ") + std::strerror(err));
+      return;
+    }
+    if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) == 0) {
+      return;
+    }
+    HandleConnected();
+    if (sockfd_ == -1) {
+      return;
+    }
+  }
+
+  if (events & EPOLLERR) {
+    HandleError("socket error");
+    return;
+  }
+  if (events & EPOLLOUT) {
+    FlushOutbound();
+    if (sockfd_ == -1) {
+      return;
+    }
+  }
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+    HandleRead();
+  }
+}
+
+void AsyncTcpClient::HandleConnected() {
+  LOG_INFO << "[" << name_ << "]: access to the [" << server_ip_ << ":" << server_port_ << "] successfully!";
+  state_ = State::CONNECTED;
+  reconnect_delay_ms_ = 0;
+  if (connection_callback_) {
+    connection_callback_(true);
+  }
+  // 回调中可能已经断开了连接
+  if (sockfd_ == -1) {
+    return;
+  }
+  DrainOutbound();
+  FlushOutbound();
+}
+
+void AsyncTcpClient::HandleRead() {
+  char extra_buffer[kExtraBufferSize];
+  std::vector<std::string> frames;
+
+  // 边缘触发模式下需要一直读到 EAGAIN
+  while (sockfd_ != -1) {
+    // 优先直接读进接收缓冲区, 放不下的部分落到栈上再追加
+    inbound_.Reserve(kMinReadSpace);
+    struct iovec iov[3];
+    int iov_cnt = inbound_.WritableSpans(iov);
+    std::size_t writable = inbound_.WritableSize();
+    iov[iov_cnt].iov_base = extra_buffer;
+    iov[iov_cnt].iov_len = kExtraBufferSize;
+    ++iov_cnt;
+
+    ssize_t nbytes = readv(sockfd_, iov, iov_cnt);
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        HandleError(std::string("readv() fail: ") + std::strerror(errno));
+      }
+      return;
+    }
+    if (nbytes == 0) {
+      HandleError("peer closed");
+      return;
+    }
+    if (static_cast<std::size_t>(nbytes) <= writable) {
+      inbound_.CommitWrite(nbytes);
+    } else {
+      inbound_.CommitWrite(writable);
+      inbound_.Append(extra_buffer, nbytes - writable);
+    }
+
+    frames.clear();
+    if (!codec_->Decode(&inbound_, &frames)) {
+      HandleError("receive invalid frame");
+      return;
+    }
+    for (auto&& frame : frames) {
+      if (message_callback_) {
+        message_callback_(frame);
+      }
+      // 回调中可能已经断开了连接
+      if (sockfd_ == -1) {
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief 取走无锁链表中的所有消息, 按发送顺序追加到 outbound_
+ *
+ */
+void AsyncTcpClient::DrainOutbound() {
+  OutboundNode* node = outbound_head_.exchange(nullptr, std::memory_order_acquire);
+  // 链表是后进先出的, 反转后恢复发送顺序
+  OutboundNode* reversed = nullptr;
+  while (node != nullptr) {
+    OutboundNode* next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+  while (reversed != nullptr) {
+    OutboundNode* next = reversed->next;
+    outbound_.emplace_back(std::move(reversed->data));
+    delete reversed;
+    reversed = next;
+  }
+}
+
+void AsyncTcpClient::FlushOutbound() {
+  while (!outbound_.empty()) {
+    struct iovec iov[kMaxIovecCnt];
+    int iov_cnt = 0;
+    std::size_t offset = outbound_offset_;
+    for (auto iter = outbound_.begin(); iter != outbound_.end() && iov_cnt < kMaxIovecCnt; ++iter) {
+      iov[iov_cnt].iov_base = const_cast<char*>(iter->data()) + offset;
+      iov[iov_cnt].iov_len = iter->size() - offset;
+      offset = 0;
+      ++iov_cnt;
+    }
+
+    ssize_t nbytes = writev(sockfd_, iov, iov_cnt);
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      HandleError(std::string("writev() fail: ") + std::strerror(errno));
+      return;
+    }
+
+    // 弹出已经完整发送的消息
+    pending_bytes_ -= nbytes;
+    std::size_t remain = nbytes;
+    while (remain > 0) {
+      std::size_t front_left = outbound_.front().size() - outbound_offset_;
+      if (remain < front_left) {
+        outbound_offset_ += remain;
+        break;
+      }
+      remain -= front_left;
+      outbound_.pop_front();
+      outbound_offset_ = 0;
+    }
+  }
+  UpdateEvents();
+}
+
+/**
+ * @brief 发送队列为空时取消 EPOLLOUT, 避免每次可读事件都附带无意义的可写事件
+ *
+ */
+void AsyncTcpClient::UpdateEvents() {
+  bool need_writing = !outbound_.empty();
+  if (need_writing == is_writing_) {
+    return;
+  }
+  uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET | (need_writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+  if (!loop_->ModifyFd(sockfd_, events)) {
+    HandleError("modify epoll events fail");
+    return;
+  }
+  is_writing_ = need_writing;
+}
+
+void AsyncTcpClient::CloseSocket() {
+  if (sockfd_ == -1) {
+    return;
+  }
+  loop_->RemoveFd(sockfd_);
+  close(sockfd_);
+  sockfd_ = -1;
+  is_writing_ = false;
+  inbound_.Clear();
+
+  // 只发送了一部分的消息不能在新连接上续发, 否则对端会解析出错
+  if (outbound_offset_ > 0) {
+    pending_bytes_ -= outbound_.front().size() - outbound_offset_;
+    outbound_.pop_front();
+    outbound_offset_ = 0;
+  }
+
+  bool was_connected = state_ == State::CONNECTED;
+  state_ = State::DISCONNECTED;
+  if (was_connected && connection_callback_) {
+    connection_callback_(false);
+  }
+}
+
+void AsyncTcpClient::HandleError(const std::string& reason) {
+  LOG_WARN << "[" << name_ << "]: " << reason << ", server: " << server_ip_ << ":" << server_port_;
+  CloseSocket();
+  ScheduleReconnect();
+}
+
+void AsyncTcpClient::ScheduleReconnect() {
+  if (!is_active_) {
+    return;
+  }
+  // 指数退避, 避免服务端不可用时频繁重连
+  if (reconnect_delay_ms_ == 0) {
+    reconnect_delay_ms_ = options_.min_reconnect_delay_ms;
+  } else {
+    reconnect_delay_ms_ = std::min(reconnect_delay_ms_ * 2, options_.max_reconnect_delay_ms);
+  }
+  LOG_INFO << "[" << name_ << "]: reconnect after " << reconnect_delay_ms_ << " ms";
+
+  uint64_t connect_seq = connect_seq_;
+  std::weak_ptr<AsyncTcpClient> weak_self = shared_from_this();
+  loop_->RunAfter(reconnect_delay_ms_, [weak_self, connect_seq]() {
+    auto self = weak_self.lock();
+    // 期间用户可能调用了 Disconnect 或者 Connect
+    if (self && self->is_active_ && self->connect_seq_ == connect_seq && self->sockfd_ == -1) {
+      self->StartConnect();
+    }
+  });
+}
+
+}  // namespace tcp
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "tcp/codec/codec.h"
+#include "tcp/event_loop/event_loop.h"
+#include "util/macro_util.h"
+
+namespace tcp {
+
+/**
+ * @brief 异步 TCP 客户端, 多个客户端可以共享同一个 EventLoop 线程
+ *
+ * 1. 连接、读写和重连都在 EventLoop 线程中完成, 不会阻塞调用方, 出错时不会退出进程
+ * 2. Send 在调用方线程中编码后压入无锁的发送链表, 只有链表由空变为非空时才唤醒事件线程,
+ *    事件线程一次取走所有待发送的消息并用 writev 批量发送
+ * 3. 连接断开或者连接失败后按指数退避自动重连, 断开期间的消息会在重连成功后继续发送
+ * 4. 收到的数据用 Codec 解码成完整的帧后回调给用户
+ *
+ * 必须通过 Create 创建, 投递到事件线程的任务只持有 std::weak_ptr, 客户端析构后这些任务自动失效
+ *
+ * eg:
+ *     tcp::EventLoop loop("client_loop");
+ *     loop.Start();
+ *     auto client = tcp::AsyncTcpClient::Create(&loop, "client", "127.0.0.1", 8888);
+ *     client->SetMessageCallback([](const std::string& msg) { ... });
+ *     client->Connect();
+ *     client->Send("hello");
+ */
+class AsyncTcpClient : public std::enable_shared_from_this<AsyncTcpClient> {
+ public:
+  struct Options {
+    // 重连的初始等待时间, 之后每次失败翻倍, 直到 max_reconnect_delay_ms
+    int64_t min_reconnect_delay_ms = 100;
+    int64_t max_reconnect_delay_ms = 10 * 1000;
+    // 连接超时时间
+    int64_t connect_timeout_ms = 3 * 1000;
+    // 待发送数据的上限(包括断开期间积压的数据), 超过后 Send 返回 false
+    std::size_t max_pending_bytes = 4 * 1024 * 1024;
+  };
+
+  // 收到完整的一帧时回调, 在事件线程中执行
+  using MessageCallback = std::function<void(const std::string& msg)>;
+  // 连接建立或断开时回调, 在事件线程中执行
+  using ConnectionCallback = std::function<void(bool is_connected)>;
+
+ public:
+  /**
+   * @brief 创建客户端, 不会立即发起连接
+   *
+   * @param loop 需要比客户端活得更久, 可以在多个客户端之间共享
+   * @param name 用于日志
+   * @param server_ip
+   * @param server_port
+   * @param codec 为空时按 '\n' 切分消息
+   * @param options
+   * @return std::shared_ptr<AsyncTcpClient>
+   */
+  static std::shared_ptr<AsyncTcpClient> Create(EventLoop* loop, const std::string& name, const std::string& server_ip,
+                                                uint16_t server_port, std::shared_ptr<const Codec> codec,
+                                                const Options& options);
+  // 按 '\n' 切分消息, 使用默认配置
+  static std::shared_ptr<AsyncTcpClient> Create(EventLoop* loop, const std::string& name, const std::string& server_ip,
+                                                uint16_t server_port);
+  ~AsyncTcpClient();
+
+ public:
+  // 回调需要在 Connect 之前设置
+  void SetMessageCallback(MessageCallback callback) {
+    message_callback_ = std::move(callback);
+  }
+  void SetConnectionCallback(ConnectionCallback callback) {
+    connection_callback_ = std::move(callback);
+  }
+
+  /**
+   * @brief 异步发起连接, 之后连接断开会自动重连, 直到调用 Disconnect, 线程安全
+   *
+   */
+  void Connect();
+
+  /**
+   * @brief 异步断开连接并停止重连, 未发送的数据会被丢弃, 线程安全
+   *
+   */
+  void Disconnect();
+
+  /**
+   * @brief 用 codec 编码后异步发送, 线程安全
+   *
+   * @param payload
+   * @return bool 待发送数据超过 max_pending_bytes 时返回 false
+   */
+  bool Send(const std::string& payload);
+
+  bool IsConnected() const {
+    return state_.load(std::memory_order_acquire) == State::CONNECTED;
+  }
+
+  const std::string& name() const {
+    return name_;
+  }
+
+ private:
+  enum class State {
+    DISCONNECTED = 0,
+    CONNECTING = 1,
+    CONNECTED = 2,
+  };
+
+  // 无锁发送链表的节点, Send 压到表头, 事件线程一次取走后反转成 FIFO 顺序
+  struct OutboundNode {
+    std::string data;
+    OutboundNode* next = nullptr;
+  };
+
+ private:
+  AsyncTcpClient(EventLoop* loop, const std::string& name, const std::string& server_ip, uint16_t server_port,
+                 std::shared_ptr<const Codec> codec, const Options& options);
+
+  // 以下函数只在事件线程中调用
+  void StartConnect();
+  void HandleConnectTimeout(uint64_t connect_seq);
+  void HandleEvent(uint32_t events);
+  void HandleConnected();
+  void HandleRead();
+  void DrainOutbound();
+  void FlushOutbound();
+  void UpdateEvents();
+  void CloseSocket();
+  void HandleError(const std::string& reason);
+  void ScheduleReconnect();
+
+ private:
+  static constexpr uint32_t kMinReadSpace = 4 * 1024;
+  static constexpr uint32_t kExtraBufferSize = 64 * 1024;
+  // 单次 writev 最多携带的消息数
+  static constexpr int kMaxIovecCnt = 64;
+
+ private:
+  EventLoop* loop_;
+  std::string name_;
+  std::string server_ip_;
+  uint16_t server_port_;
+  std::shared_ptr<const Codec> codec_;
+  Options options_;
+
+  MessageCallback message_callback_;
+  ConnectionCallback connection_callback_;
+
+  std::atomic<State> state_ = {State::DISCONNECTED};
+  // 用户是否希望保持连接
+  std::atomic<bool> is_active_ = {false};
+
+  // 多生产者压入, 事件线程整体取走
+  std::atomic<OutboundNode*> outbound_head_ = {nullptr};
+  std::atomic<std::size_t> pending_bytes_ = {0};
+
+  // 以下成员只在事件线程中访问
+  int32_t sockfd_ = -1;
+  // 每次发起连接时递增, 用于让过期的超时和重连任务失效
+  uint64_t connect_seq_ = 0;
+  int64_t reconnect_delay_ms_ = 0;
+  bool is_writing_ = false;
+  ByteRingBuffer inbound_;
+  // 已经从无锁链表中取出但还没发送完的消息, 队头消息已经发送了 outbound_offset_ 字节
+  std::deque<std::string> outbound_;
+  std::size_t outbound_offset_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncTcpClient);
+};
+
+}  // namespace tcp
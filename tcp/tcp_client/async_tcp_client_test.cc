@@ -0,0 +1,388 @@
+#include "tcp/tcp_client/async_tcp_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tcp {
+
+namespace {
+
+/**
+ * @brief 本地的测试服务器, 每个连接一个线程, 按 '\n' 切分收到的消息, 连接建立后先发送 "welcome\n"
+ *
+ * 可以 Stop 之后在同一个端口上重新 Start, 用于模拟服务器重启
+ */
+class LineServer {
+ public:
+  ~LineServer() {
+    Stop();
+  }
+
+  // port 为 0 时由内核分配端口, 返回实际监听的端口, 失败返回 0
+  uint16_t Start(uint16_t port) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 128) != 0) {
+      ::close(listen_fd_);
+      listen_fd_ = -1;
+      return 0;
+    }
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    accept_thread_ = std::thread(&LineServer::AcceptLoop, this);
+    return ntohs(addr.sin_port);
+  }
+
+  // 关闭监听套接字和所有连接
+  void Stop() {
+    if (listen_fd_ == -1) {
+      return;
+    }
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+
+    std::vector<std::thread> threads;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      for (int fd : conn_fds_) {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+      threads.swap(conn_threads_);
+    }
+    for (auto&& thread : threads) {
+      thread.join();
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (int fd : conn_fds_) {
+      ::close(fd);
+    }
+    conn_fds_.clear();
+  }
+
+  // 等待直到总共收到 n 条消息
+  bool WaitLines(std::size_t n, int timeout_ms = 5000) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, n]() {
+      return lines_.size() >= n;
+    });
+  }
+
+  std::vector<std::string> Lines() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return lines_;
+  }
+
+  std::size_t Accepted() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return accepted_;
+  }
+
+ private:
+  void AcceptLoop() {
+    while (true) {
+      int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd == -1) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mtx_);
+      ++accepted_;
+      conn_fds_.push_back(fd);
+      conn_threads_.emplace_back(&LineServer::Serve, this, fd);
+    }
+  }
+
+  void Serve(int fd) {
+    static const char kWelcome[] = "welcome\n";
+    ::send(fd, kWelcome, sizeof(kWelcome) - 1, MSG_NOSIGNAL);
+    std::string pending;
+    char buf[16 * 1024];
+    while (true) {
+      ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        return;
+      }
+      pending.append(buf, n);
+      std::size_t begin = 0;
+      std::size_t pos = 0;
+      std::lock_guard<std::mutex> lock(mtx_);
+      while ((pos = pending.find('\n', begin)) != std::string::npos) {
+        lines_.emplace_back(pending, begin, pos - begin);
+        begin = pos + 1;
+      }
+      pending.erase(0, begin);
+      cv_.notify_all();
+    }
+  }
+
+ private:
+  int listen_fd_ = -1;
+  std::thread accept_thread_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<int> conn_fds_;
+  std::vector<std::thread> conn_threads_;
+  std::vector<std::string> lines_;
+  std::size_t accepted_ = 0;
+};
+
+// 等待事件线程执行完已经投递的任务
+void SyncLoop(EventLoop* loop) {
+  std::promise<void> done;
+  loop->QueueInLoop([&done]() {
+    done.set_value();
+  });
+  done.get_future().wait();
+}
+
+template <typename Pred>
+bool WaitUntil(Pred pred, int timeout_ms = 5000) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(AsyncTcpClientTest, send_in_order) {
+  LineServer server;
+  uint16_t port = server.Start(0);
+  ASSERT_NE(port, 0);
+
+  EventLoop loop("async_tcp_client_test");
+  ASSERT_TRUE(loop.Start());
+  auto client = AsyncTcpClient::Create(&loop, "client", "127.0.0.1", port);
+  std::mutex mtx;
+  std::vector<std::string> received;
+  client->SetMessageCallback([&mtx, &received](const std::string& msg) {
+    std::lock_guard<std::mutex> lock(mtx);
+    received.push_back(msg);
+  });
+
+  // 连接之前发送的消息在连接建立后发出
+  ASSERT_TRUE(client->Send("early"));
+  client->Connect();
+  auto connected = [&client]() {
+    return client->IsConnected();
+  };
+  ASSERT_TRUE(WaitUntil(connected));
+
+  // 多个线程并发发送, 每个线程内部的顺序保持不变
+  const int kThreadNum = 4;
+  const int kMsgNum = 2000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&client, t, kMsgNum]() {
+      for (int i = 0; i < kMsgNum; ++i) {
+        client->Send(std::to_string(t) + ":" + std::to_string(i));
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  ASSERT_TRUE(server.WaitLines(1 + kThreadNum * kMsgNum));
+
+  std::vector<std::string> lines = server.Lines();
+  ASSERT_EQ(lines.size(), static_cast<std::size_t>(1 + kThreadNum * kMsgNum));
+  ASSERT_EQ(lines[0], "early");
+  std::vector<int> next(kThreadNum, 0);
+  for (std::size_t i = 1; i < lines.size(); ++i) {
+    std::size_t colon = lines[i].find(':');
+    ASSERT_NE(colon, std::string::npos);
+    int t = std::stoi(lines[i].substr(0, colon));
+    ASSERT_EQ(std::stoi(lines[i].substr(colon + 1)), next[t]);
+    ++next[t];
+  }
+
+  // 收到的数据按 '\n' 解码后回调
+  auto welcomed = [&mtx, &received]() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return !received.empty();
+  };
+  ASSERT_TRUE(WaitUntil(welcomed));
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    ASSERT_EQ(received, std::vector<std::string>({"welcome"}));
+  }
+
+  client->Disconnect();
+  SyncLoop(&loop);
+  client.reset();
+  loop.Stop();
+}
+
+TEST(AsyncTcpClientTest, reconnect) {
+  LineServer server;
+  uint16_t port = server.Start(0);
+  ASSERT_NE(port, 0);
+
+  EventLoop loop("async_tcp_client_test");
+  ASSERT_TRUE(loop.Start());
+  AsyncTcpClient::Options options;
+  options.min_reconnect_delay_ms = 50;
+  options.max_reconnect_delay_ms = 400;
+  auto client = AsyncTcpClient::Create(&loop, "client", "127.0.0.1", port, nullptr, options);
+  std::atomic<int> connects = {0};
+  std::atomic<int> disconnects = {0};
+  std::atomic<int64_t> disconnected_ns = {0};
+  client->SetConnectionCallback([&](bool is_connected) {
+    if (is_connected) {
+      ++connects;
+    } else {
+      disconnected_ns = std::chrono::steady_clock::now().time_since_epoch().count();
+      ++disconnects;
+    }
+  });
+  client->Connect();
+  auto first_connect = [&connects]() {
+    return connects.load() == 1;
+  };
+  ASSERT_TRUE(WaitUntil(first_connect));
+  // 内核完成握手时服务器可能还没有 accept
+  auto accepted = [&server]() {
+    return server.Accepted() == 1;
+  };
+  ASSERT_TRUE(WaitUntil(accepted));
+
+  server.Stop();
+  auto disconnected = [&disconnects]() {
+    return disconnects.load() == 1;
+  };
+  ASSERT_TRUE(WaitUntil(disconnected));
+  ASSERT_FALSE(client->IsConnected());
+  // 断开期间发送的消息在重连后发出
+  ASSERT_TRUE(client->Send("while down"));
+
+  // 依次在 50, 150, 350, 750ms 重连, 400ms 时重启服务器, 要等到 750ms 那一次才能连上
+  auto down_at = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(disconnected_ns.load()));
+  std::this_thread::sleep_until(down_at + std::chrono::milliseconds(400));
+  ASSERT_EQ(server.Start(port), port);
+  auto restarted_at = std::chrono::steady_clock::now();
+  auto second_connect = [&connects]() {
+    return connects.load() == 2;
+  };
+  ASSERT_TRUE(WaitUntil(second_connect));
+  auto waited = std::chrono::steady_clock::now() - restarted_at;
+  // 重连间隔按指数增长, 没有在服务器恢复后立刻连上, 也没有超过 max_reconnect_delay_ms
+  ASSERT_GE(waited, std::chrono::milliseconds(200));
+  ASSERT_LT(waited, std::chrono::milliseconds(options.max_reconnect_delay_ms + 500));
+
+  ASSERT_TRUE(server.WaitLines(1));
+  // 重启前后各一次
+  ASSERT_EQ(server.Accepted(), 2u);
+  ASSERT_EQ(server.Lines(), std::vector<std::string>({"while down"}));
+
+  client->Disconnect();
+  SyncLoop(&loop);
+  client.reset();
+  loop.Stop();
+}
+
+TEST(AsyncTcpClientTest, max_pending_bytes) {
+  LineServer server;
+  uint16_t port = server.Start(0);
+  ASSERT_NE(port, 0);
+
+  EventLoop loop("async_tcp_client_test");
+  ASSERT_TRUE(loop.Start());
+  AsyncTcpClient::Options options;
+  options.max_pending_bytes = 100;
+  auto client = AsyncTcpClient::Create(&loop, "client", "127.0.0.1", port, nullptr, options);
+
+  // 还没有连接, 编码后每条 10 字节, 最多积压 10 条
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(client->Send("message-" + std::to_string(i)));
+  }
+  ASSERT_FALSE(client->Send("overflow!"));
+  ASSERT_FALSE(client->Send("x"));
+
+  client->Connect();
+  ASSERT_TRUE(server.WaitLines(10));
+  // 发送出去之后又可以继续发送
+  auto sent = [&client]() {
+    return client->Send("message-10");
+  };
+  ASSERT_TRUE(WaitUntil(sent));
+  ASSERT_TRUE(server.WaitLines(11));
+
+  std::vector<std::string> lines = server.Lines();
+  ASSERT_EQ(lines.size(), 11u);
+  for (int i = 0; i < 11; ++i) {
+    ASSERT_EQ(lines[i], "message-" + std::to_string(i));
+  }
+
+  client->Disconnect();
+  SyncLoop(&loop);
+  client.reset();
+  loop.Stop();
+}
+
+TEST(AsyncTcpClientTest, disconnect_drops_pending) {
+  LineServer server;
+  uint16_t port = server.Start(0);
+  ASSERT_NE(port, 0);
+
+  EventLoop loop("async_tcp_client_test");
+  ASSERT_TRUE(loop.Start());
+  AsyncTcpClient::Options options;
+  options.max_pending_bytes = 100;
+  auto client = AsyncTcpClient::Create(&loop, "client", "127.0.0.1", port, nullptr, options);
+
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(client->Send("dropped-" + std::to_string(i)));
+  }
+  ASSERT_FALSE(client->Send("overflow!"));
+
+  // Disconnect 丢弃积压的消息, 并归还待发送数据的额度
+  client->Disconnect();
+  SyncLoop(&loop);
+  ASSERT_TRUE(client->Send("kept"));
+
+  client->Connect();
+  ASSERT_TRUE(server.WaitLines(1));
+  auto connected = [&client]() {
+    return client->IsConnected();
+  };
+  ASSERT_TRUE(WaitUntil(connected));
+
+  // 断开之后不再重连
+  client->Disconnect();
+  SyncLoop(&loop);
+  ASSERT_FALSE(client->IsConnected());
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_FALSE(client->IsConnected());
+  ASSERT_EQ(server.Accepted(), 1u);
+  ASSERT_EQ(server.Lines(), std::vector<std::string>({"kept"}));
+
+  client.reset();
+  loop.Stop();
+}
+
+}  // namespace tcp
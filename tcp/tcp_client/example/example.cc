@@ -0,0 +1,49 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp/tcp_client/async_tcp_client.h"
+
+/**
+ * 多个异步客户端共享一个事件线程, 连接 tcp/tcp_server/example 中的聊天室并互相发消息
+ * 服务端重启后客户端会自动重连
+ */
+int main() {
+  constexpr int kClientNum = 100;
+  constexpr int kRoundNum = 10;
+
+  tcp::EventLoop loop("async_tcp_client_loop");
+  if (!loop.Start()) {
+    return -1;
+  }
+
+  std::atomic<uint64_t> recv_cnt = {0};
+  std::vector<std::shared_ptr<tcp::AsyncTcpClient>> clients;
+  for (int i = 0; i < kClientNum; ++i) {
+    auto client = tcp::AsyncTcpClient::Create(&loop, "client_" + std::to_string(i), "127.0.0.1", 8888);
+    client->SetMessageCallback([&recv_cnt](const std::string&) {
+      ++recv_cnt;
+    });
+    client->Connect();
+    clients.emplace_back(std::move(client));
+  }
+
+  for (int round = 0; round < kRoundNum; ++round) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    for (auto&& client : clients) {
+      client->Send("hello from " + client->name() + ", round " + std::to_string(round));
+    }
+    std::cout << "round " << round << ", receive " << recv_cnt << " messages" << std::endl;
+  }
+
+  for (auto&& client : clients) {
+    client->Disconnect();
+  }
+  clients.clear();
+  loop.Stop();
+  return 0;
+}
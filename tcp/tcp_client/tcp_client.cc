@@ -3,35 +3,24 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <list>
-#include <sstream>
+#include <utility>
+#include <vector>
 
 #include "logger/log.h"
 
 namespace tcp {
 
-namespace {
-
-void Split(const std::string& msg, const char delim, std::list<std::string>* const res) {
-  res->clear();
-  std::istringstream iss(msg);
-  std::string temp;
-  while (!iss.eof()) {
-    std::getline(iss, temp, delim);
-    if (temp != "\n" && !temp.empty()) {
-      res->emplace_back(temp);
-    }
-  }
+TcpClient::TcpClient(const std::string& name) : TcpClient(name, std::make_shared<DelimiterCodec>("\n")) {
 }
 
-}  // namespace
-
-TcpClient::TcpClient(const std::string& name) : name_(name) {
+TcpClient::TcpClient(const std::string& name, std::shared_ptr<const Codec> codec)
+    : name_(name), codec_(std::move(codec)) {
 }
 
 TcpClient::~TcpClient() {
@@ -62,6 +51,8 @@ void TcpClient::Connect(const std::string& server_ip, uint32_t server_port) {
   LOG_INFO << "access to the [" << server_ip << ":" << server_port << "] successfully!";
 
   recv_thread_ = std::thread([this]() {
+    ByteRingBuffer inbound;
+    std::vector<std::string> frames;
     while (!is_stop_) {
       // 等待数据可读
       fd_set read_fds;
@@ -87,14 +78,18 @@ void TcpClient::Connect(const std::string& server_ip, uint32_t server_port) {
         continue;
       }
 
-      // 数据可读
-      static char buffer[kMaxBufferSize];
-      memset(buffer, '\0', sizeof(buffer));
-      auto nbytes = read(sockfd_, buffer, kMaxBufferSize);
+      // 数据可读, 直接读进接收缓冲区, 半包留在缓冲区中等待后续数据
+      inbound.Reserve(kMaxBufferSize);
+      struct iovec iov[2];
+      int iov_cnt = inbound.WritableSpans(iov);
+      auto nbytes = readv(sockfd_, iov, iov_cnt);
 
       if (nbytes == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
         // 出错
-        LOG_ERROR << "[" << name_ << "]: read() fail: " << std::strerror(errno);
+        LOG_ERROR << "[" << name_ << "]: readv() fail: " << std::strerror(errno);
         exit(EXIT_FAILURE);
       } else if (nbytes == 0) {
         // 对端关闭连接
@@ -102,14 +97,22 @@ void TcpClient::Connect(const std::string& server_ip, uint32_t server_port) {
         close(sockfd_);
         exit(EXIT_FAILURE);
       } else {
-        buffer[nbytes] = '\0';
-        // 成功读到数据, 处理 TCP 的粘包问题(即同时收到多条消息)
-        std::list<std::string> msg_list;
-        Split(buffer, '\n', &msg_list);
-        for (auto&& msg : msg_list) {
+        inbound.CommitWrite(nbytes);
+        // 成功读到数据, 处理 TCP 的粘包和半包问题(即同时收到多条消息或者一条消息被拆成多次收到)
+        frames.clear();
+        if (!codec_->Decode(&inbound, &frames)) {
+          LOG_ERROR << "[" << name_ << "]: receive invalid frame";
+          close(sockfd_);
+          exit(EXIT_FAILURE);
+        }
+        for (auto&& msg : frames) {
           LOG_INFO << "[" << name_ << "]: receive message: " << msg;
-          // 将收到的消息打印到标准输出
-          std::cout << msg << std::endl;
+          if (message_callback_) {
+            message_callback_(msg);
+          } else {
+            // 将收到的消息打印到标准输出
+            std::cout << msg << std::endl;
+          }
         }
       }
     }
@@ -124,10 +127,32 @@ void TcpClient::Disconnect() {
 }
 
 void TcpClient::Send(const Buffer& buffer) {
-  if (write(sockfd_, buffer.buf.data(), buffer.len) == -1) {
-    LOG_ERROR << "write() fail: " << std::strerror(errno);
+  if (!WriteAll(buffer.buf.data(), buffer.len)) {
     exit(EXIT_FAILURE);
   }
 }
 
+bool TcpClient::SendFrame(const std::string& payload) {
+  std::string frame;
+  codec_->Encode(payload, &frame);
+  return WriteAll(frame.data(), frame.size());
+}
+
+bool TcpClient::WriteAll(const char* data, std::size_t size) {
+  // 阻塞套接字上 write 也可能只写入一部分(eg: 被信号中断)
+  while (size > 0) {
+    ssize_t nbytes = write(sockfd_, data, size);
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR << "write() fail: " << std::strerror(errno);
+      return false;
+    }
+    data += nbytes;
+    size -= nbytes;
+  }
+  return true;
+}
+
 }  // namespace tcp
@@ -2,14 +2,24 @@
 
 #include <array>
 #include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
 #include <thread>
 
+#include "tcp/codec/codec.h"
+
 namespace tcp {
 
 class TcpClient final {
  public:
+  // 收到完整的一帧时回调, 在接收线程中执行
+  using MessageCallback = std::function<void(const std::string& msg)>;
+
+ public:
+  // 默认按 '\n' 切分消息
   TcpClient(const std::string& name);
+  TcpClient(const std::string& name, std::shared_ptr<const Codec> codec);
   ~TcpClient();
 
  public:
@@ -22,10 +32,22 @@ class TcpClient final {
  public:
   void Connect(const std::string& server_ip, uint32_t server_port);
   void Disconnect();
+  // 原样发送 buffer 中的数据
   void Send(const Buffer& buffer);
+  // 用 codec 编码后发送, 不受 kMaxBufferSize 限制
+  bool SendFrame(const std::string& payload);
+  // 需要在 Connect 之前设置, 不设置时将收到的消息打印到标准输出
+  void SetMessageCallback(MessageCallback callback) {
+    message_callback_ = std::move(callback);
+  }
+
+ private:
+  bool WriteAll(const char* data, std::size_t size);
 
  private:
   std::string name_;
+  std::shared_ptr<const Codec> codec_;
+  MessageCallback message_callback_;
   int32_t sockfd_ = -1;
   std::atomic<bool> is_stop_ = {false};
   std::thread recv_thread_;
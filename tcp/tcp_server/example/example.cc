@@ -0,0 +1,23 @@
+#include <chrono>
+#include <thread>
+
+#include "tcp/tcp_server/tcp_server.h"
+
+/**
+ * 简易聊天室: 每个客户端以 '\n' 结尾的消息都会广播给其他客户端
+ *
+ * $nc 127.0.0.1 8888
+ */
+int main() {
+  tcp::TcpServer::Options options;
+  options.worker_num = 4;
+  options.high_water_mark = 1024 * 1024;
+
+  tcp::TcpServer server("\n", options);
+  if (!server.Start(8888)) {
+    return -1;
+  }
+  std::this_thread::sleep_for(std::chrono::minutes(10));
+  server.Stop();
+  return 0;
+}
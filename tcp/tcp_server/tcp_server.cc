@@ -1,66 +1,118 @@
 #include "tcp/tcp_server/tcp_server.h"
 
 #include <arpa/inet.h>
-#include <asm-generic/socket.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-#include <chrono>
-#include <cstdlib>
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
 #include <string>
-#include <thread>
+#include <utility>
 
 #include "logger/log.h"
 
 namespace {
 
-constexpr uint32_t kBacklog = 10;
-constexpr uint32_t kReadBufferSize = 1024;
+constexpr uint32_t kBacklog = 128;
+// 单次 writev 最多携带的消息数
+constexpr int kMaxIovecCnt = 64;
 
 }  // namespace
 
 namespace tcp {
 
-TcpServer::~TcpServer() {
-  if (epoll_thread_.joinable()) {
-    epoll_thread_.join();
+TcpServer::TcpServer(const std::string& delim) : TcpServer(delim, Options()) {
+}
+
+TcpServer::TcpServer(const std::string& delim, const Options& options)
+    : TcpServer(std::make_shared<DelimiterCodec>(delim, options.max_message_size), options) {
+}
+
+TcpServer::TcpServer(std::shared_ptr<const Codec> codec, const Options& options)
+    : codec_(std::move(codec)), options_(options), acceptor_loop_("tcp_server_acceptor") {
+  if (options_.worker_num == 0) {
+    options_.worker_num = 1;
   }
 }
 
-TcpServer::TcpServer(const std::string& delim) : delim_(delim) {
+TcpServer::~TcpServer() {
+  Stop();
 }
 
 bool TcpServer::Start(int32_t port) {
+  if (!is_stop_.exchange(false)) {
+    LOG_WARN << "TcpServer is already started";
+    return true;
+  }
   port_ = port;
 
-  ListenOn();
-  SetNonBlocking(listen_sockfd_);
-  CreateEpoll();
-  AddListenSocketToEpoll();
+  if (!ListenOn() || !SetNonBlocking(listen_sockfd_)) {
+    Stop();
+    return false;
+  }
 
-  epoll_thread_ = std::thread(&TcpServer::HandleEpollEvent, this);
+  for (uint32_t i = 0; i < options_.worker_num; ++i) {
+    workers_.emplace_back(new Worker("tcp_server_worker_" + std::to_string(i)));
+    if (!workers_.back()->loop.Start()) {
+      Stop();
+      return false;
+    }
+  }
+
+  if (!acceptor_loop_.Start()) {
+    Stop();
+    return false;
+  }
+  acceptor_loop_.RunInLoop([this]() {
+    acceptor_loop_.AddFd(listen_sockfd_, EPOLLIN, [this](uint32_t) {
+      HandleAccept();
+    });
+  });
   return true;
 }
 
 void TcpServer::Stop() {
-  is_stop_ = true;
+  if (is_stop_.exchange(true)) {
+    return;
+  }
   LOG_INFO << "TcpServer is going to quit, please wait";
-  epoll_thread_.join();
+
+  acceptor_loop_.Stop();
+  if (listen_sockfd_ != -1) {
+    close(listen_sockfd_);
+    listen_sockfd_ = -1;
+  }
+
+  // 在各自的 IO 线程中关闭连接, Stop 会等待这些任务执行完
+  for (auto&& worker : workers_) {
+    Worker* w = worker.get();
+    w->loop.QueueInLoop([this, w]() {
+      std::vector<std::shared_ptr<Connection>> conns;
+      for (auto&& iter : w->connections) {
+        conns.emplace_back(iter.second);
+      }
+      for (auto&& conn : conns) {
+        CloseConnection(w, conn);
+      }
+    });
+    w->loop.Stop();
+  }
+  workers_.clear();
   LOG_INFO << "TcpServer quit successfully";
 }
 
-void TcpServer::ListenOn() {
-  listen_sockfd_ = socket(AF_INET, SOCK_STREAM, 0);
+bool TcpServer::ListenOn() {
+  listen_sockfd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
   if (listen_sockfd_ == -1) {
     LOG_ERROR << "socket() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+    return false;
   }
 
-  int32_t opt = -1;
+  int32_t opt = 1;
   setsockopt(listen_sockfd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
   struct sockaddr_in server_addr;
@@ -71,15 +123,16 @@ void TcpServer::ListenOn() {
 
   if (bind(listen_sockfd_, (struct sockaddr*)&server_addr, sizeof(struct sockaddr)) == -1) {
     LOG_ERROR << "bind() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+    return false;
   }
 
   if (listen(listen_sockfd_, kBacklog) == -1) {
     LOG_ERROR << "listen() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+    return false;
   }
 
   LOG_INFO << "start to listen on port: " << port_;
+  return true;
 }
 
 /**
@@ -88,14 +141,14 @@ void TcpServer::ListenOn() {
  *
  * @param fd 文件描述符
  */
-void TcpServer::SetNonBlocking(int32_t fd) {
+bool TcpServer::SetNonBlocking(int32_t fd) {
   // 获取文件状态标志:
   //     fcntl: 系统调用函数, 用于对已打开的文件描述符进行各种控制操作
   //     F_GETFL: 获取打开文件的文件描述符的 flag status flags, 它是控制文件 IO 行为的一组 bit mask
   int32_t flags = fcntl(fd, F_GETFL, 0);
   if (flags == -1) {
     LOG_ERROR << "fcntl() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+    return false;
   }
 
   // 设置非阻塞模式
@@ -103,119 +156,243 @@ void TcpServer::SetNonBlocking(int32_t fd) {
   flags |= O_NONBLOCK;
   if (fcntl(fd, F_SETFL, flags) == -1) {
     LOG_ERROR << "fcntl() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+    return false;
   }
+  return true;
 }
 
 /**
- * @brief 创建 epoll 实例
+ * @brief 在 acceptor 线程中处理新连接, 监听套接字是水平触发, 每次只 accept 一个连接
  *
  */
-void TcpServer::CreateEpoll() {
-  // size 参数用于创建 epoll 实例时告诉内核需要使用多少个文件描述符
-  //  linux 内核 >2.6.8 后 size 参数就被弃用, 内核会动态地申请需要的内存
-  // 但该参数必须 >0 以兼容旧版本的linux内核
-  epoll_fd_ = epoll_create(1024);
-  if (epoll_fd_ == -1) {
-    LOG_ERROR << "epoll_create() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+void TcpServer::HandleAccept() {
+  struct sockaddr_in cli_addr;
+  socklen_t cli_addr_len = sizeof(struct sockaddr_in);
+  int32_t conn_fd = accept4(listen_sockfd_, (struct sockaddr*)&cli_addr, &cli_addr_len, SOCK_CLOEXEC);
+  if (conn_fd == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      LOG_ERROR << "accept() fail: " << std::strerror(errno);
+    }
+    return;
   }
+  std::string cli_ip = inet_ntoa(cli_addr.sin_addr);
+  std::string cli_address = cli_ip + ":" + std::to_string(ntohs(cli_addr.sin_port));
+
+  if (!SetNonBlocking(conn_fd)) {
+    close(conn_fd);
+    return;
+  }
+
+  Worker* worker = workers_[next_worker_idx_].get();
+  next_worker_idx_ = (next_worker_idx_ + 1) % workers_.size();
+  LOG_INFO << "accept client socket from " << cli_address << ", with fd: " << conn_fd
+           << ", dispatch to: " << worker->loop.name();
+  worker->loop.RunInLoop([this, worker, conn_fd, cli_address]() {
+    AddConnection(worker, conn_fd, cli_address);
+  });
 }
 
-/**
- * @brief 添加监听套接字 listen_sockfd_ 到 epoll 实例
- *
- */
-void TcpServer::AddListenSocketToEpoll() {
-  struct epoll_event ev;
-  ev.events = EPOLLIN;
-  ev.data.fd = listen_sockfd_;
-  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_sockfd_, &ev) == -1) {
-    LOG_ERROR << "epoll_ctl() fail: " << std::strerror(errno);
-    exit(EXIT_FAILURE);
+void TcpServer::AddConnection(Worker* worker, int32_t fd, const std::string& address) {
+  auto conn = std::make_shared<Connection>();
+  conn->id = ++next_conn_id_;
+  conn->fd = fd;
+  conn->address = address;
+
+  // 回调中只持有 std::weak_ptr, 避免 EventLoop 和 Connection 循环引用
+  std::weak_ptr<Connection> weak_conn = conn;
+  bool ok = worker->loop.AddFd(fd, EPOLLIN | EPOLLRDHUP | EPOLLET, [this, worker, weak_conn](uint32_t events) {
+    std::shared_ptr<Connection> conn = weak_conn.lock();
+    if (conn) {
+      HandleConnectionEvent(worker, conn, events);
+    }
+  });
+  if (!ok) {
+    close(fd);
+    return;
+  }
+  worker->connections[conn->id] = conn;
+}
+
+void TcpServer::HandleConnectionEvent(Worker* worker, const std::shared_ptr<Connection>& conn, uint32_t events) {
+  if (events & EPOLLERR) {
+    LOG_WARN << "client " << conn->address << " socket error";
+    CloseConnection(worker, conn);
+    return;
+  }
+  if (events & EPOLLOUT) {
+    if (!FlushOutbound(worker, conn)) {
+      return;
+    }
+  }
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+    HandleRead(worker, conn);
+  }
+}
+
+void TcpServer::HandleRead(Worker* worker, const std::shared_ptr<Connection>& conn) {
+  char extra_buffer[kExtraBufferSize];
+  std::vector<std::string> frames;
+
+  // 边缘触发模式下需要一直读到 EAGAIN
+  while (true) {
+    // 优先直接读进接收缓冲区, 放不下的部分落到栈上再追加, 空闲连接不必常驻大缓冲区
+    conn->inbound.Reserve(kMinReadSpace);
+    struct iovec iov[3];
+    int iov_cnt = conn->inbound.WritableSpans(iov);
+    std::size_t writable = conn->inbound.WritableSize();
+    iov[iov_cnt].iov_base = extra_buffer;
+    iov[iov_cnt].iov_len = kExtraBufferSize;
+    ++iov_cnt;
+
+    ssize_t nbytes = readv(conn->fd, iov, iov_cnt);
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG_ERROR << "readv() from " << conn->address << " fail: " << std::strerror(errno);
+        CloseConnection(worker, conn);
+      }
+      return;
+    }
+    if (nbytes == 0) {
+      LOG_INFO << "client " << conn->address << " disconnected";
+      CloseConnection(worker, conn);
+      return;
+    }
+    if (static_cast<std::size_t>(nbytes) <= writable) {
+      conn->inbound.CommitWrite(nbytes);
+    } else {
+      conn->inbound.CommitWrite(writable);
+      conn->inbound.Append(extra_buffer, nbytes - writable);
+    }
+
+    // 处理 TCP 的粘包和半包问题, 只转发完整的帧, 半包留在接收缓冲区中
+    frames.clear();
+    if (!codec_->Decode(&conn->inbound, &frames)) {
+      LOG_WARN << "client " << conn->address << " send invalid frame, close it";
+      CloseConnection(worker, conn);
+      return;
+    }
+    for (auto&& frame : frames) {
+      auto msg = std::make_shared<std::string>();
+      codec_->Encode(frame, msg.get());
+      Broadcast(conn->id, msg);
+    }
   }
 }
 
 /**
- * @brief 处理 Epoll 事件, 包括客户端的连接请求和发送消息的请求
+ * @brief 将消息转发给除发送者以外的所有连接, 每个 worker 在自己的线程中处理自己的连接
  *
  */
-void TcpServer::HandleEpollEvent() {
-  auto accept_event_handler = [this]() {
-    // accept
-    struct sockaddr_in cli_addr;
-    socklen_t cli_addr_len = sizeof(struct sockaddr_in);
-    int32_t conn_fd = accept(listen_sockfd_, (struct sockaddr*)&cli_addr, &cli_addr_len);
-    if (conn_fd == -1) {
-      LOG_ERROR << "accept() fail: " << std::strerror(errno);
-      exit(EXIT_FAILURE);
-    }
-    std::string cli_ip = inet_ntoa(cli_addr.sin_addr);
-    std::string cli_address = cli_ip + ":" + std::to_string(ntohs(cli_addr.sin_port));
-    LOG_INFO << "accept client socket from " << cli_address << ", with fd: " << conn_fd;
-    sock_fd_to_client_addr_[conn_fd] = cli_address;
+void TcpServer::Broadcast(uint64_t sender_id, const Message& msg) {
+  for (auto&& worker : workers_) {
+    Worker* w = worker.get();
+    w->loop.RunInLoop([this, w, sender_id, msg]() {
+      // 先拷贝一份, EnqueueMessage 可能会因为超过高水位而关闭连接
+      std::vector<std::shared_ptr<Connection>> conns;
+      conns.reserve(w->connections.size());
+      for (auto&& iter : w->connections) {
+        if (iter.first != sender_id) {
+          conns.emplace_back(iter.second);
+        }
+      }
+      for (auto&& conn : conns) {
+        EnqueueMessage(w, conn, msg);
+      }
+    });
+  }
+}
 
-    // set nonblocking
-    SetNonBlocking(conn_fd);
+void TcpServer::EnqueueMessage(Worker* worker, const std::shared_ptr<Connection>& conn, const Message& msg) {
+  if (conn->fd == -1) {
+    return;
+  }
+  if (conn->outbound_bytes + msg->size() > options_.high_water_mark) {
+    LOG_WARN << "client " << conn->address << " is too slow, pending bytes " << conn->outbound_bytes
+             << " reach high water mark " << options_.high_water_mark << ", close it";
+    CloseConnection(worker, conn);
+    return;
+  }
 
-    struct epoll_event conn_ev;
-    conn_ev.events = EPOLLIN | EPOLLET;
-    conn_ev.data.fd = conn_fd;
+  conn->outbound.emplace_back(msg);
+  conn->outbound_bytes += msg->size();
+  // 已经在等待 EPOLLOUT 时直接排队, 否则立即尝试发送
+  if (!conn->is_writing) {
+    FlushOutbound(worker, conn);
+  }
+}
 
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn_fd, &conn_ev) == -1) {
-      LOG_ERROR << "epoll_ctl() fail: " << std::strerror(errno);
-      exit(EXIT_FAILURE);
+/**
+ * @brief 尽可能多地发送待发送队列中的数据
+ *
+ * @return bool 连接是否仍然有效
+ */
+bool TcpServer::FlushOutbound(Worker* worker, const std::shared_ptr<Connection>& conn) {
+  while (!conn->outbound.empty()) {
+    struct iovec iov[kMaxIovecCnt];
+    int iov_cnt = 0;
+    std::size_t offset = conn->outbound_offset;
+    for (auto iter = conn->outbound.begin(); iter != conn->outbound.end() && iov_cnt < kMaxIovecCnt; ++iter) {
+      iov[iov_cnt].iov_base = const_cast<char*>((*iter)->data()) + offset;
+      iov[iov_cnt].iov_len = (*iter)->size() - offset;
+      offset = 0;
+      ++iov_cnt;
     }
-  };
 
-  auto client_msg_handler = [this](int sock_fd, int fd_cnt) {
-    static char buffer[kReadBufferSize];
-    memset(buffer, '\0', sizeof(buffer));
-
-    int nbytes = read(sock_fd, buffer, kReadBufferSize);
+    ssize_t nbytes = writev(conn->fd, iov, iov_cnt);
     if (nbytes == -1) {
-      // 出错
-      if (errno != EAGAIN) {
-        LOG_ERROR << "read() fail: " << std::strerror(errno);
-        exit(EXIT_FAILURE);
+      if (errno == EINTR) {
+        continue;
       }
-    } else if (nbytes == 0) {
-      // 客户端断开链接
-      LOG_INFO << "client " << sock_fd_to_client_addr_[sock_fd] << " disconnected";
-      sock_fd_to_client_addr_.erase(sock_fd);
-      close(sock_fd);
-    } else {
-      // 将消息转发给其他客户端
-      // 因为这里只是转发, 所以我们这里不处理粘包问题, 在客户端处根据分隔符处理
-      for (auto&& iter : sock_fd_to_client_addr_) {
-        int fd = iter.first;
-        if (fd != sock_fd) {
-          if (write(fd, buffer, nbytes) == -1) {
-            LOG_ERROR << "write() fail: " << std::strerror(errno);
-            exit(EXIT_FAILURE);
-          }
-        }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
       }
-    }
-  };
-
-  while (!is_stop_) {
-    // 等待 Epoll 事件, -1 表示不设置超时时间, 1000 表示超时 1 秒
-    int fd_cnt = epoll_wait(epoll_fd_, epoll_events_, kMaxEpollEvents, 1000);
-    if (fd_cnt == -1) {
-      LOG_ERROR << "epoll_wait() fail: " << std::strerror(errno);
-      exit(EXIT_FAILURE);
+      LOG_ERROR << "writev() to " << conn->address << " fail: " << std::strerror(errno);
+      CloseConnection(worker, conn);
+      return false;
     }
 
-    // 处理 epoll 事件
-    for (int i = 0; i < fd_cnt; ++i) {
-      if (epoll_events_[i].data.fd == listen_sockfd_) {
-        accept_event_handler();
-      } else {
-        client_msg_handler(epoll_events_[i].data.fd, fd_cnt);
+    // 弹出已经完整发送的消息
+    conn->outbound_bytes -= nbytes;
+    std::size_t remain = nbytes;
+    while (remain > 0) {
+      std::size_t front_left = conn->outbound.front()->size() - conn->outbound_offset;
+      if (remain < front_left) {
+        conn->outbound_offset += remain;
+        break;
       }
+      remain -= front_left;
+      conn->outbound.pop_front();
+      conn->outbound_offset = 0;
+    }
+  }
+
+  // 发送队列为空时取消 EPOLLOUT, 避免每次可读事件都附带无意义的可写事件
+  bool need_writing = !conn->outbound.empty();
+  if (need_writing != conn->is_writing) {
+    uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET | (need_writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    if (!worker->loop.ModifyFd(conn->fd, events)) {
+      CloseConnection(worker, conn);
+      return false;
     }
+    conn->is_writing = need_writing;
+  }
+  return true;
+}
+
+void TcpServer::CloseConnection(Worker* worker, const std::shared_ptr<Connection>& conn) {
+  if (conn->fd == -1) {
+    return;
   }
+  worker->loop.RemoveFd(conn->fd);
+  close(conn->fd);
+  conn->fd = -1;
+  conn->outbound.clear();
+  conn->outbound_bytes = 0;
+  worker->connections.erase(conn->id);
+  LOG_INFO << "close connection " << conn->address;
 }
 
 }  // namespace tcp
@@ -6,18 +6,45 @@
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "tcp/codec/codec.h"
+#include "tcp/event_loop/event_loop.h"
 #include "util/macro_util.h"
 
 namespace tcp {
 
+/**
+ * @brief 多线程广播服务器: 每个客户端发来的消息都会转发给其他所有客户端
+ *
+ * 1. 一个 acceptor 线程负责 accept, 新连接按 round-robin 分配给 worker_num 个 IO 线程
+ * 2. 每个连接独立用 Codec 解码出完整的帧再转发, 默认按 delim 切分, 也可以使用长度前缀等二进制协议
+ * 3. 每个连接有独立的发送队列, 写不完的数据在 EPOLLOUT 时继续发送, 慢连接不会阻塞其他连接
+ * 4. 单个连接待发送的数据超过 high_water_mark 时断开该连接, 避免慢消费者拖垮整个服务
+ * 5. 广播的消息只构造一次, 以 std::shared_ptr 的形式挂到每个连接的发送队列上
+ */
 class TcpServer {
+ public:
+  struct Options {
+    // IO 线程数
+    uint32_t worker_num = 4;
+    // 单个连接待发送数据的上限, 超过后断开该连接
+    std::size_t high_water_mark = 4 * 1024 * 1024;
+    // 按 delim 切分时单条消息的最大长度, 超过后仍未读到 delim 则断开该连接
+    // 使用自定义 Codec 时由 Codec 自己限制帧长度
+    std::size_t max_message_size = 1024 * 1024;
+  };
+
  public:
   explicit TcpServer(const std::string& delim);
+  TcpServer(const std::string& delim, const Options& options);
+  // codec 无状态, 所有连接共享同一个实例
+  TcpServer(std::shared_ptr<const Codec> codec, const Options& options);
   ~TcpServer();
 
  public:
@@ -35,29 +62,60 @@ class TcpServer {
   void Receive(std::vector<std::string>* const msg_list);
 
  private:
-  void ListenOn();
-  void SetNonBlocking(int32_t fd);
-  void CreateEpoll();
-  void AddListenSocketToEpoll();
-  void HandleEpollEvent();
+  using Message = std::shared_ptr<const std::string>;
+
+  struct Connection {
+    uint64_t id = 0;
+    int32_t fd = -1;
+    std::string address;
+    // 尚未解码出完整帧的数据
+    ByteRingBuffer inbound;
+    // 待发送的消息, 队头消息已经发送了 outbound_offset 字节
+    std::deque<Message> outbound;
+    std::size_t outbound_offset = 0;
+    std::size_t outbound_bytes = 0;
+    // 是否监听了 EPOLLOUT
+    bool is_writing = false;
+  };
+
+  struct Worker {
+    explicit Worker(const std::string& name) : loop(name) {
+    }
+    EventLoop loop;
+    // 只在 loop 线程中访问
+    std::unordered_map<uint64_t, std::shared_ptr<Connection>> connections;
+  };
+
+ private:
+  bool ListenOn();
+  bool SetNonBlocking(int32_t fd);
+  void HandleAccept();
+  void AddConnection(Worker* worker, int32_t fd, const std::string& address);
+  void HandleConnectionEvent(Worker* worker, const std::shared_ptr<Connection>& conn, uint32_t events);
+  void HandleRead(Worker* worker, const std::shared_ptr<Connection>& conn);
+  void Broadcast(uint64_t sender_id, const Message& msg);
+  void EnqueueMessage(Worker* worker, const std::shared_ptr<Connection>& conn, const Message& msg);
+  bool FlushOutbound(Worker* worker, const std::shared_ptr<Connection>& conn);
+  void CloseConnection(Worker* worker, const std::shared_ptr<Connection>& conn);
 
  private:
-  static constexpr uint32_t kMaxEpollEvents = 10;
+  // 每次读之前保证接收缓冲区至少有这么多可写空间, 剩余数据先读到栈上的临时缓冲区
+  static constexpr uint32_t kMinReadSpace = 4 * 1024;
+  static constexpr uint32_t kExtraBufferSize = 64 * 1024;
 
  private:
-  std::string delim_;
+  std::shared_ptr<const Codec> codec_;
+  Options options_;
 
   int32_t port_ = -1;
   int32_t listen_sockfd_ = -1;
-  int32_t epoll_fd_ = -1;
-
-  std::atomic<bool> is_stop_ = false;
-  std::atomic<bool> is_stop_gracefully_ = false;
 
-  struct epoll_event epoll_events_[kMaxEpollEvents];
-  std::unordered_map<int32_t, std::string> sock_fd_to_client_addr_;
+  std::atomic<bool> is_stop_ = {true};
 
-  std::thread epoll_thread_;
+  EventLoop acceptor_loop_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  uint32_t next_worker_idx_ = 0;
+  std::atomic<uint64_t> next_conn_id_ = {0};
 
   DISALLOW_COPY_AND_ASSIGN(TcpServer);
 };
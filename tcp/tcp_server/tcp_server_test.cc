@@ -0,0 +1,262 @@
+#include "tcp/tcp_server/tcp_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tcp {
+
+namespace {
+
+// 绑定端口 0 让内核分配一个空闲端口, TcpServer 设置了 SO_REUSEADDR, 关闭后可以直接使用
+int32_t PickFreePort() {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+  socklen_t len = sizeof(addr);
+  ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+  ::close(fd);
+  return ntohs(addr.sin_port);
+}
+
+/**
+ * @brief 阻塞模式的测试客户端, 按 '\n' 切分收到的消息
+ */
+class LineClient {
+ public:
+  // rcvbuf 不为 0 时在连接之前设置接收缓冲区大小
+  explicit LineClient(int32_t port, int rcvbuf = 0) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf > 0) {
+      ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    connected_ = ::connect(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+  }
+
+  ~LineClient() {
+    ::close(fd_);
+  }
+
+  bool connected() const {
+    return connected_;
+  }
+
+  bool Send(const std::string& data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+      ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+        return false;
+      }
+      sent += n;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 读取一行(不含 '\n')
+   *
+   * @return int 1: 读到一行, 0: 超时, -1: 连接已断开
+   */
+  int ReadLine(std::string* line, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+      std::size_t pos = pending_.find('\n');
+      if (pos != std::string::npos) {
+        line->assign(pending_, 0, pos);
+        pending_.erase(0, pos + 1);
+        return 1;
+      }
+      int left = static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+      if (left <= 0) {
+        return 0;
+      }
+      int n = Recv(left);
+      if (n < 0) {
+        return -1;
+      }
+    }
+  }
+
+  /**
+   * @brief 读取并丢弃数据直到连接断开
+   *
+   * @return bool 在超时之前检测到连接断开
+   */
+  bool WaitClosed(int timeout_ms, std::size_t* bytes) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    *bytes = pending_.size();
+    pending_.clear();
+    while (std::chrono::steady_clock::now() < deadline) {
+      int n = Recv(100);
+      if (n < 0) {
+        return true;
+      }
+      *bytes += pending_.size();
+      pending_.clear();
+    }
+    return false;
+  }
+
+ private:
+  // 返回读到的字节数, 超时返回 0, 连接断开返回 -1
+  int Recv(int timeout_ms) {
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, timeout_ms) <= 0) {
+      return 0;
+    }
+    char buf[16 * 1024];
+    ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return -1;
+    }
+    pending_.append(buf, n);
+    return static_cast<int>(n);
+  }
+
+ private:
+  int fd_ = -1;
+  bool connected_ = false;
+  std::string pending_;
+};
+
+/**
+ * @brief 等待所有客户端都被 IO 线程注册: clients[0] 不断发送同步消息, 直到其他客户端都收到
+ *
+ * 其他客户端收到的更早的同步消息会被丢弃
+ */
+bool WaitRegistered(const std::vector<LineClient*>& clients) {
+  for (int round = 0; round < 50; ++round) {
+    std::string sync = "sync-" + std::to_string(round);
+    if (!clients[0]->Send(sync + "\n")) {
+      return false;
+    }
+    bool all_received = true;
+    for (std::size_t i = 1; i < clients.size() && all_received; ++i) {
+      std::string line;
+      all_received = false;
+      while (clients[i]->ReadLine(&line, 100) == 1) {
+        if (line == sync) {
+          all_received = true;
+          break;
+        }
+      }
+    }
+    if (all_received) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(TcpServerTest, broadcast) {
+  TcpServer::Options options;
+  options.worker_num = 2;
+  TcpServer server("\n", options);
+  int32_t port = PickFreePort();
+  ASSERT_TRUE(server.Start(port));
+
+  std::vector<std::unique_ptr<LineClient>> clients;
+  std::vector<LineClient*> raw_clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.emplace_back(new LineClient(port));
+    ASSERT_TRUE(clients.back()->connected());
+    raw_clients.push_back(clients.back().get());
+  }
+  ASSERT_TRUE(WaitRegistered(raw_clients));
+  // clients[0] 发出的同步消息不会发回给自己
+  std::string line;
+  ASSERT_EQ(clients[0]->ReadLine(&line, 100), 0);
+
+  // 每条消息转发给除发送者以外的所有客户端, 被拆开的帧重组后再转发
+  ASSERT_TRUE(clients[1]->Send("hel"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_TRUE(clients[1]->Send("lo\nfrom 1\n"));
+  for (int i : {0, 2}) {
+    ASSERT_EQ(clients[i]->ReadLine(&line, 2000), 1);
+    ASSERT_EQ(line, "hello");
+    ASSERT_EQ(clients[i]->ReadLine(&line, 2000), 1);
+    ASSERT_EQ(line, "from 1");
+  }
+  ASSERT_EQ(clients[1]->ReadLine(&line, 100), 0);
+
+  // 断开的客户端不影响其他连接
+  clients[0].reset();
+  ASSERT_TRUE(clients[2]->Send("from 2\n"));
+  ASSERT_EQ(clients[1]->ReadLine(&line, 2000), 1);
+  ASSERT_EQ(line, "from 2");
+
+  server.Stop();
+  std::size_t bytes = 0;
+  ASSERT_TRUE(clients[1]->WaitClosed(2000, &bytes));
+}
+
+TEST(TcpServerTest, high_water_mark) {
+  TcpServer::Options options;
+  options.worker_num = 1;
+  options.high_water_mark = 256 * 1024;
+  TcpServer server("\n", options);
+  int32_t port = PickFreePort();
+  ASSERT_TRUE(server.Start(port));
+
+  LineClient sender(port);
+  LineClient reader(port);
+  // 从不读取的客户端, 缩小接收缓冲区让服务端的发送队列尽快堆积
+  LineClient slow(port, 4096);
+  ASSERT_TRUE(sender.connected());
+  ASSERT_TRUE(reader.connected());
+  ASSERT_TRUE(slow.connected());
+  ASSERT_TRUE(WaitRegistered({&sender, &reader}));
+
+  // 分批发送, 每批等 reader 收完, 正常读取的客户端待发送数据始终低于高水位
+  const std::string payload(1000, 'x');
+  const int kBatchNum = 64;
+  const int kBatchSize = 64;
+  std::size_t total_bytes = 0;
+  for (int batch = 0; batch < kBatchNum; ++batch) {
+    std::string data;
+    for (int i = 0; i < kBatchSize; ++i) {
+      data += std::to_string(batch * kBatchSize + i) + payload + "\n";
+    }
+    total_bytes += data.size();
+    ASSERT_TRUE(sender.Send(data));
+    for (int i = 0; i < kBatchSize; ++i) {
+      std::string line;
+      ASSERT_EQ(reader.ReadLine(&line, 5000), 1);
+      ASSERT_EQ(line, std::to_string(batch * kBatchSize + i) + payload);
+    }
+  }
+
+  // 慢客户端的待发送数据超过高水位后被断开, 只收到了一部分数据
+  std::size_t slow_bytes = 0;
+  ASSERT_TRUE(slow.WaitClosed(5000, &slow_bytes));
+  ASSERT_LT(slow_bytes, total_bytes);
+
+  // 其他连接不受影响
+  ASSERT_TRUE(sender.Send("after\n"));
+  std::string line;
+  ASSERT_EQ(reader.ReadLine(&line, 2000), 1);
+  ASSERT_EQ(line, "after");
+}
+
+}  // namespace tcp
@@ -0,0 +1,160 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "threadpool/threadpool.h"
+#include "threadpool/work_stealing_threadpool.h"
+
+/**
+ * 对比 ThreadPool 和 WorkStealingThreadPool 处理微秒级小任务的吞吐
+ *
+ * 1. external: 外部线程连续提交 kTaskNum 个任务
+ * 2. nested: 外部线程提交 kRootNum 个任务, 每个任务在线程池内部再派生 kChildNum 个子任务
+ * 3. post/submit: ThreadPool 的免分配提交接口, 和 external 对比
+ * 4. enqueue/parallel_for: 处理 kTaskNum 个元素, 每个元素一个 Enqueue 任务对比一次 ParallelFor
+ *
+ * $./threadpool_benchmark [threads]
+ */
+namespace {
+
+constexpr int kTaskNum = 1000000;
+constexpr int kRootNum = 1000;
+constexpr int kChildNum = 1000;
+
+// 模拟一个很小的任务
+void TinyWork(std::atomic<int64_t>* done) {
+  volatile uint64_t x = 0;
+  for (int i = 0; i < 32; ++i) {
+    x = x + i;
+  }
+  done->fetch_add(1, std::memory_order_relaxed);
+}
+
+void WaitDone(const std::atomic<int64_t>& done, int64_t expect) {
+  while (done.load(std::memory_order_relaxed) < expect) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename Pool>
+double BenchExternal(Pool* pool) {
+  std::atomic<int64_t> done = {0};
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTaskNum; ++i) {
+    pool->Enqueue(TinyWork, &done);
+  }
+  WaitDone(done, kTaskNum);
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return kTaskNum / cost.count();
+}
+
+template <typename Pool>
+double BenchNested(Pool* pool) {
+  std::atomic<int64_t> done = {0};
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRootNum; ++i) {
+    pool->Enqueue([pool, &done]() {
+      for (int j = 0; j < kChildNum; ++j) {
+        pool->Enqueue(TinyWork, &done);
+      }
+    });
+  }
+  WaitDone(done, static_cast<int64_t>(kRootNum) * kChildNum);
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return static_cast<double>(kRootNum) * kChildNum / cost.count();
+}
+
+double BenchPost(ThreadPool* pool) {
+  std::atomic<int64_t> done = {0};
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTaskNum; ++i) {
+    pool->Post([&done]() {
+      TinyWork(&done);
+    });
+  }
+  WaitDone(done, kTaskNum);
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return kTaskNum / cost.count();
+}
+
+double BenchSubmit(ThreadPool* pool) {
+  constexpr int kBatchSize = 1000;
+  std::atomic<int64_t> done = {0};
+  std::vector<TaskFuture<void>> futures;
+  futures.reserve(kBatchSize);
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTaskNum; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) {
+      futures.emplace_back(pool->Submit(TinyWork, &done));
+    }
+    for (auto&& future : futures) {
+      future.Get();
+    }
+    futures.clear();
+  }
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return kTaskNum / cost.count();
+}
+
+double BenchEnqueueItems(ThreadPool* pool) {
+  std::vector<int64_t> items(kTaskNum, 1);
+  std::vector<std::future<void>> futures;
+  futures.reserve(kTaskNum);
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTaskNum; ++i) {
+    futures.emplace_back(pool->Enqueue([&items, i]() {
+      items[i] *= 3;
+    }));
+  }
+  for (auto&& future : futures) {
+    future.get();
+  }
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return kTaskNum / cost.count();
+}
+
+double BenchParallelFor(ThreadPool* pool) {
+  std::vector<int64_t> items(kTaskNum, 1);
+  auto begin = std::chrono::steady_clock::now();
+  pool->ParallelFor(0, items.size(), 0, [&items](size_t i) {
+    items[i] *= 3;
+  });
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return kTaskNum / cost.count();
+}
+
+template <typename Pool>
+void Run(const std::string& name, size_t threads) {
+  Pool pool(threads);
+  double external = BenchExternal(&pool);
+  double nested = BenchNested(&pool);
+  printf("%-24s threads: %-3zu external: %12.0f tasks/s  nested: %12.0f tasks/s\n", name.c_str(), threads, external,
+         nested);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t threads = std::thread::hardware_concurrency();
+  if (argc > 1) {
+    threads = std::strtoul(argv[1], nullptr, 10);
+  }
+  Run<ThreadPool>("ThreadPool", threads);
+  Run<WorkStealingThreadPool>("WorkStealingThreadPool", threads);
+
+  ThreadPool pool(threads);
+  double post = BenchPost(&pool);
+  double submit = BenchSubmit(&pool);
+  printf("%-24s threads: %-3zu post:     %12.0f tasks/s  submit: %12.0f tasks/s\n", "ThreadPool", threads, post,
+         submit);
+
+  double enqueue = BenchEnqueueItems(&pool);
+  double parallel_for = BenchParallelFor(&pool);
+  printf("%-24s threads: %-3zu enqueue: %12.0f items/s  parallel_for: %12.0f items/s\n", "ThreadPool", threads, enqueue,
+         parallel_for);
+  return 0;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "util/macro_util.h"
+
+/**
+ * @brief Chase-Lev 工作窃取双端队列
+ *
+ * 1. 只有 owner 线程可以调用 Push/Pop, 在 bottom 端 LIFO 存取, 无竞争时不需要 CAS
+ * 2. 任意线程可以调用 Steal, 在 top 端 FIFO 窃取, 和其他窃取者或 owner 争抢最后一个元素时通过 CAS 仲裁
+ * 3. 队列满时 owner 将数组扩容一倍, 旧数组可能仍在被窃取者读取, 因此延迟到析构时释放
+ *
+ * 内存序参考: Lê et al. Correct and Efficient Work-Stealing for Weak Memory Models (PPoPP'13)
+ *
+ * T 必须是可平凡拷贝的类型, 一般存放任务指针
+ */
+template <typename T>
+class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+ public:
+  explicit ChaseLevDeque(int64_t capacity = 1024) {
+    int64_t power = 2;
+    while (power < capacity) {
+      power <<= 1;
+    }
+    arrays_.emplace_back(new Array(power));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+ public:
+  /**
+   * @brief 压入 bottom 端, 只能由 owner 线程调用
+   *
+   * @param item
+   */
+  void Push(T item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > array->capacity - 1) {
+      array = Grow(array, top, bottom);
+    }
+    array->Put(bottom, item);
+    // release 保证窃取者看到新的 bottom 时也能看到 item 本身(以及 item 指向的内容)
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief 从 bottom 端弹出, 只能由 owner 线程调用
+   *
+   * @param item 输出参数
+   * @return bool 队列为空或者最后一个元素被窃取时返回 false
+   */
+  bool Pop(T* const item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      // 队列为空, 恢复 bottom
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    *item = array->Get(bottom);
+    if (top == bottom) {
+      // 只剩最后一个元素, 和窃取者竞争
+      bool ok = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return ok;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 从 top 端窃取, 任意线程都可以调用
+   *
+   * @param item 输出参数
+   * @return bool 队列为空或者和其他线程竞争失败时返回 false
+   */
+  bool Steal(T* const item) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return false;
+    }
+
+    Array* array = array_.load(std::memory_order_acquire);
+    T value = array->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return false;
+    }
+    *item = value;
+    return true;
+  }
+
+  /**
+   * @brief 元素个数的近似值, 并发场景下只能作为参考
+   */
+  int64_t Size() const {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+ private:
+  struct Array {
+    explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), buffer(new std::atomic<T>[cap]) {
+    }
+
+    T Get(int64_t idx) const {
+      return buffer[idx & mask].load(std::memory_order_relaxed);
+    }
+
+    void Put(int64_t idx, T item) {
+      buffer[idx & mask].store(item, std::memory_order_relaxed);
+    }
+
+    int64_t capacity;
+    int64_t mask;
+    std::unique_ptr<std::atomic<T>[]> buffer;
+  };
+
+  Array* Grow(Array* array, int64_t top, int64_t bottom) {
+    arrays_.emplace_back(new Array(array->capacity * 2));
+    Array* new_array = arrays_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      new_array->Put(i, array->Get(i));
+    }
+    array_.store(new_array, std::memory_order_release);
+    return new_array;
+  }
+
+ private:
+  alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top_ = {0};
+  alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom_ = {0};
+  alignas(CACHE_LINE_SIZE) std::atomic<Array*> array_ = {nullptr};
+  // 所有分配过的数组, 只有 owner 线程会修改
+  std::vector<std::unique_ptr<Array>> arrays_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChaseLevDeque);
+};
@@ -0,0 +1,89 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "threadpool/coroutine/fd_awaiter.h"
+#include "threadpool/coroutine/task.h"
+
+/**
+ * 模拟一个请求的处理流程: 等待 IO 就绪 -> 并发请求多个后端 -> 计算
+ * 所有流程共用 4 个线程池线程和 1 个事件线程, 等待期间不占用线程
+ */
+namespace {
+
+coro::Task<int> QueryBackend(ThreadPool& pool, int key) {
+  co_await coro::Schedule(pool);
+  co_return key * 10;
+}
+
+coro::Task<int> HandleRequest(ThreadPool& pool, tcp::EventLoop& loop, int fd, int request_id) {
+  // 等待 fd 可读, 在事件线程中恢复
+  uint32_t events = co_await coro::WaitFd(loop, fd, EPOLLIN);
+  if ((events & EPOLLIN) == 0) {
+    co_return -1;
+  }
+
+  // 切回线程池, 并发查询多个后端
+  co_await coro::Schedule(pool);
+  std::vector<coro::Task<int>> queries;
+  for (int i = 0; i < 3; ++i) {
+    queries.emplace_back(QueryBackend(pool, request_id + i));
+  }
+  std::vector<int> results = co_await coro::WhenAll(std::move(queries));
+
+  int sum = 0;
+  for (int result : results) {
+    sum += result;
+  }
+  co_return sum;
+}
+
+coro::Task<void> Serve(ThreadPool& pool, tcp::EventLoop& loop, const std::vector<int>& fds) {
+  std::vector<coro::Task<int>> requests;
+  for (size_t i = 0; i < fds.size(); ++i) {
+    requests.emplace_back(HandleRequest(pool, loop, fds[i], static_cast<int>(i)));
+  }
+  std::vector<int> results = co_await coro::WhenAll(std::move(requests));
+  for (size_t i = 0; i < results.size(); ++i) {
+    printf("request %zu: %d\n", i, results[i]);
+  }
+}
+
+}  // namespace
+
+int main() {
+  ThreadPool pool(4);
+  tcp::EventLoop loop("coroutine_example");
+  if (!loop.Start()) {
+    return 1;
+  }
+
+  std::vector<int> fds;
+  for (int i = 0; i < 8; ++i) {
+    fds.push_back(eventfd(0, EFD_NONBLOCK));
+  }
+  // 模拟 IO 完成
+  std::thread io([&fds]() {
+    for (int fd : fds) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      uint64_t one = 1;
+      if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("write");
+      }
+    }
+  });
+
+  coro::SyncWait(Serve(pool, loop, fds));
+
+  io.join();
+  loop.Stop();
+  for (int fd : fds) {
+    close(fd);
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// 需要 C++20 协程支持(-std=c++20), 低版本编译时本文件为空
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <cstdint>
+
+#include "tcp/event_loop/event_loop.h"
+
+namespace coro {
+
+/**
+ * @brief 等待 fd 就绪, 协程在 EventLoop 的事件线程中恢复, 返回 epoll_wait 得到的事件
+ *
+ * 1. 挂起时把 fd 注册到 loop, 事件到达后立即移除, 所以 fd 不能同时被 loop 的其他使用者注册
+ * 2. 注册失败时返回 0
+ * 3. 恢复后如果要执行耗时的计算, 先 co_await Schedule(pool) 切回线程池, 避免阻塞事件线程
+ *
+ * eg:
+ *     coro::Task<ssize_t> Read(tcp::EventLoop& loop, int fd, char* buf, size_t len) {
+ *       while (true) {
+ *         ssize_t n = ::read(fd, buf, len);
+ *         if (n >= 0 || errno != EAGAIN) {
+ *           co_return n;
+ *         }
+ *         co_await coro::WaitFd(loop, fd, EPOLLIN);
+ *       }
+ *     }
+ */
+class FdAwaiter {
+ public:
+  FdAwaiter(tcp::EventLoop* loop, int fd, uint32_t events) : loop_(loop), fd_(fd), events_(events) {
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    loop_->RunInLoop([this, handle]() {
+      bool ok = loop_->AddFd(fd_, events_, [this, handle](uint32_t events) {
+        // 恢复之后 this 所在的协程帧可能已经销毁, 先处理完自身的状态
+        loop_->RemoveFd(fd_);
+        revents_ = events;
+        handle.resume();
+      });
+      if (!ok) {
+        revents_ = 0;
+        handle.resume();
+      }
+    });
+  }
+
+  uint32_t await_resume() const noexcept {
+    return revents_;
+  }
+
+ private:
+  tcp::EventLoop* loop_;
+  int fd_;
+  uint32_t events_;
+  uint32_t revents_ = 0;
+};
+
+inline FdAwaiter WaitFd(tcp::EventLoop& loop, int fd, uint32_t events) {
+  return FdAwaiter(&loop, fd, events);
+}
+
+}  // namespace coro
+
+#endif  // __cpp_impl_coroutine
@@ -0,0 +1,451 @@
+#pragma once
+
+// 需要 C++20 协程支持(-std=c++20), 低版本编译时本文件为空
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "threadpool/latch.h"
+#include "threadpool/threadpool.h"
+
+namespace coro {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+  // 最终挂起时直接切换到等待者(对称转移), 开启优化(-O2)时长链 co_await 不会爆栈
+  struct FinalAwaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {
+    }
+  };
+
+  // 惰性启动, 被 co_await 时才开始执行
+  std::suspend_always initial_suspend() const noexcept {
+    return {};
+  }
+  FinalAwaiter final_suspend() const noexcept {
+    return {};
+  }
+  void unhandled_exception() noexcept {
+    exception = std::current_exception();
+  }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  Task<T> get_return_object() noexcept;
+
+  template <typename U>
+  void return_value(U&& value) {
+    result.emplace(std::forward<U>(value));
+  }
+
+  T Result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*result);
+  }
+
+  std::optional<T> result;
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  Task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {
+  }
+
+  void Result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+// 立即执行、执行完自动销毁的协程, 用于在普通函数中启动 Task
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() const noexcept {
+      return {};
+    }
+    std::suspend_never initial_suspend() const noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() const noexcept {
+      return {};
+    }
+    void return_void() const noexcept {
+    }
+    // 和线程池中的任务一样, 逃逸的异常终止进程
+    void unhandled_exception() const noexcept {
+      std::terminate();
+    }
+  };
+};
+
+}  // namespace detail
+
+/**
+ * @brief 惰性启动的协程任务, co_await 时开始执行, 执行完后恢复等待者, 结果或异常通过 co_await 返回
+ *
+ * eg:
+ *     coro::Task<int> Compute(ThreadPool& pool) {
+ *       co_await coro::Schedule(pool);  // 切换到线程池中执行
+ *       co_return 42;
+ *     }
+ *
+ *     coro::Task<int> Handle(ThreadPool& pool) {
+ *       int a = co_await Compute(pool);
+ *       co_return a + 1;
+ *     }
+ *
+ *     int res = coro::SyncWait(Handle(pool));
+ */
+template <typename T>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::Promise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+ public:
+  Task() noexcept = default;
+  explicit Task(Handle handle) noexcept : handle_(handle) {
+  }
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+ public:
+  bool Valid() const noexcept {
+    return static_cast<bool>(handle_);
+  }
+
+  // 每个 Task 只能 co_await 一次
+  auto operator co_await() noexcept {
+    struct Awaiter {
+      bool await_ready() const noexcept {
+        return !handle || handle.done();
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      T await_resume() {
+        if (!handle) {
+          throw std::logic_error("co_await on an empty Task");
+        }
+        return handle.promise().Result();
+      }
+
+      Handle handle;
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  Handle handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+}  // namespace detail
+
+/**
+ * @brief co_await Schedule(pool) 之后协程在线程池的 worker 中继续执行
+ */
+class ScheduleAwaiter {
+ public:
+  explicit ScheduleAwaiter(ThreadPool* pool) : pool_(pool) {
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> handle) {
+    pool_->Post([handle]() {
+      handle.resume();
+    });
+  }
+  void await_resume() const noexcept {
+  }
+
+ private:
+  ThreadPool* pool_;
+};
+
+inline ScheduleAwaiter Schedule(ThreadPool& pool) {
+  return ScheduleAwaiter(&pool);
+}
+
+namespace detail {
+
+template <typename T>
+DetachedTask RunDetached(Task<T> task) {
+  co_await task;
+}
+
+template <typename T>
+struct SyncWaitState {
+  CountDownLatch latch{1};
+  std::optional<T> result;
+  std::exception_ptr exception;
+};
+
+template <>
+struct SyncWaitState<void> {
+  CountDownLatch latch{1};
+  std::exception_ptr exception;
+};
+
+template <typename T>
+DetachedTask RunSyncWait(Task<T> task, SyncWaitState<T>* state) {
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await task;
+    } else {
+      state->result.emplace(co_await task);
+    }
+  } catch (...) {
+    state->exception = std::current_exception();
+  }
+  state->latch.CountDown();
+}
+
+}  // namespace detail
+
+/**
+ * @brief 在当前线程启动 task, task 中逃逸的异常会终止进程
+ */
+template <typename T>
+void Spawn(Task<T> task) {
+  detail::RunDetached(std::move(task));
+}
+
+/**
+ * @brief 在普通函数中阻塞等待 task 完成并返回结果, 不能在 task 依赖的线程池 worker 中调用
+ */
+template <typename T>
+T SyncWait(Task<T> task) {
+  detail::SyncWaitState<T> state;
+  detail::RunSyncWait(std::move(task), &state);
+  state.latch.Wait();
+  if (state.exception) {
+    std::rethrow_exception(state.exception);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*state.result);
+  }
+}
+
+namespace detail {
+
+// 计数比任务数多 1, 由 await_suspend 在启动完所有任务之后减掉, 避免任务在等待者挂起之前完成时提前恢复它
+template <typename T>
+struct WhenAllState {
+  explicit WhenAllState(size_t n) : remaining(n + 1), results(std::is_void_v<T> ? 0 : n) {
+  }
+
+  std::atomic<size_t> remaining;
+  std::coroutine_handle<> continuation;
+  std::vector<std::optional<std::conditional_t<std::is_void_v<T>, char, T>>> results;
+  std::atomic<bool> has_exception = {false};
+  std::exception_ptr exception;
+};
+
+template <typename T>
+DetachedTask RunWhenAllChild(Task<T> task, WhenAllState<T>* state, size_t index) {
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await task;
+    } else {
+      state->results[index].emplace(co_await task);
+    }
+  } catch (...) {
+    if (!state->has_exception.exchange(true)) {
+      state->exception = std::current_exception();
+    }
+  }
+  if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    state->continuation.resume();
+  }
+}
+
+template <typename T>
+struct WhenAllAwaiter {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    state->continuation = handle;
+    for (size_t i = 0; i < tasks->size(); ++i) {
+      RunWhenAllChild(std::move((*tasks)[i]), state, i);
+    }
+    return state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+  }
+  void await_resume() const noexcept {
+  }
+
+  WhenAllState<T>* state;
+  std::vector<Task<T>>* tasks;
+};
+
+}  // namespace detail
+
+/**
+ * @brief 并发执行所有任务, 全部完成后按输入顺序返回结果, 有任务抛出异常时重新抛出第一个异常
+ *
+ * 各任务在调用 WhenAll 的线程上启动, 需要并行时在任务开头 co_await Schedule(pool)
+ */
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> WhenAll(std::vector<Task<T>> tasks) {
+  detail::WhenAllState<T> state(tasks.size());
+  co_await detail::WhenAllAwaiter<T>{&state, &tasks};
+  if (state.exception) {
+    std::rethrow_exception(state.exception);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    std::vector<T> results;
+    results.reserve(state.results.size());
+    for (auto&& result : state.results) {
+      results.emplace_back(std::move(*result));
+    }
+    co_return results;
+  }
+}
+
+namespace detail {
+
+// 先完成的任务和 await_suspend 各减一次 gate, 后到的一方负责恢复等待者
+// 其余任务在 WhenAny 返回后继续执行, 所以状态由所有任务共享
+template <typename T>
+struct WhenAnyState {
+  std::atomic<bool> done = {false};
+  std::atomic<int> gate = {2};
+  std::coroutine_handle<> continuation;
+  size_t index = 0;
+  std::optional<std::conditional_t<std::is_void_v<T>, char, T>> result;
+  std::exception_ptr exception;
+};
+
+template <typename T>
+DetachedTask RunWhenAnyChild(Task<T> task, std::shared_ptr<WhenAnyState<T>> state, size_t index) {
+  std::optional<std::conditional_t<std::is_void_v<T>, char, T>> result;
+  std::exception_ptr exception;
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await task;
+    } else {
+      result.emplace(co_await task);
+    }
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  if (!state->done.exchange(true, std::memory_order_acq_rel)) {
+    state->index = index;
+    state->result = std::move(result);
+    state->exception = exception;
+    if (state->gate.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      state->continuation.resume();
+    }
+  }
+}
+
+template <typename T>
+struct WhenAnyAwaiter {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    (*state)->continuation = handle;
+    for (size_t i = 0; i < tasks->size(); ++i) {
+      RunWhenAnyChild(std::move((*tasks)[i]), *state, i);
+    }
+    return (*state)->gate.fetch_sub(1, std::memory_order_acq_rel) != 1;
+  }
+  void await_resume() const noexcept {
+  }
+
+  // 只持有指针: GCC 12 会把 co_await 表达式中的临时对象析构两次, 不能在 awaiter 中放 shared_ptr
+  std::shared_ptr<WhenAnyState<T>>* state;
+  std::vector<Task<T>>* tasks;
+};
+
+}  // namespace detail
+
+/**
+ * @brief 并发执行所有任务, 返回最先完成的任务下标(以及结果), 最先完成的任务抛出异常时重新抛出
+ *
+ * 其余任务不会被取消, 在后台执行完后丢弃结果
+ */
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, size_t, std::pair<size_t, T>>> WhenAny(std::vector<Task<T>> tasks) {
+  if (tasks.empty()) {
+    throw std::invalid_argument("WhenAny on empty tasks");
+  }
+  auto state = std::make_shared<detail::WhenAnyState<T>>();
+  co_await detail::WhenAnyAwaiter<T>{&state, &tasks};
+  if (state->exception) {
+    std::rethrow_exception(state->exception);
+  }
+  if constexpr (std::is_void_v<T>) {
+    co_return state->index;
+  } else {
+    co_return std::make_pair(state->index, std::move(*state->result));
+  }
+}
+
+}  // namespace coro
+
+#endif  // __cpp_impl_coroutine
@@ -0,0 +1,164 @@
+#include "threadpool/coroutine/task.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+coro::Task<int> Value(int value) {
+  co_return value;
+}
+
+coro::Task<int> Add(int a, int b) {
+  int x = co_await Value(a);
+  int y = co_await Value(b);
+  co_return x + y;
+}
+
+coro::Task<int> Throw(std::string message) {
+  throw std::runtime_error(message);
+  co_return 0;
+}
+
+coro::Task<void> SetFlag(bool* flag) {
+  *flag = true;
+  co_return;
+}
+
+// 切换到线程池中, 等待 delay_ms 后返回 value
+coro::Task<int> Delayed(ThreadPool* pool, int delay_ms, int value) {
+  co_await coro::Schedule(*pool);
+  std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+  co_return value;
+}
+
+// 切换到线程池中, 等待 delay_ms 后抛出异常
+coro::Task<int> DelayedThrow(ThreadPool* pool, int delay_ms, std::string message) {
+  co_await coro::Schedule(*pool);
+  std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+  throw std::runtime_error(message);
+  co_return 0;
+}
+
+coro::Task<std::thread::id> WorkerId(ThreadPool* pool) {
+  co_await coro::Schedule(*pool);
+  co_return std::this_thread::get_id();
+}
+
+template <typename T>
+std::string ErrorMessage(coro::Task<T> task) {
+  try {
+    coro::SyncWait(std::move(task));
+  } catch (const std::runtime_error& e) {
+    return e.what();
+  }
+  return "";
+}
+
+}  // namespace
+
+TEST(CoroutineTest, sync_wait) {
+  ASSERT_EQ(coro::SyncWait(Value(1)), 1);
+  ASSERT_EQ(coro::SyncWait(Add(1, 2)), 3);
+
+  bool flag = false;
+  coro::SyncWait(SetFlag(&flag));
+  ASSERT_TRUE(flag);
+
+  ASSERT_EQ(ErrorMessage(Throw("oops")), "oops");
+
+  ThreadPool pool(2);
+  ASSERT_NE(coro::SyncWait(WorkerId(&pool)), std::this_thread::get_id());
+  ASSERT_EQ(coro::SyncWait(Delayed(&pool, 1, 7)), 7);
+  ASSERT_EQ(ErrorMessage(DelayedThrow(&pool, 1, "pool")), "pool");
+}
+
+TEST(CoroutineTest, when_all) {
+  ThreadPool pool(4);
+
+  // 先提交的任务后完成, 结果仍然按输入顺序
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 4; ++i) {
+    tasks.emplace_back(Delayed(&pool, (4 - i) * 10, i));
+  }
+  std::vector<int> results = coro::SyncWait(coro::WhenAll(std::move(tasks)));
+  ASSERT_EQ(results, std::vector<int>({0, 1, 2, 3}));
+
+  // 在当前线程同步完成的任务
+  std::vector<coro::Task<int>> ready;
+  ready.emplace_back(Value(1));
+  ready.emplace_back(Add(1, 1));
+  ASSERT_EQ(coro::SyncWait(coro::WhenAll(std::move(ready))), std::vector<int>({1, 2}));
+
+  std::vector<coro::Task<void>> void_tasks;
+  bool flags[3] = {false, false, false};
+  for (auto&& flag : flags) {
+    void_tasks.emplace_back(SetFlag(&flag));
+  }
+  coro::SyncWait(coro::WhenAll(std::move(void_tasks)));
+  for (auto&& flag : flags) {
+    ASSERT_TRUE(flag);
+  }
+}
+
+TEST(CoroutineTest, when_all_exception) {
+  ThreadPool pool(4);
+
+  // 重新抛出最先发生的异常, 而不是下标最小的
+  std::vector<coro::Task<int>> tasks;
+  tasks.emplace_back(DelayedThrow(&pool, 100, "slow"));
+  tasks.emplace_back(DelayedThrow(&pool, 1, "fast"));
+  tasks.emplace_back(Delayed(&pool, 1, 2));
+  ASSERT_EQ(ErrorMessage(coro::WhenAll(std::move(tasks))), "fast");
+
+  std::vector<coro::Task<int>> sync_tasks;
+  sync_tasks.emplace_back(Value(0));
+  sync_tasks.emplace_back(Throw("first"));
+  sync_tasks.emplace_back(Throw("second"));
+  ASSERT_EQ(ErrorMessage(coro::WhenAll(std::move(sync_tasks))), "first");
+}
+
+TEST(CoroutineTest, when_all_empty) {
+  ASSERT_TRUE(coro::SyncWait(coro::WhenAll(std::vector<coro::Task<int>>())).empty());
+  coro::SyncWait(coro::WhenAll(std::vector<coro::Task<void>>()));
+}
+
+TEST(CoroutineTest, when_any) {
+  ThreadPool pool(4);
+
+  std::vector<coro::Task<int>> tasks;
+  tasks.emplace_back(Delayed(&pool, 200, 0));
+  tasks.emplace_back(Delayed(&pool, 1, 10));
+  tasks.emplace_back(Delayed(&pool, 200, 20));
+  std::pair<size_t, int> first = coro::SyncWait(coro::WhenAny(std::move(tasks)));
+  ASSERT_EQ(first.first, 1u);
+  ASSERT_EQ(first.second, 10);
+
+  // 同步完成的任务中第一个获胜
+  std::vector<coro::Task<int>> ready;
+  ready.emplace_back(Value(5));
+  ready.emplace_back(Value(6));
+  std::pair<size_t, int> ready_first = coro::SyncWait(coro::WhenAny(std::move(ready)));
+  ASSERT_EQ(ready_first.first, 0u);
+  ASSERT_EQ(ready_first.second, 5);
+
+  std::vector<coro::Task<void>> void_tasks;
+  bool flag = false;
+  void_tasks.emplace_back(SetFlag(&flag));
+  ASSERT_EQ(coro::SyncWait(coro::WhenAny(std::move(void_tasks))), 0u);
+  ASSERT_TRUE(flag);
+
+  // 最先完成的任务抛出异常
+  std::vector<coro::Task<int>> throwing;
+  throwing.emplace_back(Delayed(&pool, 200, 0));
+  throwing.emplace_back(DelayedThrow(&pool, 1, "any"));
+  ASSERT_EQ(ErrorMessage(coro::WhenAny(std::move(throwing))), "any");
+
+  ASSERT_THROW(coro::SyncWait(coro::WhenAny(std::vector<coro::Task<int>>())), std::invalid_argument);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief 基于计数器的一次性同步原语, 类似 C++20 的 std::latch
+ *
+ * 计数减到 0 之前 Wait 会阻塞, 减到 0 之后所有 Wait 立即返回
+ * 用一个 latch 等待一批任务完成, 可以替代每个任务一个 std::future
+ *
+ * eg:
+ *     CountDownLatch latch(tasks.size());
+ *     for (auto&& task : tasks) {
+ *       pool.Post([&latch, &task]() {
+ *         task();
+ *         latch.CountDown();
+ *       });
+ *     }
+ *     latch.Wait();
+ */
+class CountDownLatch {
+ public:
+  explicit CountDownLatch(int64_t count) : count_(count) {
+  }
+
+  CountDownLatch(const CountDownLatch&) = delete;
+  CountDownLatch& operator=(const CountDownLatch&) = delete;
+
+ public:
+  /**
+   * @brief 计数减 n, 减到 0 时唤醒所有等待者
+   *
+   * @param n
+   */
+  void CountDown(int64_t n = 1) {
+    // 不是最后一次计数时无需加锁
+    int64_t count = count_.load(std::memory_order_relaxed);
+    while (count > n) {
+      if (count_.compare_exchange_weak(count, count - n, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return;
+      }
+    }
+    // 最后一次计数在锁内完成, 等待者拿到锁之后 latch 就不会再被访问, 可以安全析构
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (count_.fetch_sub(n, std::memory_order_acq_rel) <= n) {
+      cv_.notify_all();
+    }
+  }
+
+  /**
+   * @brief 计数是否已经减到 0, 只用于轮询, 返回 true 之后如果要析构 latch 仍需调用一次 Wait
+   */
+  bool TryWait() const {
+    return count_.load(std::memory_order_acquire) <= 0;
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this]() {
+      return TryWait();
+    });
+  }
+
+  template <typename Rep, typename Period>
+  bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    return cv_.wait_for(lock, timeout, [this]() {
+      return TryWait();
+    });
+  }
+
+  int64_t Count() const {
+    return count_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<int64_t> count_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
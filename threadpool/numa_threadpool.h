@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sched.h>
+
+#include "threadpool/threadpool.h"
+#include "util/macro_util.h"
+
+/**
+ * @brief 每个 NUMA 节点一个 ThreadPool 子池, 子池的 worker 绑定在该节点的 CPU 上
+ *
+ * 1. 拓扑从 /sys/devices/system/node 读取, 读取失败时退化成一个不绑核的子池
+ * 2. Post/Enqueue/Submit 提交到调用线程当前所在节点的子池, 任务和提交者共享同一个节点的缓存和内存
+ * 3. 需要指定节点时通过 Node(i) 直接访问子池
+ *
+ * eg:
+ *     NumaThreadPool pool;
+ *     pool.Post([] { ... });                       // 提交到当前节点
+ *     pool.Node(1).Post([] { ... });               // 提交到第 2 个节点
+ */
+class NumaThreadPool {
+ public:
+  // 每个节点的子池使用节点内 CPU 数量作为最大线程数
+  NumaThreadPool();
+  // options 中的线程数对每个子池生效, options.cpus 会被替换成节点的 CPU
+  explicit NumaThreadPool(const ThreadPool::Options& options);
+
+ public:
+  template <typename F>
+  void Post(F&& f) {
+    Local().Post(std::forward<F>(f));
+  }
+
+  template <typename F, typename... Args>
+  auto Enqueue(F&& f, Args&&... args) {
+    return Local().Enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+  }
+
+  template <typename F, typename... Args>
+  auto Submit(F&& f, Args&&... args) {
+    return Local().Submit(std::forward<F>(f), std::forward<Args>(args)...);
+  }
+
+  size_t NodeNum() const {
+    return pools_.size();
+  }
+
+  ThreadPool& Node(size_t index) {
+    return *pools_[index];
+  }
+
+  // 调用线程当前所在节点的下标, 线程可能随时被调度到其他节点, 只用于选择子池
+  size_t CurrentNode() const;
+
+  ThreadPool& Local() {
+    return *pools_[CurrentNode()];
+  }
+
+ public:
+  /**
+   * @brief 解析内核的 CPU 列表格式, eg: "0-3,8-11"
+   *
+   * @param list
+   * @return std::vector<int> 格式错误时返回空
+   */
+  static std::vector<int> ParseCpuList(const std::string& list);
+
+ private:
+  void Init(const ThreadPool::Options& options, bool max_threads_by_node);
+
+ private:
+  std::vector<std::unique_ptr<ThreadPool>> pools_;
+  // 下标为 CPU 编号, 值为子池下标
+  std::vector<size_t> cpu_to_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(NumaThreadPool);
+};
+
+inline NumaThreadPool::NumaThreadPool() {
+  Init(ThreadPool::Options(), true);
+}
+
+inline NumaThreadPool::NumaThreadPool(const ThreadPool::Options& options) {
+  Init(options, false);
+}
+
+inline void NumaThreadPool::Init(const ThreadPool::Options& options, bool max_threads_by_node) {
+  static const std::string kNodeDir = "/sys/devices/system/node/";
+
+  std::string online;
+  std::ifstream online_file(kNodeDir + "online");
+  std::getline(online_file, online);
+  for (int node : ParseCpuList(online)) {
+    std::string cpu_list;
+    std::ifstream cpu_file(kNodeDir + "node" + std::to_string(node) + "/cpulist");
+    std::getline(cpu_file, cpu_list);
+    std::vector<int> cpus = ParseCpuList(cpu_list);
+    // 没有 CPU 的节点(eg: 只有内存)不创建子池
+    if (cpus.empty()) {
+      continue;
+    }
+
+    ThreadPool::Options node_options = options;
+    node_options.cpus = cpus;
+    if (max_threads_by_node) {
+      node_options.max_threads = cpus.size();
+    }
+    for (int cpu : cpus) {
+      if (static_cast<size_t>(cpu) >= cpu_to_pool_.size()) {
+        cpu_to_pool_.resize(cpu + 1, 0);
+      }
+      cpu_to_pool_[cpu] = pools_.size();
+    }
+    pools_.emplace_back(new ThreadPool(node_options));
+  }
+
+  if (pools_.empty()) {
+    ThreadPool::Options node_options = options;
+    node_options.cpus.clear();
+    pools_.emplace_back(new ThreadPool(node_options));
+  }
+}
+
+inline size_t NumaThreadPool::CurrentNode() const {
+  int cpu = sched_getcpu();
+  if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_to_pool_.size()) {
+    return 0;
+  }
+  return cpu_to_pool_[cpu];
+}
+
+inline std::vector<int> NumaThreadPool::ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size() && list[pos] != '\n') {
+    char* end = nullptr;
+    long first = std::strtol(list.c_str() + pos, &end, 10);
+    if (end == list.c_str() + pos || first < 0 || first >= CPU_SETSIZE) {
+      return {};
+    }
+    long last = first;
+    if (*end == '-') {
+      const char* begin = end + 1;
+      last = std::strtol(begin, &end, 10);
+      if (end == begin || last < first || last >= CPU_SETSIZE) {
+        return {};
+      }
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    pos = end - list.c_str();
+    if (pos < list.size() && list[pos] == ',') {
+      ++pos;
+    }
+  }
+  return cpus;
+}
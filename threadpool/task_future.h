@@ -0,0 +1,322 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief TaskPromise/TaskFuture 共享的状态, 对象会被缓存复用
+ *
+ * std::promise/std::future 每次都会在堆上分配共享状态, 线程池里大量短任务时这部分开销很明显
+ * 这里的共享状态用引用计数管理, 最后一个持有者释放时放回当前线程的缓存, 下次创建时直接复用
+ * 典型用法是提交任务的线程同时也是等待结果的线程, 所以共享状态基本都会回到提交线程的缓存中
+ */
+template <typename T>
+class TaskState {
+ public:
+  static TaskState* Acquire() {
+    FreeList& free_list = LocalFreeList();
+    TaskState* state = nullptr;
+    if (!free_list.states.empty()) {
+      state = free_list.states.back();
+      free_list.states.pop_back();
+    } else {
+      state = new TaskState();
+    }
+    // 初始只有 TaskPromise 持有, TaskFuture 的引用在 GetFuture 时再加上
+    state->refs_.store(1, std::memory_order_relaxed);
+    state->is_ready_.store(false, std::memory_order_relaxed);
+    return state;
+  }
+
+  void AddRef() {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void Release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    DestroyValue();
+    exception_ = nullptr;
+    FreeList& free_list = LocalFreeList();
+    if (free_list.states.size() < kMaxCachedStates) {
+      free_list.states.emplace_back(this);
+    } else {
+      delete this;
+    }
+  }
+
+ public:
+  template <typename... Args>
+  void SetValue(Args&&... args) {
+    ::new (static_cast<void*>(&storage_)) T(std::forward<Args>(args)...);
+    has_value_ = true;
+    MarkReady();
+  }
+
+  void SetException(std::exception_ptr exception) {
+    exception_ = std::move(exception);
+    MarkReady();
+  }
+
+  bool IsReady() const {
+    return is_ready_.load(std::memory_order_acquire);
+  }
+
+  void Wait() {
+    if (IsReady()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this]() {
+      return IsReady();
+    });
+  }
+
+  template <typename Rep, typename Period>
+  bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) {
+    if (IsReady()) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    return cv_.wait_for(lock, timeout, [this]() {
+      return IsReady();
+    });
+  }
+
+  T Get() {
+    Wait();
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    return std::move(*reinterpret_cast<T*>(&storage_));
+  }
+
+ private:
+  // 每个线程最多缓存多少个共享状态
+  static constexpr std::size_t kMaxCachedStates = 1024;
+
+  struct FreeList {
+    FreeList() {
+      states.reserve(kMaxCachedStates);
+    }
+    ~FreeList() {
+      for (auto&& state : states) {
+        delete state;
+      }
+    }
+    std::vector<TaskState*> states;
+  };
+
+  static FreeList& LocalFreeList() {
+    thread_local FreeList free_list;
+    return free_list;
+  }
+
+  TaskState() = default;
+  ~TaskState() {
+    DestroyValue();
+  }
+
+  void MarkReady() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      is_ready_.store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+  }
+
+  void DestroyValue() {
+    if (has_value_) {
+      reinterpret_cast<T*>(&storage_)->~T();
+      has_value_ = false;
+    }
+  }
+
+ private:
+  std::atomic<int> refs_ = {0};
+  std::atomic<bool> is_ready_ = {false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::exception_ptr exception_;
+  bool has_value_ = false;
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+};
+
+// void 没有返回值, 用一个空结构体占位
+struct TaskVoid {};
+
+template <typename T>
+struct TaskStateType {
+  using type = TaskState<T>;
+};
+
+template <>
+struct TaskStateType<void> {
+  using type = TaskState<TaskVoid>;
+};
+
+/**
+ * @brief 类似 std::future, 但共享状态来自 TaskState 的缓存, 只能移动
+ *
+ */
+template <typename T>
+class TaskFuture {
+ public:
+  using State = typename TaskStateType<T>::type;
+
+ public:
+  TaskFuture() = default;
+  explicit TaskFuture(State* state) : state_(state) {
+  }
+  TaskFuture(TaskFuture&& other) noexcept : state_(other.state_) {
+    other.state_ = nullptr;
+  }
+  TaskFuture& operator=(TaskFuture&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      state_ = other.state_;
+      other.state_ = nullptr;
+    }
+    return *this;
+  }
+  ~TaskFuture() {
+    Reset();
+  }
+
+  TaskFuture(const TaskFuture&) = delete;
+  TaskFuture& operator=(const TaskFuture&) = delete;
+
+ public:
+  bool Valid() const {
+    return state_ != nullptr;
+  }
+
+  bool IsReady() const {
+    return state_->IsReady();
+  }
+
+  void Wait() const {
+    state_->Wait();
+  }
+
+  template <typename Rep, typename Period>
+  bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) const {
+    return state_->WaitFor(timeout);
+  }
+
+  /**
+   * @brief 阻塞等待结果, 只能调用一次, 任务抛出的异常会在这里重新抛出
+   *
+   */
+  T Get() {
+    State* state = state_;
+    state_ = nullptr;
+    // 保证无论是否抛出异常都会释放共享状态
+    struct Guard {
+      ~Guard() {
+        state->Release();
+      }
+      State* state;
+    } guard{state};
+    return static_cast<T>(state->Get());
+  }
+
+ private:
+  void Reset() {
+    if (state_ != nullptr) {
+      state_->Release();
+      state_ = nullptr;
+    }
+  }
+
+ private:
+  State* state_ = nullptr;
+};
+
+/**
+ * @brief TaskFuture 的生产者一端, 只能移动, 析构时还没有设置结果则设置 broken_promise 异常
+ *
+ */
+template <typename T>
+class TaskPromise {
+ public:
+  using State = typename TaskStateType<T>::type;
+
+ public:
+  TaskPromise() : state_(State::Acquire()) {
+  }
+  TaskPromise(TaskPromise&& other) noexcept : state_(other.state_), future_retrieved_(other.future_retrieved_) {
+    other.state_ = nullptr;
+  }
+  TaskPromise& operator=(TaskPromise&& other) = delete;
+  ~TaskPromise() {
+    if (state_ != nullptr) {
+      SetException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+    }
+  }
+
+  TaskPromise(const TaskPromise&) = delete;
+  TaskPromise& operator=(const TaskPromise&) = delete;
+
+ public:
+  /**
+   * @brief 获取对应的 TaskFuture, 只能调用一次, 并且要在设置结果之前调用
+   */
+  TaskFuture<T> GetFuture() {
+    assert(state_ != nullptr && !future_retrieved_);
+    future_retrieved_ = true;
+    state_->AddRef();
+    return TaskFuture<T>(state_);
+  }
+
+  template <typename... Args>
+  void SetValue(Args&&... args) {
+    state_->SetValue(std::forward<Args>(args)...);
+    state_->Release();
+    state_ = nullptr;
+  }
+
+  void SetException(std::exception_ptr exception) {
+    state_->SetException(std::move(exception));
+    state_->Release();
+    state_ = nullptr;
+  }
+
+  /**
+   * @brief 执行 f 并把返回值或者异常设置到共享状态中
+   */
+  template <typename F>
+  void Run(F&& f) {
+    try {
+      RunImpl(std::forward<F>(f), std::is_void<T>());
+    } catch (...) {
+      SetException(std::current_exception());
+    }
+  }
+
+ private:
+  template <typename F>
+  void RunImpl(F&& f, std::true_type) {
+    std::forward<F>(f)();
+    SetValue();
+  }
+
+  template <typename F>
+  void RunImpl(F&& f, std::false_type) {
+    SetValue(std::forward<F>(f)());
+  }
+
+ private:
+  State* state_;
+  bool future_retrieved_ = false;
+};
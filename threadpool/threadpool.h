@@ -1,28 +1,192 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <stdexcept>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include <pthread.h>
+#include <sched.h>
+
+#include "threadpool/latch.h"
+#include "threadpool/task_future.h"
+#include "threadpool/threadpool_metrics.h"
+#include "threadpool/unique_task.h"
+
+// workers always take a HIGH task first, then NORMAL, then LOW (see ThreadPool::kStarvationLimit)
+enum class TaskPriority {
+  HIGH = 0,
+  NORMAL = 1,
+  LOW = 2,
+};
+
+// identifies a queued task for ThreadPool::Cancel, 0 is never used
+using TaskId = uint64_t;
+
+struct TaskOptions {
+  TaskPriority priority = TaskPriority::NORMAL;
+  // a task still queued when its deadline has passed is dropped instead of run,
+  // futures of dropped tasks report std::future_errc::broken_promise
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
+
 class ThreadPool {
  public:
+  struct Options {
+    // workers kept alive even when idle
+    size_t min_threads = 1;
+    // workers are added while more tasks are queued than there are idle workers, up to max_threads
+    size_t max_threads = std::thread::hardware_concurrency();
+    // workers above min_threads exit after being idle for this long, must be small enough to add to now()
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+    // if not empty every worker is pinned to this set of cpus, best effort
+    std::vector<int> cpus;
+    // collect per-worker metrics for GetMetrics, costs a few clock reads per task when enabled
+    bool enable_metrics = false;
+  };
+
+ public:
+  // a fixed number of workers
   explicit ThreadPool(size_t);
+  explicit ThreadPool(const Options& options);
   template <typename F, typename... Args>
   auto Enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>;
+  // fire-and-forget, small callables are stored inline and need no heap allocation
+  template <typename F>
+  void Post(F&& f);
+  // like Post, with a priority and a deadline, the returned id can be passed to Cancel
+  template <typename F>
+  TaskId Post(const TaskOptions& options, F&& f);
+  // like Enqueue, but the shared state of the returned future is pooled
+  template <typename F, typename... Args,
+            typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskOptions>::value>::type>
+  auto Submit(F&& f, Args&&... args) -> TaskFuture<typename std::result_of<F(Args...)>::type>;
+  template <typename F, typename... Args>
+  auto Submit(const TaskOptions& options, F&& f, Args&&... args)
+      -> TaskFuture<typename std::result_of<F(Args...)>::type>;
+  // remove a task that has not started yet, returns false if it is already running, done or dropped
+  bool Cancel(TaskId id);
+  // post every callable in [first, last) (moved from) under a single lock and a single notify
+  template <typename Iterator>
+  void EnqueueBulk(Iterator first, Iterator last);
+  // call fn(i) for every i in [begin, end), see the definition for details
+  template <typename F>
+  void ParallelFor(size_t begin, size_t end, size_t grain, F&& fn);
+  // reduce [begin, end) to a single value, see the definition for details
+  template <typename T, typename F, typename R>
+  T ParallelReduce(size_t begin, size_t end, size_t grain, T identity, F&& fn, R&& reduce);
+  // aggregated snapshot, empty apart from threads and backlog unless Options::enable_metrics is set
+  ThreadPoolMetrics GetMetrics();
+  // number of live workers
+  size_t Size() const {
+    return thread_num_.load(std::memory_order_relaxed);
+  }
   ~ThreadPool();
 
  private:
-  // need to keep track of threads so we can join them
-  std::vector<std::thread> workers_;
-  // the task queue
-  std::queue<std::function<void()>> tasks_;
+  // shared by the caller and helper tasks of ParallelFor/ParallelReduce, helpers may still be queued
+  // when the caller returns, so it lives in a shared_ptr instead of on the caller's stack
+  struct ParallelState {
+    ParallelState(size_t b, size_t e, size_t g) : begin(b), end(e), grain(g), latch((e - b + g - 1) / g) {
+    }
+    size_t begin;
+    size_t end;
+    size_t grain;
+    std::atomic<size_t> next_chunk = {0};
+    CountDownLatch latch;
+    std::atomic<bool> has_exception = {false};
+    std::exception_ptr exception;
+  };
+
+  // grab chunks until none is left, fn(chunk_idx, chunk_begin, chunk_end) is only called for grabbed chunks,
+  // so everything fn refers to on the caller's stack is still alive
+  template <typename F>
+  static void RunChunks(ParallelState* state, F& fn);
+  template <typename F>
+  void RunParallel(size_t begin, size_t end, size_t grain, F& fn);
+  size_t AutoGrain(size_t begin, size_t end, size_t grain) const;
+
+ private:
+  struct QueuedTask {
+    UniqueTask func;
+    TaskId id = 0;
+    std::chrono::steady_clock::time_point deadline;
+    // only set when metrics are enabled
+    uint64_t enqueue_ns = 0;
+  };
+
+  // a growable ring buffer so that enqueueing is a single slot write
+  class TaskQueue {
+   public:
+    TaskQueue() : slots_(kInitialQueueCapacity) {
+    }
+    void Push(QueuedTask&& task);
+    // must not be called on an empty queue
+    QueuedTask Pop();
+    // cancelled tasks are left in place with an empty func and dropped by Pop, they are not counted by Empty
+    bool Remove(TaskId id, UniqueTask* func);
+    bool Empty() const {
+      return live_ == 0;
+    }
+
+   private:
+    std::vector<QueuedTask> slots_;
+    size_t head_ = 0;
+    // occupied slots, including cancelled ones
+    size_t size_ = 0;
+    // tasks that have not been cancelled
+    size_t live_ = 0;
+  };
+
+  void WorkerLoop(size_t index);
+  // must be called with queue_mutex_ held
+  void AddWorker();
+  void GrowIfNeeded();
+  TaskId PushTask(UniqueTask&& task, const TaskOptions& options);
+  QueuedTask PopTask();
+  void RunTask(QueuedTask* task, WorkerMetricsSlot* metrics);
+
+ private:
+  static constexpr size_t kInitialQueueCapacity = 256;
+  static constexpr size_t kLaneNum = 3;
+  // a non-empty lane passed over this many times in a row for higher priority lanes is served once,
+  // so lower lanes still get at least 1 / (kStarvationLimit + 1) of the workers under sustained load
+  static constexpr uint32_t kStarvationLimit = 16;
+
+ private:
+  const size_t min_threads_;
+  const size_t max_threads_;
+  const std::chrono::milliseconds idle_timeout_;
+  cpu_set_t cpus_;
+  bool pin_cpus_ = false;
+
+  // need to keep track of threads so we can join them, workers leaving on idle timeout move
+  // themselves to retired_ and are joined by the next AddWorker or the destructor
+  // indexes of retired workers are reused, so they stay below max_threads_ and double as metrics slots
+  std::map<size_t, std::thread> workers_;
+  std::vector<std::thread> retired_;
+  // one slot per worker index, empty when metrics are disabled
+  std::vector<std::unique_ptr<WorkerMetricsSlot>> metrics_;
+  size_t idle_workers_ = 0;
+  std::atomic<size_t> thread_num_ = {0};
+  // the task queues, one per priority
+  TaskQueue lanes_[kLaneNum];
+  uint32_t skipped_[kLaneNum] = {0};
+  size_t tasks_size_ = 0;
+  TaskId next_task_id_ = 1;
 
   // synchronization
   std::mutex queue_mutex_;
@@ -31,25 +195,112 @@ class ThreadPool {
 };
 
 // the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads) : stop_(false) {
+inline ThreadPool::ThreadPool(size_t threads)
+    : min_threads_(threads), max_threads_(threads), idle_timeout_(std::chrono::milliseconds::max()), stop_(false) {
+  CPU_ZERO(&cpus_);
+  std::lock_guard<std::mutex> lock(queue_mutex_);
   for (size_t i = 0; i < threads; ++i) {
-    workers_.emplace_back([this] {
-      for (;;) {
-        std::function<void()> task;
-        {
-          std::unique_lock<std::mutex> lock(this->queue_mutex_);
-          this->condition_.wait(lock, [this] {
-            return this->stop_ || !this->tasks_.empty();
-          });
-          if (this->stop_ && this->tasks_.empty()) {
-            return;
+    AddWorker();
+  }
+}
+
+inline ThreadPool::ThreadPool(const Options& options)
+    : min_threads_(options.min_threads),
+      max_threads_(std::max(options.min_threads, options.max_threads)),
+      idle_timeout_(options.idle_timeout),
+      stop_(false) {
+  if (options.enable_metrics) {
+    for (size_t i = 0; i < max_threads_; ++i) {
+      metrics_.emplace_back(new WorkerMetricsSlot());
+    }
+  }
+  CPU_ZERO(&cpus_);
+  for (int cpu : options.cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      throw std::invalid_argument("invalid cpu " + std::to_string(cpu));
+    }
+    CPU_SET(cpu, &cpus_);
+    pin_cpus_ = true;
+  }
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  for (size_t i = 0; i < min_threads_; ++i) {
+    AddWorker();
+  }
+}
+
+inline void ThreadPool::AddWorker() {
+  for (auto&& thread : retired_) {
+    thread.join();
+  }
+  retired_.clear();
+
+  size_t index = 0;
+  while (workers_.count(index) != 0) {
+    ++index;
+  }
+  std::thread thread(&ThreadPool::WorkerLoop, this, index);
+  if (pin_cpus_) {
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpus_), &cpus_);
+  }
+  workers_.emplace(index, std::move(thread));
+  thread_num_.store(workers_.size(), std::memory_order_relaxed);
+  // counted as idle before it starts, otherwise GrowIfNeeded keeps adding workers for the same backlog
+  ++idle_workers_;
+}
+
+inline void ThreadPool::GrowIfNeeded() {
+  // idle workers already notified may not have taken their task yet, so this can undercount the backlog
+  // a little, the next enqueue catches up
+  while (tasks_size_ > idle_workers_ && workers_.size() < max_threads_) {
+    AddWorker();
+  }
+}
+
+inline void ThreadPool::WorkerLoop(size_t index) {
+  WorkerMetricsSlot* metrics = metrics_.empty() ? nullptr : metrics_[index].get();
+  // AddWorker already counted this worker as idle
+  bool counted = true;
+  for (;;) {
+    QueuedTask task;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      if (!counted) {
+        ++idle_workers_;
+      }
+      counted = false;
+      uint64_t idle_begin_ns = 0;
+      if (metrics != nullptr && !stop_ && tasks_size_ == 0) {
+        idle_begin_ns = WorkerMetricsSlot::NowNs();
+      }
+      while (!stop_ && tasks_size_ == 0) {
+        if (workers_.size() <= min_threads_) {
+          condition_.wait(lock);
+          continue;
+        }
+        if (condition_.wait_for(lock, idle_timeout_) == std::cv_status::timeout && !stop_ && tasks_size_ == 0 &&
+            workers_.size() > min_threads_) {
+          // the destructor only joins after stop_ is set, so retiring here never races with it
+          --idle_workers_;
+          if (metrics != nullptr) {
+            metrics->RecordIdle(WorkerMetricsSlot::NowNs() - idle_begin_ns);
           }
-          task = std::move(this->tasks_.front());
-          this->tasks_.pop();
+          auto it = workers_.find(index);
+          retired_.emplace_back(std::move(it->second));
+          workers_.erase(it);
+          thread_num_.store(workers_.size(), std::memory_order_relaxed);
+          return;
         }
-        task();
       }
-    });
+      --idle_workers_;
+      if (idle_begin_ns != 0) {
+        metrics->RecordIdle(WorkerMetricsSlot::NowNs() - idle_begin_ns);
+      }
+      if (stop_ && tasks_size_ == 0) {
+        return;
+      }
+      task = PopTask();
+    }
+    RunTask(&task, metrics);
   }
 }
 
@@ -58,9 +309,23 @@ template <class F, class... Args>
 auto ThreadPool::Enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
   using return_type = typename std::result_of<F(Args...)>::type;
 
-  auto task =
-      std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-  std::future<return_type> res = task->get_future();
+  // UniqueTask is move-only, so the packaged_task no longer needs a shared_ptr around it
+  std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+  std::future<return_type> res = task.get_future();
+  Post(std::move(task));
+  return res;
+}
+
+template <class F>
+void ThreadPool::Post(F&& f) {
+  Post(TaskOptions(), std::forward<F>(f));
+}
+
+template <class F>
+TaskId ThreadPool::Post(const TaskOptions& options, F&& f) {
+  // build the task outside of the lock, large callables may allocate
+  UniqueTask task(std::forward<F>(f));
+  TaskId id;
   {
     std::unique_lock<std::mutex> lock(queue_mutex_);
 
@@ -69,14 +334,302 @@ auto ThreadPool::Enqueue(F&& f, Args&&... args) -> std::future<typename std::res
       throw std::runtime_error("enqueue on stopped ThreadPool");
     }
 
-    tasks_.emplace([task]() {
-      (*task)();
-    });
+    id = PushTask(std::move(task), options);
+    GrowIfNeeded();
   }
   condition_.notify_one();
+  return id;
+}
+
+template <class F, class... Args, class>
+auto ThreadPool::Submit(F&& f, Args&&... args) -> TaskFuture<typename std::result_of<F(Args...)>::type> {
+  return Submit(TaskOptions(), std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <class F, class... Args>
+auto ThreadPool::Submit(const TaskOptions& options, F&& f, Args&&... args)
+    -> TaskFuture<typename std::result_of<F(Args...)>::type> {
+  using return_type = typename std::result_of<F(Args...)>::type;
+
+  TaskPromise<return_type> promise;
+  TaskFuture<return_type> res = promise.GetFuture();
+  Post(options, [promise = std::move(promise), func = std::forward<F>(f),
+                 args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+    promise.Run([&func, &args]() -> return_type {
+      return std::apply(func, std::move(args));
+    });
+  });
+  return res;
+}
+
+inline bool ThreadPool::Cancel(TaskId id) {
+  // destroy the callable outside of the lock, its destructor may complete a future or even touch the pool
+  UniqueTask func;
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  for (auto&& lane : lanes_) {
+    if (lane.Remove(id, &func)) {
+      // tasks_size_ only counts tasks that will be handed to a worker
+      --tasks_size_;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class Iterator>
+void ThreadPool::EnqueueBulk(Iterator first, Iterator last) {
+  std::vector<UniqueTask> tasks;
+  for (; first != last; ++first) {
+    tasks.emplace_back(std::move(*first));
+  }
+  if (tasks.empty()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+
+    // don't allow enqueueing after stopping the pool
+    if (stop_) {
+      throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+
+    TaskOptions options;
+    for (auto&& task : tasks) {
+      PushTask(std::move(task), options);
+    }
+    GrowIfNeeded();
+  }
+  if (tasks.size() == 1) {
+    condition_.notify_one();
+  } else {
+    condition_.notify_all();
+  }
+}
+
+/**
+ * split [begin, end) into chunks of `grain` indices (0 means pick one automatically) and call fn(i) for each index.
+ * chunks are handed out through an atomic counter, so fast participants simply take more chunks. the calling thread
+ * participates too, which also makes nested ParallelFor calls from inside a worker deadlock-free. the first exception
+ * thrown by fn is rethrown in the caller after all chunks finish.
+ */
+template <class F>
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, F&& fn) {
+  auto chunk_fn = [&fn](size_t, size_t chunk_begin, size_t chunk_end) {
+    for (size_t i = chunk_begin; i < chunk_end; ++i) {
+      fn(i);
+    }
+  };
+  RunParallel(begin, end, grain, chunk_fn);
+}
+
+/**
+ * fn(chunk_begin, chunk_end, identity) -> T reduces one chunk, reduce(T, T) -> T combines partial results.
+ * partial results are combined in chunk order by the caller, so reduce only needs to be associative and the result
+ * is deterministic for a given grain (eg: floating point sums).
+ */
+template <class T, class F, class R>
+T ThreadPool::ParallelReduce(size_t begin, size_t end, size_t grain, T identity, F&& fn, R&& reduce) {
+  if (begin >= end) {
+    return identity;
+  }
+  grain = AutoGrain(begin, end, grain);
+  std::vector<T> partials((end - begin + grain - 1) / grain, identity);
+  auto chunk_fn = [&fn, &partials, &identity](size_t chunk_idx, size_t chunk_begin, size_t chunk_end) {
+    partials[chunk_idx] = fn(chunk_begin, chunk_end, identity);
+  };
+  RunParallel(begin, end, grain, chunk_fn);
+
+  T result = std::move(identity);
+  for (auto&& partial : partials) {
+    result = reduce(std::move(result), std::move(partial));
+  }
+  return result;
+}
+
+template <class F>
+void ThreadPool::RunChunks(ParallelState* state, F& fn) {
+  size_t chunk_num = (state->end - state->begin + state->grain - 1) / state->grain;
+  while (true) {
+    size_t chunk_idx = state->next_chunk.fetch_add(1, std::memory_order_relaxed);
+    if (chunk_idx >= chunk_num) {
+      return;
+    }
+    // after an exception the remaining chunks are only counted down
+    if (!state->has_exception.load(std::memory_order_relaxed)) {
+      size_t chunk_begin = state->begin + chunk_idx * state->grain;
+      size_t chunk_end = std::min(chunk_begin + state->grain, state->end);
+      try {
+        fn(chunk_idx, chunk_begin, chunk_end);
+      } catch (...) {
+        if (!state->has_exception.exchange(true)) {
+          state->exception = std::current_exception();
+        }
+      }
+    }
+    state->latch.CountDown();
+  }
+}
+
+template <class F>
+void ThreadPool::RunParallel(size_t begin, size_t end, size_t grain, F& fn) {
+  if (begin >= end) {
+    return;
+  }
+  grain = AutoGrain(begin, end, grain);
+  size_t chunk_num = (end - begin + grain - 1) / grain;
+  auto state = std::make_shared<ParallelState>(begin, end, grain);
+
+  // the caller takes chunks as well, so at most chunk_num - 1 helpers are useful, an elastic pool grows
+  // to run them
+  size_t helper_num = std::min(max_threads_, chunk_num - 1);
+  if (helper_num > 0) {
+    std::vector<UniqueTask> helpers;
+    helpers.reserve(helper_num);
+    F* fn_ptr = &fn;
+    for (size_t i = 0; i < helper_num; ++i) {
+      helpers.emplace_back([state, fn_ptr]() {
+        RunChunks(state.get(), *fn_ptr);
+      });
+    }
+    EnqueueBulk(helpers.begin(), helpers.end());
+  }
+
+  RunChunks(state.get(), fn);
+  state->latch.Wait();
+  if (state->exception) {
+    std::rethrow_exception(state->exception);
+  }
+}
+
+inline size_t ThreadPool::AutoGrain(size_t begin, size_t end, size_t grain) const {
+  if (grain > 0) {
+    return grain;
+  }
+  // about 4 chunks per participant leaves room for load balancing without too much counter traffic
+  size_t participants = max_threads_ + 1;
+  return std::max<size_t>(1, (end - begin) / (participants * 4));
+}
+
+inline TaskId ThreadPool::PushTask(UniqueTask&& task, const TaskOptions& options) {
+  TaskId id = next_task_id_++;
+  uint64_t enqueue_ns = metrics_.empty() ? 0 : WorkerMetricsSlot::NowNs();
+  lanes_[static_cast<size_t>(options.priority)].Push(QueuedTask{std::move(task), id, options.deadline, enqueue_ns});
+  ++tasks_size_;
+  return id;
+}
+
+inline ThreadPool::QueuedTask ThreadPool::PopTask() {
+  size_t lane = kLaneNum;
+  // serve a starving lower priority lane first
+  for (size_t i = kLaneNum - 1; i > 0; --i) {
+    if (!lanes_[i].Empty() && skipped_[i] >= kStarvationLimit) {
+      lane = i;
+      break;
+    }
+  }
+  if (lane == kLaneNum) {
+    for (size_t i = 0; i < kLaneNum; ++i) {
+      if (!lanes_[i].Empty()) {
+        lane = i;
+        break;
+      }
+    }
+  }
+  for (size_t i = lane + 1; i < kLaneNum; ++i) {
+    skipped_[i] = lanes_[i].Empty() ? 0 : skipped_[i] + 1;
+  }
+  skipped_[lane] = 0;
+  --tasks_size_;
+  return lanes_[lane].Pop();
+}
+
+inline void ThreadPool::RunTask(QueuedTask* task, WorkerMetricsSlot* metrics) {
+  // only tasks with a deadline pay for reading the clock
+  if (task->deadline != std::chrono::steady_clock::time_point::max() &&
+      std::chrono::steady_clock::now() > task->deadline) {
+    return;
+  }
+  if (metrics == nullptr) {
+    task->func();
+    return;
+  }
+  uint64_t begin_ns = WorkerMetricsSlot::NowNs();
+  task->func();
+  uint64_t end_ns = WorkerMetricsSlot::NowNs();
+  metrics->RecordTask(begin_ns - task->enqueue_ns, end_ns - begin_ns);
+}
+
+inline ThreadPoolMetrics ThreadPool::GetMetrics() {
+  ThreadPoolMetrics res;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    res.threads = workers_.size();
+    res.backlog = tasks_size_;
+  }
+  res.workers.resize(metrics_.size());
+  for (size_t i = 0; i < metrics_.size(); ++i) {
+    metrics_[i]->Snapshot(&res.workers[i]);
+    res.total.Merge(res.workers[i]);
+  }
   return res;
 }
 
+inline void ThreadPool::TaskQueue::Push(QueuedTask&& task) {
+  if (size_ == slots_.size()) {
+    // grow by doubling, the capacity is always a power of two
+    std::vector<QueuedTask> new_slots(slots_.size() * 2);
+    for (size_t i = 0; i < size_; ++i) {
+      new_slots[i] = std::move(slots_[(head_ + i) & (slots_.size() - 1)]);
+    }
+    slots_.swap(new_slots);
+    head_ = 0;
+  }
+  slots_[(head_ + size_) & (slots_.size() - 1)] = std::move(task);
+  ++size_;
+  ++live_;
+}
+
+inline ThreadPool::QueuedTask ThreadPool::TaskQueue::Pop() {
+  size_t mask = slots_.size() - 1;
+  // skip cancelled tasks, live_ > 0 guarantees a live one follows
+  while (!slots_[head_].func) {
+    head_ = (head_ + 1) & mask;
+    --size_;
+  }
+  QueuedTask task = std::move(slots_[head_]);
+  head_ = (head_ + 1) & mask;
+  --size_;
+  --live_;
+  return task;
+}
+
+inline bool ThreadPool::TaskQueue::Remove(TaskId id, UniqueTask* func) {
+  if (size_ == 0) {
+    return false;
+  }
+  // ids only grow, so a lane can be skipped unless id falls between its first and last task
+  size_t mask = slots_.size() - 1;
+  if (id < slots_[head_].id || id > slots_[(head_ + size_ - 1) & mask].id) {
+    return false;
+  }
+  for (size_t i = 0; i < size_; ++i) {
+    QueuedTask& task = slots_[(head_ + i) & mask];
+    if (task.id == id) {
+      if (!task.func) {
+        return false;
+      }
+      *func = std::move(task.func);
+      // only cancelled tasks are left, drop them all at once
+      if (--live_ == 0) {
+        head_ = 0;
+        size_ = 0;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool() {
   {
@@ -84,7 +637,11 @@ inline ThreadPool::~ThreadPool() {
     stop_ = true;
   }
   condition_.notify_all();
-  for (std::thread& worker : workers_) {
-    worker.join();
+  // workers stop touching workers_ and retired_ once stop_ is set
+  for (auto&& worker : workers_) {
+    worker.second.join();
+  }
+  for (auto&& thread : retired_) {
+    thread.join();
   }
 }
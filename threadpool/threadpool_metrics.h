@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "util/macro_util.h"
+
+/**
+ * @brief 以 2 的幂为边界的耗时直方图(纳秒), 第 i 个桶统计 [2^(i-1), 2^i) 的样本, 第 0 个桶统计 0
+ *
+ * 只用于快照, 并发写入由 WorkerMetricsSlot 负责
+ */
+struct LatencyHistogram {
+  static constexpr size_t kBucketNum = 40;
+
+  std::array<uint64_t, kBucketNum> buckets = {};
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+
+  static size_t BucketIndex(uint64_t ns) {
+    if (ns == 0) {
+      return 0;
+    }
+    size_t index = 64 - __builtin_clzll(ns);
+    return index < kBucketNum ? index : kBucketNum - 1;
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketNum; ++i) {
+      buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum_ns += other.sum_ns;
+  }
+
+  uint64_t MeanNs() const {
+    return count == 0 ? 0 : sum_ns / count;
+  }
+
+  /**
+   * @brief 估算分位数, 返回所在桶的上界, 误差在 2 倍以内
+   *
+   * @param p 0 ~ 1, eg: 0.99
+   */
+  uint64_t PercentileNs(double p) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketNum; ++i) {
+      seen += buckets[i];
+      if (seen > rank) {
+        return i == 0 ? 0 : (1ULL << i) - 1;
+      }
+    }
+    return (1ULL << (kBucketNum - 1)) - 1;
+  }
+};
+
+// 单个 worker 的统计快照
+struct WorkerMetrics {
+  uint64_t tasks_executed = 0;
+  // 从其他 worker 窃取到的任务数, 只有 WorkStealingThreadPool 统计
+  uint64_t steals = 0;
+  // 空闲时间在空闲结束(拿到任务或退出)时才累加, 正在空闲的这一段不计入
+  uint64_t idle_ns = 0;
+  // 任务从提交到开始执行的时间
+  LatencyHistogram queue_wait;
+  // 任务的执行时间
+  LatencyHistogram exec_time;
+
+  void Merge(const WorkerMetrics& other) {
+    tasks_executed += other.tasks_executed;
+    steals += other.steals;
+    idle_ns += other.idle_ns;
+    queue_wait.Merge(other.queue_wait);
+    exec_time.Merge(other.exec_time);
+  }
+};
+
+// 线程池的统计快照
+struct ThreadPoolMetrics {
+  size_t threads = 0;
+  // 还在排队的任务数
+  size_t backlog = 0;
+  // 所有 worker 的汇总
+  WorkerMetrics total;
+  std::vector<WorkerMetrics> workers;
+};
+
+/**
+ * @brief 每个 worker 独占的统计槽位, 按 cache line 对齐避免伪共享
+ *
+ * 只有所属 worker 写入, 所以用 relaxed load + store 代替原子加, 读取方得到的是近似一致的快照
+ * 槽位被复用时(线程池缩容后再扩容)统计值会继续累加
+ */
+class alignas(CACHE_LINE_SIZE) WorkerMetricsSlot {
+ public:
+  static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void RecordTask(uint64_t wait_ns, uint64_t exec_ns) {
+    Add(&tasks_executed_, 1);
+    Add(&queue_wait_[LatencyHistogram::BucketIndex(wait_ns)], 1);
+    Add(&queue_wait_sum_, wait_ns);
+    Add(&exec_time_[LatencyHistogram::BucketIndex(exec_ns)], 1);
+    Add(&exec_time_sum_, exec_ns);
+  }
+
+  void RecordSteal() {
+    Add(&steals_, 1);
+  }
+
+  void RecordIdle(uint64_t ns) {
+    Add(&idle_ns_, ns);
+  }
+
+  void Snapshot(WorkerMetrics* metrics) const {
+    metrics->tasks_executed = tasks_executed_.load(std::memory_order_relaxed);
+    metrics->steals = steals_.load(std::memory_order_relaxed);
+    metrics->idle_ns = idle_ns_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < LatencyHistogram::kBucketNum; ++i) {
+      metrics->queue_wait.buckets[i] = queue_wait_[i].load(std::memory_order_relaxed);
+      metrics->queue_wait.count += metrics->queue_wait.buckets[i];
+      metrics->exec_time.buckets[i] = exec_time_[i].load(std::memory_order_relaxed);
+      metrics->exec_time.count += metrics->exec_time.buckets[i];
+    }
+    metrics->queue_wait.sum_ns = queue_wait_sum_.load(std::memory_order_relaxed);
+    metrics->exec_time.sum_ns = exec_time_sum_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static void Add(std::atomic<uint64_t>* counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> tasks_executed_ = {0};
+  std::atomic<uint64_t> steals_ = {0};
+  std::atomic<uint64_t> idle_ns_ = {0};
+  std::atomic<uint64_t> queue_wait_sum_ = {0};
+  std::atomic<uint64_t> exec_time_sum_ = {0};
+  std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketNum> queue_wait_ = {};
+  std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketNum> exec_time_ = {};
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "threadpool/threadpool.h"
+#include "threadpool/unique_task.h"
+#include "util/macro_util.h"
+
+/**
+ * @brief 基于哈希时间轮的定时任务调度器, 到期的任务投递到 ThreadPool 中执行
+ *
+ * 1. 时间轮有 wheel_size 个槽, 每个槽对应一个 tick, 定时器按到期 tick 取模放入槽内的双向链表, 插入和取消都是 O(1)
+ * 2. 超过一圈的定时器留在槽中, 等到期的那一圈才会触发
+ * 3. 用位图记录非空的槽, 定时线程直接休眠到下一个非空槽的时间, 没有定时器时一直休眠
+ * 4. 定时线程只负责投递任务, 任务本身在线程池中执行, 精度为一个 tick
+ *
+ * 必须在 pool 之前析构, 析构时未到期的定时器直接丢弃
+ *
+ * eg:
+ *     ThreadPool pool(4);
+ *     TimerScheduler scheduler(&pool);
+ *     scheduler.RunAfter(std::chrono::milliseconds(100), [] { ... });
+ *     TimerId id = scheduler.RunEvery(std::chrono::seconds(1), [] { ... });
+ *     scheduler.Cancel(id);
+ */
+class TimerScheduler {
+ public:
+  using TimerId = uint64_t;
+
+  struct Options {
+    // 时间轮精度
+    std::chrono::milliseconds tick = std::chrono::milliseconds(1);
+    // 槽的数量, 向上取整为 2 的幂
+    size_t wheel_size = 4096;
+  };
+
+ public:
+  explicit TimerScheduler(ThreadPool* pool);
+  TimerScheduler(ThreadPool* pool, const Options& options);
+  ~TimerScheduler();
+
+ public:
+  /**
+   * @brief delay 之后在线程池中执行一次 f
+   *
+   * @return TimerId 用于 Cancel, 不会是 0
+   */
+  template <typename F>
+  TimerId RunAfter(std::chrono::milliseconds delay, F&& f);
+
+  /**
+   * @brief 每隔 interval 在线程池中执行一次 f, 第一次在 interval 之后执行
+   *
+   * 上一次还没执行完时跳过这一次, 同一个定时任务不会并发执行
+   */
+  template <typename F>
+  TimerId RunEvery(std::chrono::milliseconds interval, F&& f);
+
+  /**
+   * @brief 取消还未触发的定时器, 周期任务取消后不会再触发, 已经投递到线程池的任务不受影响
+   *
+   * @return bool 定时器不存在或者单次定时器已经触发时返回 false
+   */
+  bool Cancel(TimerId id);
+
+  // 未触发的定时器数量
+  size_t Size() const;
+
+ private:
+  // 周期任务每次触发都要投递一次, 由定时器和正在执行的任务共享
+  struct PeriodicTask {
+    explicit PeriodicTask(UniqueTask&& f) : func(std::move(f)) {
+    }
+    UniqueTask func;
+    std::atomic<bool> running = {false};
+  };
+
+  struct Timer {
+    TimerId id = 0;
+    uint64_t expire_tick = 0;
+    // 0 表示单次定时器
+    uint64_t interval_ticks = 0;
+    UniqueTask func;
+    std::shared_ptr<PeriodicTask> periodic;
+    Timer* prev = nullptr;
+    Timer* next = nullptr;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+ private:
+  TimerId AddTimer(std::chrono::milliseconds delay, uint64_t interval_ticks, UniqueTask&& func,
+                   std::shared_ptr<PeriodicTask> periodic);
+  uint64_t ToTicks(Clock::duration duration) const;
+  uint64_t NowTick() const;
+  // 以下接口需要持有 mtx_
+  void LinkTimer(Timer* timer);
+  void UnlinkTimer(Timer* timer);
+  // 从 tick 开始一圈之内第一个非空槽对应的 tick, 没有返回 UINT64_MAX
+  uint64_t NextNonEmptyTick(uint64_t tick) const;
+  void ExpireSlot(uint64_t tick, std::vector<UniqueTask>* ready);
+  void Loop();
+  void Fire(std::vector<UniqueTask>* ready);
+
+ private:
+  ThreadPool* pool_;
+  const Clock::duration tick_;
+  const Clock::time_point start_;
+  std::vector<Timer*> slots_;
+  // 第 i 位表示第 i 个槽非空
+  std::vector<uint64_t> slot_bitmap_;
+  size_t slot_mask_ = 0;
+
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+  std::unordered_map<TimerId, Timer*> timers_;
+  TimerId next_id_ = 1;
+  // 下一个还未处理的 tick
+  uint64_t current_tick_ = 0;
+  // 定时线程休眠到的 tick, 新定时器更早到期时才需要唤醒
+  uint64_t wakeup_tick_ = UINT64_MAX;
+  bool stop_ = false;
+  std::thread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerScheduler);
+};
+
+inline TimerScheduler::TimerScheduler(ThreadPool* pool) : TimerScheduler(pool, Options()) {
+}
+
+inline TimerScheduler::TimerScheduler(ThreadPool* pool, const Options& options)
+    : pool_(pool), tick_(options.tick), start_(Clock::now()) {
+  if (options.tick.count() <= 0) {
+    throw std::invalid_argument("TimerScheduler tick must be positive");
+  }
+  size_t wheel_size = 64;
+  while (wheel_size < options.wheel_size) {
+    wheel_size <<= 1;
+  }
+  slots_.assign(wheel_size, nullptr);
+  slot_bitmap_.assign(wheel_size / 64, 0);
+  slot_mask_ = wheel_size - 1;
+  thread_ = std::thread(&TimerScheduler::Loop, this);
+}
+
+inline TimerScheduler::~TimerScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+  for (auto&& item : timers_) {
+    delete item.second;
+  }
+}
+
+template <class F>
+TimerScheduler::TimerId TimerScheduler::RunAfter(std::chrono::milliseconds delay, F&& f) {
+  return AddTimer(delay, 0, UniqueTask(std::forward<F>(f)), nullptr);
+}
+
+template <class F>
+TimerScheduler::TimerId TimerScheduler::RunEvery(std::chrono::milliseconds interval, F&& f) {
+  auto periodic = std::make_shared<PeriodicTask>(UniqueTask(std::forward<F>(f)));
+  return AddTimer(interval, std::max<uint64_t>(1, ToTicks(interval)), UniqueTask(), std::move(periodic));
+}
+
+inline bool TimerScheduler::Cancel(TimerId id) {
+  Timer* timer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto iter = timers_.find(id);
+    if (iter == timers_.end()) {
+      return false;
+    }
+    timer = iter->second;
+    timers_.erase(iter);
+    UnlinkTimer(timer);
+  }
+  // 任务的析构放在锁外
+  delete timer;
+  return true;
+}
+
+inline size_t TimerScheduler::Size() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return timers_.size();
+}
+
+inline TimerScheduler::TimerId TimerScheduler::AddTimer(std::chrono::milliseconds delay, uint64_t interval_ticks,
+                                                        UniqueTask&& func, std::shared_ptr<PeriodicTask> periodic) {
+  Timer* timer = new Timer();
+  timer->interval_ticks = interval_ticks;
+  timer->func = std::move(func);
+  timer->periodic = std::move(periodic);
+  uint64_t expire_tick = ToTicks(Clock::now() - start_ + delay);
+
+  bool need_wakeup = false;
+  TimerId id;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    id = next_id_++;
+    timer->id = id;
+    // 已经处理过的 tick 不会再处理, 最早在下一个 tick 触发
+    timer->expire_tick = std::max(expire_tick, current_tick_);
+    LinkTimer(timer);
+    timers_.emplace(id, timer);
+    need_wakeup = timer->expire_tick < wakeup_tick_;
+  }
+  if (need_wakeup) {
+    cv_.notify_one();
+  }
+  return id;
+}
+
+inline uint64_t TimerScheduler::ToTicks(Clock::duration duration) const {
+  if (duration.count() <= 0) {
+    return 0;
+  }
+  // 向上取整, 保证不会提前触发
+  return (duration + tick_ - Clock::duration(1)) / tick_;
+}
+
+inline uint64_t TimerScheduler::NowTick() const {
+  return (Clock::now() - start_) / tick_;
+}
+
+inline void TimerScheduler::LinkTimer(Timer* timer) {
+  size_t slot = timer->expire_tick & slot_mask_;
+  timer->prev = nullptr;
+  timer->next = slots_[slot];
+  if (slots_[slot] != nullptr) {
+    slots_[slot]->prev = timer;
+  }
+  slots_[slot] = timer;
+  slot_bitmap_[slot / 64] |= 1ULL << (slot % 64);
+}
+
+inline void TimerScheduler::UnlinkTimer(Timer* timer) {
+  size_t slot = timer->expire_tick & slot_mask_;
+  if (timer->prev != nullptr) {
+    timer->prev->next = timer->next;
+  } else {
+    slots_[slot] = timer->next;
+  }
+  if (timer->next != nullptr) {
+    timer->next->prev = timer->prev;
+  }
+  timer->prev = nullptr;
+  timer->next = nullptr;
+  if (slots_[slot] == nullptr) {
+    slot_bitmap_[slot / 64] &= ~(1ULL << (slot % 64));
+  }
+}
+
+inline uint64_t TimerScheduler::NextNonEmptyTick(uint64_t tick) const {
+  size_t wheel_size = slots_.size();
+  size_t start = tick & slot_mask_;
+  // 从 start 开始绕一圈, 多检查一个字用于覆盖 start 所在字中 start 之前的位
+  for (size_t i = 0; i <= wheel_size / 64; ++i) {
+    size_t word_idx = (start / 64 + i) % (wheel_size / 64);
+    uint64_t word = slot_bitmap_[word_idx];
+    if (i == 0) {
+      word &= ~0ULL << (start % 64);
+    } else if (i == wheel_size / 64) {
+      word &= (1ULL << (start % 64)) - 1;
+    }
+    if (word != 0) {
+      size_t slot = word_idx * 64 + __builtin_ctzll(word);
+      return tick + ((slot - start) & slot_mask_);
+    }
+  }
+  return UINT64_MAX;
+}
+
+inline void TimerScheduler::ExpireSlot(uint64_t tick, std::vector<UniqueTask>* ready) {
+  std::vector<Timer*> expired;
+  for (Timer* timer = slots_[tick & slot_mask_]; timer != nullptr; timer = timer->next) {
+    // 其他圈的定时器留在槽中
+    if (timer->expire_tick <= tick) {
+      expired.push_back(timer);
+    }
+  }
+
+  for (Timer* timer : expired) {
+    UnlinkTimer(timer);
+    if (timer->interval_ticks == 0) {
+      timers_.erase(timer->id);
+      ready->emplace_back(std::move(timer->func));
+      delete timer;
+      continue;
+    }
+
+    std::shared_ptr<PeriodicTask>& periodic = timer->periodic;
+    if (!periodic->running.exchange(true, std::memory_order_acq_rel)) {
+      ready->emplace_back([periodic]() {
+        periodic->func();
+        periodic->running.store(false, std::memory_order_release);
+      });
+    }
+    timer->expire_tick = tick + timer->interval_ticks;
+    LinkTimer(timer);
+  }
+}
+
+inline void TimerScheduler::Loop() {
+  std::vector<UniqueTask> ready;
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!stop_) {
+    uint64_t now_tick = NowTick();
+    while (current_tick_ <= now_tick) {
+      uint64_t tick = NextNonEmptyTick(current_tick_);
+      if (tick > now_tick) {
+        current_tick_ = now_tick + 1;
+        break;
+      }
+      ExpireSlot(tick, &ready);
+      current_tick_ = tick + 1;
+    }
+
+    if (!ready.empty()) {
+      lock.unlock();
+      Fire(&ready);
+      lock.lock();
+      continue;
+    }
+
+    wakeup_tick_ = NextNonEmptyTick(current_tick_);
+    if (wakeup_tick_ == UINT64_MAX) {
+      cv_.wait(lock);
+    } else {
+      cv_.wait_until(lock, start_ + tick_ * wakeup_tick_);
+    }
+    wakeup_tick_ = UINT64_MAX;
+  }
+}
+
+inline void TimerScheduler::Fire(std::vector<UniqueTask>* ready) {
+  if (ready->size() == 1) {
+    try {
+      pool_->Post(std::move(ready->front()));
+    } catch (const std::runtime_error&) {
+      // 线程池已经停止, 丢弃任务
+    }
+  } else {
+    try {
+      pool_->EnqueueBulk(ready->begin(), ready->end());
+    } catch (const std::runtime_error&) {
+    }
+  }
+  ready->clear();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief 只能移动的 void() 任务, 带小对象优化(SBO)
+ *
+ * 1. 不超过 kInlineSize 字节且移动构造不抛异常的可调用对象直接存放在对象内部, 不需要堆分配
+ * 2. 更大的可调用对象才分配到堆上, 对象内部只存放指针
+ * 3. 和 std::function 不同, 可以存放 std::packaged_task 等只能移动的对象
+ *
+ * sizeof(UniqueTask) 正好是一个 cache line
+ */
+class UniqueTask {
+ public:
+  static constexpr std::size_t kInlineSize = 48;
+
+ public:
+  UniqueTask() noexcept = default;
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, UniqueTask>::value>::type>
+  UniqueTask(F&& f) {  // NOLINT: 允许隐式转换, 方便直接传入 lambda
+    using Fn = typename std::decay<F>::type;
+    if constexpr (IsInline<Fn>()) {
+      ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+      ops_ = &kInlineOps<Fn>;
+    } else {
+      *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+      ops_ = &kHeapOps<Fn>;
+    }
+  }
+
+  UniqueTask(UniqueTask&& other) noexcept {
+    MoveFrom(&other);
+  }
+
+  UniqueTask& operator=(UniqueTask&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(&other);
+    }
+    return *this;
+  }
+
+  ~UniqueTask() {
+    Reset();
+  }
+
+  UniqueTask(const UniqueTask&) = delete;
+  UniqueTask& operator=(const UniqueTask&) = delete;
+
+ public:
+  void operator()() {
+    ops_->invoke(storage_);
+  }
+
+  explicit operator bool() const noexcept {
+    return ops_ != nullptr;
+  }
+
+  void Reset() noexcept {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  /**
+   * @brief 可调用对象 F 是否会存放在对象内部
+   */
+  template <typename F>
+  static constexpr bool IsInline() {
+    return sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    // 将 src 中的对象移动到 dst, 并析构 src 中的对象
+    void (*relocate)(void* dst, void* src) noexcept;
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename F>
+  static void InlineInvoke(void* storage) {
+    (*static_cast<F*>(storage))();
+  }
+
+  template <typename F>
+  static void InlineRelocate(void* dst, void* src) noexcept {
+    ::new (dst) F(std::move(*static_cast<F*>(src)));
+    static_cast<F*>(src)->~F();
+  }
+
+  template <typename F>
+  static void InlineDestroy(void* storage) noexcept {
+    static_cast<F*>(storage)->~F();
+  }
+
+  template <typename F>
+  static void HeapInvoke(void* storage) {
+    (**static_cast<F**>(storage))();
+  }
+
+  template <typename F>
+  static void HeapRelocate(void* dst, void* src) noexcept {
+    *static_cast<F**>(dst) = *static_cast<F**>(src);
+  }
+
+  template <typename F>
+  static void HeapDestroy(void* storage) noexcept {
+    delete *static_cast<F**>(storage);
+  }
+
+  template <typename F>
+  static constexpr Ops kInlineOps = {&InlineInvoke<F>, &InlineRelocate<F>, &InlineDestroy<F>};
+
+  template <typename F>
+  static constexpr Ops kHeapOps = {&HeapInvoke<F>, &HeapRelocate<F>, &HeapDestroy<F>};
+
+  void MoveFrom(UniqueTask* other) noexcept {
+    ops_ = other->ops_;
+    if (ops_ != nullptr) {
+      ops_->relocate(storage_, other->storage_);
+      other->ops_ = nullptr;
+    }
+  }
+
+ private:
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
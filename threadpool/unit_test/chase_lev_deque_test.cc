@@ -0,0 +1,92 @@
+#include "threadpool/chase_lev_deque.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(ChaseLevDequeTest, usage) {
+  ChaseLevDeque<int64_t> deque(2);
+  int64_t item;
+  ASSERT_FALSE(deque.Pop(&item));
+  ASSERT_FALSE(deque.Steal(&item));
+
+  // 容量从 2 开始, 多次扩容之后元素不变
+  for (int64_t i = 0; i < 100; ++i) {
+    deque.Push(i);
+  }
+  ASSERT_EQ(deque.Size(), 100);
+  // owner 从 bottom 端后进先出, 窃取者从 top 端先进先出
+  ASSERT_TRUE(deque.Pop(&item));
+  ASSERT_EQ(item, 99);
+  ASSERT_TRUE(deque.Steal(&item));
+  ASSERT_EQ(item, 0);
+  for (int64_t i = 98; i >= 1; --i) {
+    ASSERT_TRUE(deque.Pop(&item));
+    ASSERT_EQ(item, i);
+  }
+  ASSERT_TRUE(deque.Empty());
+  ASSERT_FALSE(deque.Pop(&item));
+  ASSERT_FALSE(deque.Steal(&item));
+
+  // 清空之后继续使用
+  deque.Push(7);
+  ASSERT_TRUE(deque.Steal(&item));
+  ASSERT_EQ(item, 7);
+  ASSERT_FALSE(deque.Pop(&item));
+}
+
+// owner 一边 Push/Pop 一边被多个线程窃取, 每个元素恰好被取走一次
+TEST(ChaseLevDequeTest, concurrent_steal) {
+  const int64_t kItems = 200000;
+  const int kStealers = 3;
+  ChaseLevDeque<int64_t> deque(2);
+  std::atomic<bool> done = {false};
+
+  std::vector<std::vector<int64_t>> stolen(kStealers);
+  std::vector<std::thread> stealers;
+  for (int i = 0; i < kStealers; ++i) {
+    stealers.emplace_back([&deque, &done, &stolen, i]() {
+      int64_t item;
+      while (!done.load(std::memory_order_acquire) || !deque.Empty()) {
+        if (deque.Steal(&item)) {
+          stolen[i].push_back(item);
+        }
+      }
+    });
+  }
+
+  std::vector<int64_t> popped;
+  int64_t item;
+  for (int64_t i = 0; i < kItems; ++i) {
+    deque.Push(i);
+    // 时不时弹出几个, 制造 owner 和窃取者争抢最后一个元素的场景
+    if (i % 3 == 0) {
+      for (int k = 0; k < 2 && deque.Pop(&item); ++k) {
+        popped.push_back(item);
+      }
+    }
+  }
+  while (deque.Pop(&item)) {
+    popped.push_back(item);
+  }
+  done.store(true, std::memory_order_release);
+  for (auto&& stealer : stealers) {
+    stealer.join();
+  }
+
+  std::vector<int> seen(kItems, 0);
+  for (int64_t value : popped) {
+    ++seen[value];
+  }
+  for (auto&& items : stolen) {
+    for (int64_t value : items) {
+      ++seen[value];
+    }
+  }
+  for (int64_t i = 0; i < kItems; ++i) {
+    ASSERT_EQ(seen[i], 1) << "item " << i;
+  }
+}
@@ -0,0 +1,43 @@
+#include "threadpool/numa_threadpool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(NumaThreadPoolTest, parse_cpu_list) {
+  ASSERT_EQ(NumaThreadPool::ParseCpuList("0"), std::vector<int>({0}));
+  ASSERT_EQ(NumaThreadPool::ParseCpuList("0-3,8-9\n"), std::vector<int>({0, 1, 2, 3, 8, 9}));
+  ASSERT_EQ(NumaThreadPool::ParseCpuList("1,3,5"), std::vector<int>({1, 3, 5}));
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("").empty());
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("a").empty());
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("3-1").empty());
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("0-").empty());
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("-1").empty());
+  ASSERT_TRUE(NumaThreadPool::ParseCpuList("0-100000").empty());
+}
+
+TEST(NumaThreadPoolTest, run) {
+  ThreadPool::Options options;
+  options.min_threads = 1;
+  options.max_threads = 2;
+  NumaThreadPool pool(options);
+  ASSERT_GE(pool.NodeNum(), 1u);
+  ASSERT_LT(pool.CurrentNode(), pool.NodeNum());
+
+  std::atomic<int> count = {0};
+  auto add = [&count]() {
+    ++count;
+  };
+  // 每个子池都能执行任务
+  for (size_t i = 0; i < pool.NodeNum(); ++i) {
+    pool.Node(i).Enqueue(add).get();
+  }
+  pool.Enqueue(add).get();
+  ASSERT_EQ(count.load(), static_cast<int>(pool.NodeNum()) + 1);
+
+  auto answer = []() {
+    return 42;
+  };
+  ASSERT_EQ(pool.Submit(answer).Get(), 42);
+}
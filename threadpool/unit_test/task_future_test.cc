@@ -0,0 +1,138 @@
+#include "threadpool/task_future.h"
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// 统计存活的对象个数, 用来检查共享状态中的值有没有被析构
+struct Counted {
+  static int alive;
+  explicit Counted(int v) : value(v) {
+    ++alive;
+  }
+  Counted(Counted&& other) noexcept : value(other.value) {
+    ++alive;
+  }
+  ~Counted() {
+    --alive;
+  }
+  int value;
+};
+
+int Counted::alive = 0;
+
+}  // namespace
+
+TEST(TaskFutureTest, value) {
+  TaskPromise<std::string> promise;
+  TaskFuture<std::string> future = promise.GetFuture();
+  ASSERT_TRUE(future.Valid());
+  ASSERT_FALSE(future.IsReady());
+  ASSERT_FALSE(future.WaitFor(std::chrono::milliseconds(1)));
+
+  std::thread t([&promise]() {
+    promise.SetValue("hello");
+  });
+  ASSERT_EQ(future.Get(), "hello");
+  ASSERT_FALSE(future.Valid());
+  t.join();
+
+  TaskPromise<void> void_promise;
+  TaskFuture<void> void_future = void_promise.GetFuture();
+  void_promise.Run([]() {
+  });
+  ASSERT_TRUE(void_future.IsReady());
+  void_future.Get();
+}
+
+TEST(TaskFutureTest, exception) {
+  TaskPromise<int> promise;
+  TaskFuture<int> future = promise.GetFuture();
+  promise.Run([]() -> int {
+    throw std::runtime_error("oops");
+  });
+  ASSERT_TRUE(future.IsReady());
+  ASSERT_THROW(future.Get(), std::runtime_error);
+}
+
+TEST(TaskFutureTest, broken_promise) {
+  TaskFuture<int> future;
+  {
+    TaskPromise<int> promise;
+    future = promise.GetFuture();
+  }
+  ASSERT_TRUE(future.IsReady());
+  try {
+    future.Get();
+    FAIL();
+  } catch (const std::future_error& e) {
+    ASSERT_EQ(e.code(), std::make_error_code(std::future_errc::broken_promise));
+  }
+}
+
+TEST(TaskFutureTest, release) {
+  Counted::alive = 0;
+  // 没有调用 GetFuture, 设置结果后共享状态就应该被回收, 值随之析构
+  {
+    TaskPromise<Counted> promise;
+    promise.SetValue(1);
+    ASSERT_EQ(Counted::alive, 0);
+  }
+  {
+    TaskPromise<Counted> promise;
+  }
+  ASSERT_EQ(Counted::alive, 0);
+
+  // future 先于结果析构, 由 promise 回收
+  {
+    TaskPromise<Counted> promise;
+    promise.GetFuture();
+    promise.SetValue(2);
+    ASSERT_EQ(Counted::alive, 0);
+  }
+  // promise 先设置结果, 由 future 回收
+  {
+    TaskPromise<Counted> promise;
+    TaskFuture<Counted> future = promise.GetFuture();
+    promise.SetValue(3);
+    ASSERT_EQ(Counted::alive, 1);
+    ASSERT_EQ(future.Get().value, 3);
+    ASSERT_EQ(Counted::alive, 0);
+  }
+}
+
+TEST(TaskFutureTest, state_reuse) {
+  // 同一个线程上释放的共享状态会被下一次复用, 复用后不能残留上一次的结果
+  for (int i = 0; i < 100; ++i) {
+    {
+      TaskPromise<int> promise;
+      TaskFuture<int> future = promise.GetFuture();
+      promise.SetException(std::make_exception_ptr(std::runtime_error("oops")));
+      ASSERT_THROW(future.Get(), std::runtime_error);
+    }
+    {
+      TaskPromise<int> promise;
+      TaskFuture<int> future = promise.GetFuture();
+      ASSERT_FALSE(future.IsReady());
+      promise.SetValue(i);
+      ASSERT_EQ(future.Get(), i);
+    }
+  }
+
+  // 在其它线程上释放, 状态进入那个线程的缓存
+  for (int i = 0; i < 100; ++i) {
+    TaskPromise<int> promise;
+    TaskFuture<int> future = promise.GetFuture();
+    std::thread t([&future, i]() {
+      ASSERT_EQ(future.Get(), i);
+    });
+    promise.SetValue(i);
+    t.join();
+  }
+}
@@ -0,0 +1,408 @@
+#include "threadpool/threadpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// 占住一个 worker, Open 之前它一直阻塞, 用于在任务执行之前构造好队列的状态
+class Gate {
+ public:
+  Gate() : opened_(open_.get_future().share()) {
+  }
+
+  void Block(ThreadPool* pool) {
+    std::promise<void> started;
+    std::future<void> started_future = started.get_future();
+    std::shared_future<void> opened = opened_;
+    pool->Post([&started, opened]() {
+      started.set_value();
+      opened.wait();
+    });
+    started_future.wait();
+  }
+
+  void Open() {
+    open_.set_value();
+  }
+
+ private:
+  std::promise<void> open_;
+  std::shared_future<void> opened_;
+};
+
+// 线程退出时计数, 用于确认 worker 线程都已经结束
+struct ThreadExitCounter {
+  static std::atomic<int> exited;
+  // 每个线程第一次调用时创建计数对象
+  static void Touch() {
+    thread_local ThreadExitCounter counter;
+    (void)counter;
+  }
+  ~ThreadExitCounter() {
+    ++exited;
+  }
+};
+
+std::atomic<int> ThreadExitCounter::exited = {0};
+
+// 轮询直到 pred 成立, 超时返回 false
+template <typename Pred>
+bool WaitUntil(Pred pred, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// 等待 pool 中已经提交的任务全部执行完
+void Drain(ThreadPool* pool) {
+  pool->Enqueue([]() {}).wait();
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, cancel) {
+  ThreadPool pool(1);
+  Gate gate;
+  gate.Block(&pool);
+
+  std::mutex mtx;
+  std::vector<int> order;
+  std::vector<TaskId> ids;
+  for (int i = 0; i < 4; ++i) {
+    ids.push_back(pool.Post(TaskOptions(), [&mtx, &order, i]() {
+      std::lock_guard<std::mutex> lock(mtx);
+      order.push_back(i);
+    }));
+  }
+  ASSERT_EQ(pool.GetMetrics().backlog, 4u);
+  ASSERT_TRUE(pool.Cancel(ids[1]));
+  ASSERT_FALSE(pool.Cancel(ids[1]));
+  ASSERT_TRUE(pool.Cancel(ids[3]));
+  ASSERT_FALSE(pool.Cancel(0));
+  // 取消的任务不再计入 backlog
+  ASSERT_EQ(pool.GetMetrics().backlog, 2u);
+
+  gate.Open();
+  Drain(&pool);
+  ASSERT_EQ(order, std::vector<int>({0, 2}));
+  ASSERT_EQ(pool.GetMetrics().backlog, 0u);
+  // 已经执行完的任务
+  ASSERT_FALSE(pool.Cancel(ids[0]));
+}
+
+TEST(ThreadPoolTest, cancel_all) {
+  ThreadPool pool(1);
+  Gate gate;
+  gate.Block(&pool);
+
+  std::atomic<int> calls = {0};
+  std::vector<TaskId> ids;
+  for (int i = 0; i < 3; ++i) {
+    ids.push_back(pool.Post(TaskOptions(), [&calls]() {
+      ++calls;
+    }));
+  }
+  for (TaskId id : ids) {
+    ASSERT_TRUE(pool.Cancel(id));
+  }
+  ASSERT_EQ(pool.GetMetrics().backlog, 0u);
+
+  // 全部取消之后队列可以继续使用
+  pool.Post([&calls]() {
+    calls += 10;
+  });
+  ASSERT_EQ(pool.GetMetrics().backlog, 1u);
+  gate.Open();
+  Drain(&pool);
+  ASSERT_EQ(calls.load(), 10);
+}
+
+TEST(ThreadPoolTest, deadline) {
+  ThreadPool pool(1);
+  Gate gate;
+  gate.Block(&pool);
+
+  std::atomic<int> calls = {0};
+  TaskOptions expired;
+  expired.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+  pool.Post(expired, [&calls]() {
+    ++calls;
+  });
+  auto dropped = pool.Submit(expired, []() {
+    return 1;
+  });
+  TaskOptions in_time;
+  in_time.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+  auto kept = pool.Submit(in_time, []() {
+    return 2;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  gate.Open();
+  ASSERT_EQ(kept.Get(), 2);
+  try {
+    dropped.Get();
+    FAIL() << "expired task should not run";
+  } catch (const std::future_error& e) {
+    ASSERT_EQ(e.code(), std::future_errc::broken_promise);
+  }
+  ASSERT_EQ(calls.load(), 0);
+}
+
+TEST(ThreadPoolTest, priority_starvation_limit) {
+  // 和 ThreadPool::kStarvationLimit 一致
+  const int kStarvationLimit = 16;
+  ThreadPool pool(1);
+  Gate gate;
+  gate.Block(&pool);
+
+  std::mutex mtx;
+  std::vector<TaskPriority> order;
+  auto record = [&mtx, &order](TaskPriority priority) {
+    return [&mtx, &order, priority]() {
+      std::lock_guard<std::mutex> lock(mtx);
+      order.push_back(priority);
+    };
+  };
+  TaskOptions low;
+  low.priority = TaskPriority::LOW;
+  TaskOptions high;
+  high.priority = TaskPriority::HIGH;
+  for (int i = 0; i < 2; ++i) {
+    pool.Post(low, record(TaskPriority::LOW));
+  }
+  for (int i = 0; i < 3 * kStarvationLimit; ++i) {
+    pool.Post(high, record(TaskPriority::HIGH));
+  }
+  pool.Post(TaskOptions(), record(TaskPriority::NORMAL));
+
+  gate.Open();
+  // Drain 提交的任务也会插队, 所以等待所有任务执行完
+  const size_t total = 3 * kStarvationLimit + 3;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      if (order.size() == total) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::lock_guard<std::mutex> lock(mtx);
+  ASSERT_EQ(order.size(), total);
+  // 高优先级先执行, 低优先级连续被跳过 kStarvationLimit 次之后执行一次
+  std::vector<size_t> low_positions;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (order[i] == TaskPriority::LOW) {
+      low_positions.push_back(i);
+    }
+  }
+  ASSERT_EQ(low_positions, std::vector<size_t>({kStarvationLimit, 2 * kStarvationLimit + 1}));
+  ASSERT_EQ(order.front(), TaskPriority::HIGH);
+}
+
+TEST(ThreadPoolTest, parallel_for_exception) {
+  ThreadPool pool(4);
+
+  std::vector<std::atomic<int>> visited(1000);
+  pool.ParallelFor(0, visited.size(), 7, [&visited](size_t i) {
+    ++visited[i];
+  });
+  for (auto&& v : visited) {
+    ASSERT_EQ(v.load(), 1);
+  }
+
+  try {
+    pool.ParallelFor(0, 1000, 7, [](size_t i) {
+      if (i == 500) {
+        throw std::runtime_error("oops");
+      }
+    });
+    FAIL();
+  } catch (const std::runtime_error& e) {
+    ASSERT_STREQ(e.what(), "oops");
+  }
+
+  auto reduce = [](int a, int b) {
+    return a + b;
+  };
+  auto throwing_chunk = [](size_t b, size_t, int) -> int {
+    if (b == 0) {
+      throw std::logic_error("reduce");
+    }
+    return 1;
+  };
+  ASSERT_THROW(pool.ParallelReduce(0, 100, 10, 0, throwing_chunk, reduce), std::logic_error);
+
+  // 异常之后线程池仍然可用
+  auto chunk = [](size_t b, size_t e, int) {
+    return static_cast<int>(e - b);
+  };
+  ASSERT_EQ(pool.ParallelReduce(0, 100, 10, 0, chunk, reduce), 100);
+}
+
+TEST(ThreadPoolTest, elastic) {
+  ThreadExitCounter::exited = 0;
+  std::atomic<int> started = {0};
+  std::set<std::thread::id> thread_ids;
+  std::mutex mtx;
+  {
+    ThreadPool::Options options;
+    options.min_threads = 1;
+    options.max_threads = 4;
+    options.idle_timeout = std::chrono::milliseconds(50);
+    ThreadPool pool(options);
+    ASSERT_EQ(pool.Size(), 1u);
+
+    // 积压的任务超过空闲 worker 时扩容, 最多到 max_threads
+    std::promise<void> open;
+    std::shared_future<void> opened = open.get_future().share();
+    for (int i = 0; i < 8; ++i) {
+      pool.Post([&, opened]() {
+        ThreadExitCounter::Touch();
+        {
+          std::lock_guard<std::mutex> lock(mtx);
+          thread_ids.insert(std::this_thread::get_id());
+        }
+        ++started;
+        opened.wait();
+      });
+    }
+    auto all_busy = [&started]() {
+      return started.load() == 4;
+    };
+    ASSERT_TRUE(WaitUntil(all_busy));
+    ASSERT_EQ(pool.Size(), 4u);
+    ASSERT_EQ(pool.GetMetrics().backlog, 4u);
+    open.set_value();
+    Drain(&pool);
+    ASSERT_EQ(started.load(), 8);
+    ASSERT_EQ(thread_ids.size(), 4u);
+
+    // 空闲超过 idle_timeout 后缩容到 min_threads
+    auto shrunk = [&pool]() {
+      return pool.Size() == 1;
+    };
+    ASSERT_TRUE(WaitUntil(shrunk));
+    ASSERT_EQ(ThreadExitCounter::exited.load(), 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(pool.Size(), 1u);
+
+    // 缩容之后还能再次扩容, 最后一个退出的 worker 留在 retired_ 中由析构函数 join
+    std::promise<void> open_again;
+    std::shared_future<void> opened_again = open_again.get_future().share();
+    for (int i = 0; i < 2; ++i) {
+      pool.Post([&, opened_again]() {
+        ThreadExitCounter::Touch();
+        ++started;
+        opened_again.wait();
+      });
+    }
+    auto grown = [&started]() {
+      return started.load() == 10;
+    };
+    ASSERT_TRUE(WaitUntil(grown));
+    ASSERT_EQ(pool.Size(), 2u);
+    open_again.set_value();
+    ASSERT_TRUE(WaitUntil(shrunk));
+  }
+  // 析构函数 join 了所有线程, 包括已经退出但还没有 join 的
+  ASSERT_EQ(ThreadExitCounter::exited.load(), 5);
+}
+
+TEST(ThreadPoolTest, cpu_affinity) {
+  ThreadPool::Options options;
+  options.min_threads = 2;
+  options.max_threads = 2;
+  options.cpus = {0};
+  ThreadPool pool(options);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(pool.Enqueue(sched_getcpu).get(), 0);
+  }
+
+  options.cpus = {-1};
+  ASSERT_THROW(ThreadPool{options}, std::invalid_argument);
+}
+
+TEST(ThreadPoolTest, metrics) {
+  ThreadPool::Options options;
+  options.min_threads = 2;
+  options.max_threads = 2;
+  options.enable_metrics = true;
+  ThreadPool pool(options);
+  // worker 先空闲一段时间
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const uint64_t kTaskNum = 20;
+  const uint64_t kExecNs = 2000000;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::future<void>> futures;
+  for (uint64_t i = 0; i < kTaskNum; ++i) {
+    futures.emplace_back(pool.Enqueue([kExecNs]() {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(kExecNs));
+    }));
+  }
+  for (auto&& future : futures) {
+    future.wait();
+  }
+  // 结果在任务返回之后才记录
+  auto recorded = [&pool, kTaskNum]() {
+    return pool.GetMetrics().total.tasks_executed == kTaskNum;
+  };
+  ASSERT_TRUE(WaitUntil(recorded));
+  uint64_t elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  ThreadPoolMetrics metrics = pool.GetMetrics();
+  ASSERT_EQ(metrics.threads, 2u);
+  ASSERT_EQ(metrics.backlog, 0u);
+  ASSERT_EQ(metrics.workers.size(), 2u);
+  uint64_t per_worker = 0;
+  for (auto&& worker : metrics.workers) {
+    per_worker += worker.tasks_executed;
+    // 开始时空闲的 50ms
+    ASSERT_GE(worker.idle_ns, 40000000u);
+  }
+  ASSERT_EQ(per_worker, kTaskNum);
+  ASSERT_EQ(metrics.total.steals, 0u);
+
+  const LatencyHistogram& exec = metrics.total.exec_time;
+  ASSERT_EQ(exec.count, kTaskNum);
+  ASSERT_GE(exec.sum_ns, kTaskNum * kExecNs);
+  ASSERT_GE(exec.MeanNs(), kExecNs);
+  // 分位数是所在桶的上界, 不会小于样本, 最多是样本的 2 倍
+  ASSERT_GE(exec.PercentileNs(0.5), kExecNs);
+  ASSERT_LE(exec.PercentileNs(0.5), exec.PercentileNs(0.99));
+  ASSERT_LT(exec.PercentileNs(0.99), 2 * elapsed_ns);
+
+  // 2 个 worker 执行 20 个 2ms 的任务, 最后提交的任务至少排队 9 个任务的时间
+  const LatencyHistogram& wait = metrics.total.queue_wait;
+  ASSERT_EQ(wait.count, kTaskNum);
+  ASSERT_LE(wait.PercentileNs(0.5), wait.PercentileNs(0.99));
+  ASSERT_GE(wait.PercentileNs(0.99), 9 * kExecNs);
+  ASSERT_LT(wait.PercentileNs(0.99), 2 * elapsed_ns);
+  ASSERT_LT(wait.MeanNs(), elapsed_ns);
+
+  // 未开启统计时只有线程数和积压
+  ThreadPool plain(1);
+  plain.Enqueue([]() {}).wait();
+  ThreadPoolMetrics plain_metrics = plain.GetMetrics();
+  ASSERT_EQ(plain_metrics.threads, 1u);
+  ASSERT_TRUE(plain_metrics.workers.empty());
+  ASSERT_EQ(plain_metrics.total.tasks_executed, 0u);
+}
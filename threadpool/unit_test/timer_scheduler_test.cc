@@ -0,0 +1,130 @@
+#include "threadpool/timer_scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int64_t ElapsedMs(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+}  // namespace
+
+TEST(TimerSchedulerTest, run_after) {
+  ThreadPool pool(2);
+  TimerScheduler scheduler(&pool);
+
+  const int delays[] = {0, 1, 5, 20, 50};
+  std::vector<std::promise<Clock::time_point>> fired(sizeof(delays) / sizeof(delays[0]));
+  std::vector<Clock::time_point> added;
+  for (size_t i = 0; i < fired.size(); ++i) {
+    added.push_back(Clock::now());
+    TimerScheduler::TimerId id = scheduler.RunAfter(std::chrono::milliseconds(delays[i]), [&fired, i]() {
+      fired[i].set_value(Clock::now());
+    });
+    ASSERT_NE(id, 0u);
+  }
+  for (size_t i = 0; i < fired.size(); ++i) {
+    auto future = fired[i].get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    // 不会早于 delay 触发
+    ASSERT_GE(ElapsedMs(added[i], future.get()), delays[i]);
+  }
+  ASSERT_EQ(scheduler.Size(), 0u);
+}
+
+TEST(TimerSchedulerTest, cancel) {
+  ThreadPool pool(2);
+  TimerScheduler scheduler(&pool);
+
+  std::atomic<int> calls = {0};
+  auto id = scheduler.RunAfter(std::chrono::milliseconds(50), [&calls]() {
+    ++calls;
+  });
+  auto kept = scheduler.RunAfter(std::chrono::milliseconds(50), [&calls]() {
+    calls += 10;
+  });
+  ASSERT_NE(id, kept);
+  ASSERT_EQ(scheduler.Size(), 2u);
+  ASSERT_TRUE(scheduler.Cancel(id));
+  ASSERT_FALSE(scheduler.Cancel(id));
+  ASSERT_EQ(scheduler.Size(), 1u);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  ASSERT_EQ(calls.load(), 10);
+  // 单次定时器已经触发
+  ASSERT_FALSE(scheduler.Cancel(kept));
+  ASSERT_EQ(scheduler.Size(), 0u);
+}
+
+TEST(TimerSchedulerTest, run_every) {
+  ThreadPool pool(4);
+  TimerScheduler scheduler(&pool);
+
+  std::atomic<int> calls = {0};
+  std::atomic<int> running = {0};
+  std::atomic<int> max_running = {0};
+  // 每次执行 30ms, 远大于 5ms 的间隔, 上一次没执行完时跳过
+  auto id = scheduler.RunEvery(std::chrono::milliseconds(5), [&]() {
+    int now_running = ++running;
+    int expected = max_running.load();
+    while (now_running > expected && !max_running.compare_exchange_weak(expected, now_running)) {
+    }
+    ++calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    --running;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  ASSERT_TRUE(scheduler.Cancel(id));
+  ASSERT_FALSE(scheduler.Cancel(id));
+  ASSERT_EQ(max_running.load(), 1);
+  ASSERT_GE(calls.load(), 2);
+  ASSERT_LE(calls.load(), 300 / 30 + 1);
+
+  // 取消后不再触发, 已经投递的那一次执行完即可
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  int calls_after_cancel = calls.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_EQ(calls.load(), calls_after_cancel);
+  ASSERT_EQ(scheduler.Size(), 0u);
+}
+
+TEST(TimerSchedulerTest, multiple_rounds) {
+  ThreadPool pool(2);
+  TimerScheduler::Options options;
+  options.tick = std::chrono::milliseconds(1);
+  // 最小 64 个槽, 一圈 64ms
+  options.wheel_size = 64;
+  TimerScheduler scheduler(&pool, options);
+
+  // 150ms 和 22ms 落在同一个槽, 150ms 的定时器要等到第三圈才触发
+  std::promise<Clock::time_point> near_fired;
+  std::promise<Clock::time_point> far_fired;
+  Clock::time_point start = Clock::now();
+  scheduler.RunAfter(std::chrono::milliseconds(150), [&far_fired]() {
+    far_fired.set_value(Clock::now());
+  });
+  scheduler.RunAfter(std::chrono::milliseconds(22), [&near_fired]() {
+    near_fired.set_value(Clock::now());
+  });
+
+  auto near_future = near_fired.get_future();
+  auto far_future = far_fired.get_future();
+  ASSERT_EQ(near_future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_GE(ElapsedMs(start, near_future.get()), 22);
+  ASSERT_EQ(scheduler.Size(), 1u);
+  ASSERT_EQ(far_future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  int64_t far_ms = ElapsedMs(start, far_future.get());
+  ASSERT_GE(far_ms, 150);
+  // 没有晚一圈
+  ASSERT_LT(far_ms, 150 + 64);
+}
@@ -0,0 +1,140 @@
+#include "threadpool/unique_task.h"
+
+#include <array>
+#include <memory>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// 统计存活的对象个数和调用次数, Padding 控制对象大小
+template <std::size_t Padding>
+struct Counted {
+  static int alive;
+  static int calls;
+  Counted() {
+    ++alive;
+  }
+  Counted(const Counted&) {
+    ++alive;
+  }
+  Counted(Counted&&) noexcept {
+    ++alive;
+  }
+  ~Counted() {
+    --alive;
+  }
+  void operator()() {
+    ++calls;
+  }
+  std::array<char, Padding> padding = {};
+};
+
+template <std::size_t Padding>
+int Counted<Padding>::alive = 0;
+template <std::size_t Padding>
+int Counted<Padding>::calls = 0;
+
+using Small = Counted<8>;
+using Large = Counted<UniqueTask::kInlineSize * 2>;
+
+// 移动构造可能抛异常, 只能放在堆上
+struct ThrowingMove {
+  ThrowingMove() = default;
+  ThrowingMove(ThrowingMove&&) {
+  }
+  void operator()() {
+  }
+};
+
+}  // namespace
+
+TEST(UniqueTaskTest, storage) {
+  ASSERT_TRUE(UniqueTask::IsInline<Small>());
+  ASSERT_FALSE(UniqueTask::IsInline<Large>());
+  ASSERT_FALSE(UniqueTask::IsInline<ThrowingMove>());
+  ASSERT_TRUE(UniqueTask::IsInline<std::unique_ptr<int>>());
+  ASSERT_EQ(sizeof(UniqueTask), 64u);
+
+  UniqueTask empty;
+  ASSERT_FALSE(empty);
+
+  Small::alive = Small::calls = 0;
+  Large::alive = Large::calls = 0;
+  {
+    UniqueTask small{Small()};
+    UniqueTask large{Large()};
+    ASSERT_TRUE(small);
+    ASSERT_TRUE(large);
+    // 临时对象已经析构, 只剩任务中的一份
+    ASSERT_EQ(Small::alive, 1);
+    ASSERT_EQ(Large::alive, 1);
+    small();
+    large();
+    large();
+    ASSERT_EQ(Small::calls, 1);
+    ASSERT_EQ(Large::calls, 2);
+  }
+  ASSERT_EQ(Small::alive, 0);
+  ASSERT_EQ(Large::alive, 0);
+
+  UniqueTask throwing{ThrowingMove()};
+  throwing();
+}
+
+TEST(UniqueTaskTest, move) {
+  Small::alive = Small::calls = 0;
+  Large::alive = Large::calls = 0;
+  {
+    UniqueTask small{Small()};
+    UniqueTask moved(std::move(small));
+    ASSERT_FALSE(small);  // NOLINT: 检查移动后的状态
+    ASSERT_TRUE(moved);
+    ASSERT_EQ(Small::alive, 1);
+    moved();
+    ASSERT_EQ(Small::calls, 1);
+
+    UniqueTask large{Large()};
+    UniqueTask moved_large(std::move(large));
+    ASSERT_FALSE(large);  // NOLINT: 检查移动后的状态
+    // 堆上的对象只移动指针
+    ASSERT_EQ(Large::alive, 1);
+    moved_large();
+    ASSERT_EQ(Large::calls, 1);
+
+    // 移动赋值先析构原来的对象
+    moved = std::move(moved_large);
+    ASSERT_EQ(Small::alive, 0);
+    ASSERT_EQ(Large::alive, 1);
+    ASSERT_FALSE(moved_large);  // NOLINT: 检查移动后的状态
+    moved();
+    ASSERT_EQ(Large::calls, 2);
+
+    moved = UniqueTask{Small()};
+    ASSERT_EQ(Small::alive, 1);
+    ASSERT_EQ(Large::alive, 0);
+
+    moved.Reset();
+    ASSERT_FALSE(moved);
+    ASSERT_EQ(Small::alive, 0);
+
+    // 空任务之间的移动
+    UniqueTask empty;
+    moved = std::move(empty);
+    ASSERT_FALSE(moved);
+  }
+  ASSERT_EQ(Small::alive, 0);
+  ASSERT_EQ(Large::alive, 0);
+}
+
+TEST(UniqueTaskTest, move_only) {
+  int value = 0;
+  auto ptr = std::make_unique<int>(42);
+  UniqueTask task([&value, ptr = std::move(ptr)]() {
+    value = *ptr;
+  });
+  UniqueTask moved(std::move(task));
+  moved();
+  ASSERT_EQ(value, 42);
+}
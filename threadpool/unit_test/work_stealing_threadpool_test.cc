@@ -0,0 +1,112 @@
+#include "threadpool/work_stealing_threadpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(WorkStealingThreadPoolTest, enqueue) {
+  WorkStealingThreadPool pool(4);
+  ASSERT_EQ(pool.Size(), 4u);
+
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 1000; ++i) {
+    results.push_back(pool.Enqueue([](int x) {
+      return x * x;
+    }, i));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(results[i].get(), i * i);
+  }
+
+  auto failed = pool.Enqueue([]() -> int {
+    throw std::runtime_error("task failed");
+  });
+  ASSERT_THROW(failed.get(), std::runtime_error);
+}
+
+// worker 内部派生的子任务进入自己的队列, 由其他 worker 窃取执行
+TEST(WorkStealingThreadPoolTest, fork) {
+  const int kDepth = 12;
+  std::atomic<int> leaves = {0};
+  std::promise<void> all_done;
+  {
+    WorkStealingThreadPool pool(4);
+    std::function<void(int)> spawn = [&](int depth) {
+      if (depth == kDepth) {
+        if (++leaves == (1 << kDepth)) {
+          all_done.set_value();
+        }
+        return;
+      }
+      pool.Enqueue(spawn, depth + 1);
+      pool.Enqueue(spawn, depth + 1);
+    };
+    pool.Enqueue(spawn, 0);
+    ASSERT_EQ(all_done.get_future().wait_for(std::chrono::seconds(30)), std::future_status::ready);
+  }
+  ASSERT_EQ(leaves.load(), 1 << kDepth);
+}
+
+// 析构前提交的任务, 包括析构过程中由任务派生出的子任务, 都会执行完
+TEST(WorkStealingThreadPoolTest, shutdown_drain) {
+  const int kTasks = 2000;
+  std::atomic<int> calls = {0};
+  {
+    WorkStealingThreadPool pool(3);
+    WorkStealingThreadPool* pool_ptr = &pool;
+    for (int i = 0; i < kTasks; ++i) {
+      pool.Enqueue([pool_ptr, &calls, i]() {
+        ++calls;
+        if (i % 10 == 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+          pool_ptr->Enqueue([&calls]() {
+            ++calls;
+          });
+        }
+      });
+    }
+  }
+  ASSERT_EQ(calls.load(), kTasks + kTasks / 10);
+}
+
+TEST(WorkStealingThreadPoolTest, metrics) {
+  WorkStealingThreadPool pool(2, true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const uint64_t kTaskNum = 20;
+  const uint64_t kExecNs = 1000000;
+  std::vector<std::future<void>> futures;
+  for (uint64_t i = 0; i < kTaskNum; ++i) {
+    futures.emplace_back(pool.Enqueue([kExecNs]() {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(kExecNs));
+    }));
+  }
+  for (auto&& future : futures) {
+    future.wait();
+  }
+  // 结果在任务返回之后才记录
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (pool.GetMetrics().total.tasks_executed != kTaskNum && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  ThreadPoolMetrics metrics = pool.GetMetrics();
+  ASSERT_EQ(metrics.threads, 2u);
+  ASSERT_EQ(metrics.workers.size(), 2u);
+  ASSERT_EQ(metrics.total.tasks_executed, kTaskNum);
+  ASSERT_EQ(metrics.total.exec_time.count, kTaskNum);
+  ASSERT_EQ(metrics.total.queue_wait.count, kTaskNum);
+  ASSERT_GE(metrics.total.exec_time.PercentileNs(0.5), kExecNs);
+  ASSERT_GE(metrics.total.exec_time.MeanNs(), kExecNs);
+  ASSERT_LE(metrics.total.steals, kTaskNum);
+  // 至少有一个 worker 在开始时空闲了 50ms
+  ASSERT_GE(metrics.total.idle_ns, 40000000u);
+
+  WorkStealingThreadPool plain(1);
+  ASSERT_TRUE(plain.GetMetrics().workers.empty());
+}
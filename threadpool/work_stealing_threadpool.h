@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "threadpool/chase_lev_deque.h"
+#include "threadpool/threadpool_metrics.h"
+#include "threadpool/unique_task.h"
+#include "util/macro_util.h"
+
+/**
+ * @brief 工作窃取线程池, 接口和 ThreadPool 保持一致
+ *
+ * 1. 每个 worker 有一个 Chase-Lev 双端队列, worker 内部提交的任务直接压入自己的队列, 无需加锁
+ * 2. 外部线程提交的任务压入无锁注入栈, 空闲 worker 一次性取走整个栈, 恢复成提交顺序后放入自己的队列
+ * 3. 自己的队列和注入栈都为空时, 从随机位置开始依次窃取其他 worker 队列 top 端的任务
+ * 4. 实在找不到任务时才在条件变量上休眠, 提交任务时只有存在休眠的 worker 才会加锁唤醒
+ *
+ * 适合大量微秒级的小任务, 以及任务内部继续派生子任务(fork-join)的场景
+ */
+class WorkStealingThreadPool {
+ public:
+  explicit WorkStealingThreadPool(size_t threads);
+  // enable_metrics: 统计每个 worker 的任务数、窃取次数、排队和执行耗时, 每个任务多几次读时钟
+  WorkStealingThreadPool(size_t threads, bool enable_metrics);
+  ~WorkStealingThreadPool();
+
+  template <typename F, typename... Args>
+  auto Enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>;
+
+  size_t Size() const {
+    return workers_.size();
+  }
+
+  // 未开启统计时只有 threads 有效
+  ThreadPoolMetrics GetMetrics() const;
+
+ private:
+  struct TaskNode {
+    UniqueTask func;
+    // 只在注入栈中使用
+    TaskNode* next = nullptr;
+    // 只在开启统计时设置
+    uint64_t enqueue_ns = 0;
+  };
+
+  struct Worker {
+    ChaseLevDeque<TaskNode*> deque;
+    // 随机选择窃取起点, 避免所有空闲 worker 挤在同一个队列上
+    uint64_t rand_state = 0;
+    WorkerMetricsSlot metrics;
+  };
+
+  // 当前线程所属的线程池以及 worker 下标
+  struct WorkerContext {
+    WorkStealingThreadPool* pool = nullptr;
+    size_t index = 0;
+  };
+
+ private:
+  static WorkerContext& CurrentWorker() {
+    thread_local WorkerContext ctx;
+    return ctx;
+  }
+
+  void Submit(TaskNode* task);
+  void WorkerLoop(size_t index);
+  TaskNode* FindTask(size_t index);
+  TaskNode* TakeInjected(size_t index);
+  TaskNode* StealTask(size_t index);
+  void NotifyOne();
+  void RunTask(TaskNode* task, size_t index);
+
+ private:
+  // 自旋多少轮找不到任务后进入休眠
+  static constexpr int kSpinRounds = 64;
+
+ private:
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  // 外部提交的任务, 多生产者压入, worker 一次性取走
+  alignas(CACHE_LINE_SIZE) std::atomic<TaskNode*> inject_head_ = {nullptr};
+
+  // 每次提交任务都会递增, worker 休眠前记录该值, 用于避免丢失唤醒
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> epoch_ = {0};
+  std::atomic<int> sleepers_ = {0};
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic<bool> stop_ = {false};
+
+  const bool enable_metrics_ = false;
+  // 开启统计时记录已提交未执行的任务数
+  std::atomic<int64_t> backlog_ = {0};
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingThreadPool);
+};
+
+inline WorkStealingThreadPool::WorkStealingThreadPool(size_t threads) : WorkStealingThreadPool(threads, false) {
+}
+
+inline WorkStealingThreadPool::WorkStealingThreadPool(size_t threads, bool enable_metrics)
+    : enable_metrics_(enable_metrics) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(new Worker());
+    workers_.back()->rand_state = 0x9E3779B97F4A7C15ULL * (i + 1);
+  }
+  // 所有 worker 的队列都创建好之后再启动线程, 窃取时可以放心遍历 workers_
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&WorkStealingThreadPool::WorkerLoop, this, i);
+  }
+}
+
+// 析构前提交的任务都会执行完
+inline WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  sleep_cv_.notify_all();
+  for (auto&& thread : threads_) {
+    thread.join();
+  }
+}
+
+template <class F, class... Args>
+auto WorkStealingThreadPool::Enqueue(F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type> {
+  using return_type = typename std::result_of<F(Args...)>::type;
+
+  std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+  std::future<return_type> res = task.get_future();
+
+  auto node = new TaskNode();
+  node->func = UniqueTask(std::move(task));
+  Submit(node);
+  return res;
+}
+
+inline void WorkStealingThreadPool::Submit(TaskNode* task) {
+  if (enable_metrics_) {
+    task->enqueue_ns = WorkerMetricsSlot::NowNs();
+  }
+  WorkerContext& ctx = CurrentWorker();
+  if (ctx.pool == this) {
+    // worker 内部派生的任务直接放到自己的队列
+    if (enable_metrics_) {
+      backlog_.fetch_add(1, std::memory_order_relaxed);
+    }
+    workers_[ctx.index]->deque.Push(task);
+  } else {
+    // don't allow enqueueing after stopping the pool
+    if (stop_.load(std::memory_order_acquire)) {
+      delete task;
+      throw std::runtime_error("enqueue on stopped WorkStealingThreadPool");
+    }
+    if (enable_metrics_) {
+      backlog_.fetch_add(1, std::memory_order_relaxed);
+    }
+    task->next = inject_head_.load(std::memory_order_relaxed);
+    while (!inject_head_.compare_exchange_weak(task->next, task, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+    }
+  }
+  NotifyOne();
+}
+
+inline void WorkStealingThreadPool::NotifyOne() {
+  epoch_.fetch_add(1, std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+    // 加锁保证不会在 worker 检查完 epoch_ 和进入 wait 之间发出通知
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_cv_.notify_one();
+  }
+}
+
+inline void WorkStealingThreadPool::WorkerLoop(size_t index) {
+  CurrentWorker().pool = this;
+  CurrentWorker().index = index;
+
+  while (true) {
+    TaskNode* task = FindTask(index);
+    uint64_t idle_begin_ns = 0;
+    if (task == nullptr && enable_metrics_) {
+      idle_begin_ns = WorkerMetricsSlot::NowNs();
+    }
+    for (int i = 0; task == nullptr && i < kSpinRounds; ++i) {
+      std::this_thread::yield();
+      task = FindTask(index);
+    }
+
+    if (task == nullptr) {
+      // 先登记为休眠状态再检查一次, 这之后提交的任务一定会看到 sleepers_ > 0 并唤醒
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+      task = FindTask(index);
+      if (task == nullptr) {
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this, epoch] {
+          return stop_.load(std::memory_order_relaxed) || epoch_.load(std::memory_order_seq_cst) != epoch;
+        });
+      }
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      if (idle_begin_ns != 0) {
+        workers_[index]->metrics.RecordIdle(WorkerMetricsSlot::NowNs() - idle_begin_ns);
+        idle_begin_ns = 0;
+      }
+
+      if (task == nullptr) {
+        if (stop_.load(std::memory_order_acquire)) {
+          // 退出前把剩下的任务执行完, 其他 worker 队列中的任务由它们自己负责
+          while ((task = FindTask(index)) != nullptr) {
+            RunTask(task, index);
+          }
+          break;
+        }
+        continue;
+      }
+    }
+
+    if (idle_begin_ns != 0) {
+      workers_[index]->metrics.RecordIdle(WorkerMetricsSlot::NowNs() - idle_begin_ns);
+    }
+    RunTask(task, index);
+  }
+
+  CurrentWorker().pool = nullptr;
+}
+
+inline void WorkStealingThreadPool::RunTask(TaskNode* task, size_t index) {
+  if (!enable_metrics_) {
+    task->func();
+    delete task;
+    return;
+  }
+  backlog_.fetch_sub(1, std::memory_order_relaxed);
+  uint64_t begin_ns = WorkerMetricsSlot::NowNs();
+  task->func();
+  uint64_t end_ns = WorkerMetricsSlot::NowNs();
+  workers_[index]->metrics.RecordTask(begin_ns - task->enqueue_ns, end_ns - begin_ns);
+  delete task;
+}
+
+inline ThreadPoolMetrics WorkStealingThreadPool::GetMetrics() const {
+  ThreadPoolMetrics res;
+  res.threads = workers_.size();
+  if (!enable_metrics_) {
+    return res;
+  }
+  res.backlog = std::max<int64_t>(0, backlog_.load(std::memory_order_relaxed));
+  res.workers.resize(workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->metrics.Snapshot(&res.workers[i]);
+    res.total.Merge(res.workers[i]);
+  }
+  return res;
+}
+
+inline WorkStealingThreadPool::TaskNode* WorkStealingThreadPool::FindTask(size_t index) {
+  TaskNode* task = nullptr;
+  if (workers_[index]->deque.Pop(&task)) {
+    return task;
+  }
+  task = TakeInjected(index);
+  if (task != nullptr) {
+    return task;
+  }
+  return StealTask(index);
+}
+
+/**
+ * @brief 取走注入栈中的所有任务, 返回最早提交的任务, 其余按提交顺序放入自己的队列供其他 worker 窃取
+ *
+ */
+inline WorkStealingThreadPool::TaskNode* WorkStealingThreadPool::TakeInjected(size_t index) {
+  if (inject_head_.load(std::memory_order_relaxed) == nullptr) {
+    return nullptr;
+  }
+  TaskNode* node = inject_head_.exchange(nullptr, std::memory_order_acquire);
+  if (node == nullptr) {
+    return nullptr;
+  }
+
+  // 注入栈是后进先出的, 反转后恢复提交顺序
+  TaskNode* reversed = nullptr;
+  while (node != nullptr) {
+    TaskNode* next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+
+  TaskNode* first = reversed;
+  reversed = reversed->next;
+  // 窃取者从 top 端取, 先放入的任务先被窃取, 整体上仍然接近提交顺序
+  bool has_more = reversed != nullptr;
+  while (reversed != nullptr) {
+    TaskNode* next = reversed->next;
+    reversed->next = nullptr;
+    workers_[index]->deque.Push(reversed);
+    reversed = next;
+  }
+  if (has_more) {
+    // 让休眠的 worker 过来窃取
+    NotifyOne();
+  }
+  first->next = nullptr;
+  return first;
+}
+
+inline WorkStealingThreadPool::TaskNode* WorkStealingThreadPool::StealTask(size_t index) {
+  size_t worker_num = workers_.size();
+  if (worker_num <= 1) {
+    return nullptr;
+  }
+
+  // xorshift64
+  uint64_t& x = workers_[index]->rand_state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+
+  size_t start = x % worker_num;
+  TaskNode* task = nullptr;
+  for (size_t i = 0; i < worker_num; ++i) {
+    size_t victim = (start + i) % worker_num;
+    if (victim != index && workers_[victim]->deque.Steal(&task)) {
+      if (enable_metrics_) {
+        workers_[index]->metrics.RecordSteal();
+      }
+      return task;
+    }
+  }
+  return nullptr;
+}
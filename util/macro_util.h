@@ -45,6 +45,11 @@
     perror(new_str.c_str());                                                                                         \
   } while (0)
 
+/**
+ * cache line size, used with alignas to avoid false sharing
+ */
+#define CACHE_LINE_SIZE 64
+
 #define DISALLOW_COPY_AND_ASSIGN(class_name) \
   class_name(const class_name&) = delete;    \
   void operator=(const class_name&) = delete;